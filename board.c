@@ -236,15 +236,22 @@ void board_dump(const struct board_t *board) {
 	}
 }
 
+void board_reset(struct board_t *board) {
+	memset(board->tiles, EMPTY_NEUTRAL, NUMBER_TILES(board->n));
+	const unsigned int tile_max_index = NUMBER_TILES(board->n) - 1;
+	for (int i = 0; i < board->n; i++) {
+		board->tiles[i] = PIECE_CLIMB;
+		board->tiles[tile_max_index - i] = PIECE_TRENCH;
+	}
+}
+
 struct board_t *board_init(uint8_t n) {
 	struct board_t *result = calloc(1, BOARD_SIZE_BYTES(n));
-	result->n = n;
-	memset(result->tiles, EMPTY_NEUTRAL, NUMBER_TILES(n));
-	const unsigned int tile_max_index = NUMBER_TILES(n) - 1;
-	for (int i = 0; i < n; i++) {
-		result->tiles[i] = PIECE_CLIMB;
-		result->tiles[tile_max_index - i] = PIECE_TRENCH;
+	if (!result) {
+		return NULL;
 	}
+	result->n = n;
+	board_reset(result);
 	return result;
 }
 
@@ -32,6 +32,7 @@ enum tile_state_t {
 	PIECE_TRENCH,
 	PIECE_CLIMB,
 };
+#define TILE_STATE_COUNT		5
 
 /* Iso-Path(n) has #P = 3 n² - 3n + 1 */
 /* i.e., Iso-Path(4) has #P = 37 */
@@ -85,6 +86,7 @@ void tile_index_to_canonical_pos(unsigned int tile_index, uint8_t n, struct cano
 void dump_canonical_pos(const struct canonical_position_t *canonical_pos);
 void dump_canonical_board(uint8_t n);
 void board_dump(const struct board_t *board);
+void board_reset(struct board_t *board);
 struct board_t *board_init(uint8_t n);
 struct board_t *board_clone(const struct board_t *source);
 void board_free(struct board_t *board);
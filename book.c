@@ -0,0 +1,346 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "book.h"
+#include "search.h"
+#include "parallel.h"
+
+/* The book is built level by level from the starting position. For every
+ * position of a level, a search determines the best action which goes into
+ * the book. The positions of the next level are reached by the "width"
+ * statically best actions of every position, so that the book also covers
+ * plausible deviations of the opponent. Positions are stored as raw tiles
+ * plus side to move, which is enough to set up a game. */
+
+struct book_position_t {
+	uint64_t hash;
+	enum side_t side_turn;
+	uint8_t *tiles;
+};
+
+struct book_level_t {
+	unsigned int count;
+	unsigned int capacity;
+	struct book_position_t *positions;
+};
+
+struct book_build_ctx_t {
+	const struct book_build_params_t *params;
+	const struct book_level_t *current;
+	atomic_uint next_position;
+	struct book_entry_t *entries;
+	pthread_mutex_t lock;
+	struct book_level_t next;
+	atomic_ullong nodes;
+};
+
+struct book_candidate_t {
+	struct action_t action;
+	float score;
+};
+
+struct book_candidates_ctx_t {
+	const struct strategy_t *strategy;
+	unsigned int count;
+	unsigned int capacity;
+	struct book_candidate_t *candidates;
+};
+
+static void book_level_add(struct book_level_t *level, const struct game_t *game) {
+	if (level->count == level->capacity) {
+		level->capacity = level->capacity ? (2 * level->capacity) : 64;
+		level->positions = realloc(level->positions, sizeof(struct book_position_t) * level->capacity);
+		if (!level->positions) {
+			fprintf(stderr, "Failed to grow book level to %u positions.\n", level->capacity);
+			abort();
+		}
+	}
+	struct book_position_t *position = &level->positions[level->count++];
+	position->hash = game->hash;
+	position->side_turn = game->side_turn;
+	position->tiles = malloc(NUMBER_TILES(game->n));
+	if (!position->tiles) {
+		perror("malloc");
+		abort();
+	}
+	memcpy(position->tiles, game->board->tiles, NUMBER_TILES(game->n));
+}
+
+static void book_level_free(struct book_level_t *level) {
+	for (unsigned int i = 0; i < level->count; i++) {
+		free(level->positions[i].tiles);
+	}
+	free(level->positions);
+	memset(level, 0, sizeof(struct book_level_t));
+}
+
+static int book_position_cmp(const void *v_pos1, const void *v_pos2) {
+	const struct book_position_t *pos1 = (const struct book_position_t*)v_pos1;
+	const struct book_position_t *pos2 = (const struct book_position_t*)v_pos2;
+	return (pos1->hash > pos2->hash) - (pos1->hash < pos2->hash);
+}
+
+static void book_level_unique(struct book_level_t *level) {
+	if (level->count == 0) {
+		return;
+	}
+	qsort(level->positions, level->count, sizeof(struct book_position_t), book_position_cmp);
+	unsigned int out = 0;
+	for (unsigned int i = 1; i < level->count; i++) {
+		if (level->positions[i].hash == level->positions[out].hash) {
+			free(level->positions[i].tiles);
+		} else {
+			level->positions[++out] = level->positions[i];
+		}
+	}
+	level->count = out + 1;
+}
+
+static bool book_candidate_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct book_candidates_ctx_t *ctx = (struct book_candidates_ctx_t*)vctx;
+	if (ctx->count == ctx->capacity) {
+		ctx->capacity = ctx->capacity ? (2 * ctx->capacity) : 256;
+		ctx->candidates = realloc(ctx->candidates, sizeof(struct book_candidate_t) * ctx->capacity);
+		if (!ctx->candidates) {
+			fprintf(stderr, "Failed to grow book candidate list to %u actions.\n", ctx->capacity);
+			abort();
+		}
+	}
+	ctx->candidates[ctx->count].action = *action;
+	ctx->candidates[ctx->count].score = strategy_evaluate(game, ctx->strategy);
+	ctx->count++;
+	return true;
+}
+
+static int book_candidate_cmp(const void *v_cand1, const void *v_cand2) {
+	const struct book_candidate_t *cand1 = (const struct book_candidate_t*)v_cand1;
+	const struct book_candidate_t *cand2 = (const struct book_candidate_t*)v_cand2;
+	return (cand1->score < cand2->score) - (cand1->score > cand2->score);
+}
+
+static void book_expand(struct book_level_t *next, struct game_t *game, const struct action_t *action) {
+	enum side_t side = game->side_turn;
+	game_make_action(game, action);
+	if (!game_won_by(game, side)) {
+		book_level_add(next, game);
+	}
+	game_unmake_action(game);
+}
+
+static void book_build_thread(unsigned int thread_id, void *vctx) {
+	struct book_build_ctx_t *ctx = (struct book_build_ctx_t*)vctx;
+	const struct book_build_params_t *params = ctx->params;
+	struct game_t *game = game_init(params->n);
+	struct book_level_t next = { 0 };
+
+	while (true) {
+		unsigned int index = atomic_fetch_add(&ctx->next_position, 1);
+		if (index >= ctx->current->count) {
+			break;
+		}
+		const struct book_position_t *position = &ctx->current->positions[index];
+		game_set_position(game, position->tiles, position->side_turn);
+
+		struct search_params_t search_params = {
+			.strategy = params->strategy,
+			.depth = params->search_depth,
+			.node_budget = params->node_budget,
+			.ttable = params->ttable,
+		};
+		struct search_result_t result;
+		struct book_entry_t *entry = &ctx->entries[index];
+		if (search_best_action(game, &search_params, &result)) {
+			*entry = (struct book_entry_t) {
+				.hash = position->hash,
+				.action = game_pack_action(&result.best_action),
+				.score = result.score,
+			};
+		}
+		atomic_fetch_add(&ctx->nodes, result.nodes);
+
+		if (params->width) {
+			/* Expand the statically best actions plus the searched one */
+			struct book_candidates_ctx_t candidates = {
+				.strategy = params->strategy,
+			};
+			enumerate_valid_actions(game, book_candidate_callback, &candidates);
+			qsort(candidates.candidates, candidates.count, sizeof(struct book_candidate_t), book_candidate_cmp);
+			unsigned int expand_count = (candidates.count < params->width) ? candidates.count : params->width;
+			for (unsigned int i = 0; i < expand_count; i++) {
+				book_expand(&next, game, &candidates.candidates[i].action);
+			}
+			if (result.have_action) {
+				book_expand(&next, game, &result.best_action);
+			}
+			free(candidates.candidates);
+		}
+	}
+
+	/* Hand our share of the next level over */
+	pthread_mutex_lock(&ctx->lock);
+	for (unsigned int i = 0; i < next.count; i++) {
+		if (ctx->next.count == ctx->next.capacity) {
+			ctx->next.capacity = ctx->next.capacity ? (2 * ctx->next.capacity) : 64;
+			ctx->next.positions = realloc(ctx->next.positions, sizeof(struct book_position_t) * ctx->next.capacity);
+			if (!ctx->next.positions) {
+				fprintf(stderr, "Failed to grow book level to %u positions.\n", ctx->next.capacity);
+				abort();
+			}
+		}
+		ctx->next.positions[ctx->next.count++] = next.positions[i];
+	}
+	pthread_mutex_unlock(&ctx->lock);
+	free(next.positions);
+	game_free(game);
+}
+
+static int book_entry_cmp(const void *v_entry1, const void *v_entry2) {
+	const struct book_entry_t *entry1 = (const struct book_entry_t*)v_entry1;
+	const struct book_entry_t *entry2 = (const struct book_entry_t*)v_entry2;
+	return (entry1->hash > entry2->hash) - (entry1->hash < entry2->hash);
+}
+
+bool book_build(const struct book_build_params_t *params) {
+	struct book_level_t level = { 0 };
+	struct game_t *game = game_init(params->n);
+	book_level_add(&level, game);
+	game_free(game);
+
+	unsigned int entry_count = 0;
+	struct book_entry_t *entries = NULL;
+	for (unsigned int depth = 0; (depth < params->book_depth) && level.count; depth++) {
+		struct book_build_ctx_t ctx = {
+			.params = params,
+			.current = &level,
+			.entries = calloc(level.count, sizeof(struct book_entry_t)),
+			.lock = PTHREAD_MUTEX_INITIALIZER,
+		};
+		if (!ctx.entries) {
+			perror("calloc");
+			abort();
+		}
+		parallel_run(params->thread_count, book_build_thread, &ctx);
+
+		entries = realloc(entries, sizeof(struct book_entry_t) * (entry_count + level.count));
+		if (!entries) {
+			fprintf(stderr, "Failed to grow book to %u entries.\n", entry_count + level.count);
+			abort();
+		}
+		for (unsigned int i = 0; i < level.count; i++) {
+			if (ctx.entries[i].hash) {
+				entries[entry_count++] = ctx.entries[i];
+			}
+		}
+		free(ctx.entries);
+		fprintf(stderr, "book: depth %u, %u positions, %llu nodes searched\n", depth, level.count, (unsigned long long)ctx.nodes);
+
+		book_level_free(&level);
+		level = ctx.next;
+		book_level_unique(&level);
+	}
+	book_level_free(&level);
+
+	/* Positions can be reached on different levels; keep the first one */
+	qsort(entries, entry_count, sizeof(struct book_entry_t), book_entry_cmp);
+	unsigned int unique_count = 0;
+	for (unsigned int i = 0; i < entry_count; i++) {
+		if ((unique_count == 0) || (entries[unique_count - 1].hash != entries[i].hash)) {
+			entries[unique_count++] = entries[i];
+		}
+	}
+
+	bool success = false;
+	struct mmapfile_t *file = mmapfile_create(params->output_filename, sizeof(struct book_header_t) + (sizeof(struct book_entry_t) * unique_count));
+	if (file) {
+		struct book_header_t *header = (struct book_header_t*)file->data;
+		*header = (struct book_header_t) {
+			.magic = BOOK_MAGIC,
+			.version = BOOK_VERSION,
+			.n = params->n,
+			.entry_count = unique_count,
+		};
+		memcpy(header + 1, entries, sizeof(struct book_entry_t) * unique_count);
+		mmapfile_close(file);
+		fprintf(stderr, "book: wrote %u positions to %s\n", unique_count, params->output_filename);
+		success = true;
+	}
+	free(entries);
+	return success;
+}
+
+struct book_t *book_open(const char *filename) {
+	struct book_t *book = calloc(1, sizeof(struct book_t));
+	if (!book) {
+		return NULL;
+	}
+	book->file = mmapfile_open(filename, false);
+	if (!book->file) {
+		free(book);
+		return NULL;
+	}
+	book->header = (const struct book_header_t*)book->file->data;
+	if ((book->file->length < sizeof(struct book_header_t)) || (book->header->magic != BOOK_MAGIC) || (book->header->version != BOOK_VERSION)
+			|| (book->file->length != sizeof(struct book_header_t) + (sizeof(struct book_entry_t) * book->header->entry_count))) {
+		fprintf(stderr, "%s: not a valid opening book.\n", filename);
+		book_close(book);
+		return NULL;
+	}
+	book->entries = (const struct book_entry_t*)(book->header + 1);
+	return book;
+}
+
+/* Finds the book action for the current position. The action is checked
+ * against the board before it is returned, so neither a hash collision nor a
+ * corrupt or foreign book can lead to an illegal action. */
+bool book_lookup(const struct book_t *book, struct game_t *game, struct action_t *action) {
+	if (book->header->n != game->n) {
+		return false;
+	}
+	int lo = 0;
+	int hi = (int)book->header->entry_count - 1;
+	while (lo <= hi) {
+		int mid = lo + ((hi - lo) / 2);
+		const struct book_entry_t *entry = &book->entries[mid];
+		if (entry->hash == game->hash) {
+			game_unpack_action(entry->action, action);
+			return is_action_legal_checked(game, action);
+		} else if (entry->hash < game->hash) {
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return false;
+}
+
+void book_close(struct book_t *book) {
+	if (!book) {
+		return;
+	}
+	mmapfile_close(book->file);
+	free(book);
+}
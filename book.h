@@ -0,0 +1,75 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __BOOK_H__
+#define __BOOK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game.h"
+#include "strategy.h"
+#include "mmapfile.h"
+#include "ttable.h"
+
+#define BOOK_MAGIC				0x4b425049		/* "IPBK" */
+#define BOOK_VERSION			1
+
+struct book_header_t {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t n;
+	uint32_t entry_count;
+};
+
+/* Entries are sorted by hash so lookup is a binary search in the mapping */
+struct book_entry_t {
+	uint64_t hash;
+	uint32_t action;
+	float score;
+};
+
+struct book_t {
+	struct mmapfile_t *file;
+	const struct book_header_t *header;
+	const struct book_entry_t *entries;
+};
+
+struct book_build_params_t {
+	uint8_t n;
+	const struct strategy_t *strategy;
+	unsigned int book_depth;
+	unsigned int width;
+	unsigned int search_depth;
+	uint64_t node_budget;
+	unsigned int thread_count;
+	struct ttable_t *ttable;
+	const char *output_filename;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+bool book_build(const struct book_build_params_t *params);
+struct book_t *book_open(const char *filename);
+bool book_lookup(const struct book_t *book, struct game_t *game, struct action_t *action);
+void book_close(struct book_t *book);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <string.h>
+#include "distance.h"
+
+/* Distances of a piece to the enemy base, where the piece wins. The static
+ * table is a multi-source BFS from all enemy base tiles over the adjacency
+ * graph (which includes the teleport edges) and ignores the board contents;
+ * game_init computes it once per side. The bounded search looks at the
+ * actual board instead: a piece may only step onto an empty tile of its own
+ * height and every level a tile is off costs one build first, so entering a
+ * tile costs one move plus zero to two builds, plus one if another piece has
+ * to make room. With edge costs of one to four, a bucket queue of five
+ * buckets suffices for this Dijkstra search. */
+
+#define DISTANCE_BUCKETS		5
+
+static uint8_t distance_enemy_base(enum side_t side) {
+	return (side == TRENCH) ? CANONICAL_LOCFLAG_CLIMB_BASE : CANONICAL_LOCFLAG_TRENCH_BASE;
+}
+
+void distance_goal_table(const struct game_t *game, enum side_t side, uint8_t *distances) {
+	const unsigned int tile_count = NUMBER_TILES(game->n);
+	const uint8_t enemy_base = distance_enemy_base(side);
+	uint8_t queue[tile_count];
+	unsigned int head = 0, tail = 0;
+	memset(distances, 0xff, tile_count);
+	for (unsigned int i = 0; i < tile_count; i++) {
+		if (game->canpos[i].loc_flags & enemy_base) {
+			distances[i] = 0;
+			queue[tail++] = i;
+		}
+	}
+	while (head < tail) {
+		unsigned int tile = queue[head++];
+		for (unsigned int i = 0; i < game->canpos[tile].adjacent_count; i++) {
+			unsigned int adjacent = game->canpos[tile].adjacent_tiles[i];
+			if (distances[adjacent] == 0xff) {
+				distances[adjacent] = distances[tile] + 1;
+				queue[tail++] = adjacent;
+			}
+		}
+	}
+}
+
+/* Cost on top of the move itself before a piece of the given side can step
+ * onto a tile. A piece sits on a tile of its own side's height; an occupied
+ * tile has to be vacated (or captured) first, which costs one more. */
+static unsigned int distance_enter_cost(uint8_t tile, enum side_t side) {
+	const int own_height = (side == TRENCH) ? EMPTY_TRENCH : EMPTY_CLIMB;
+	int height = tile;
+	unsigned int occupied = 0;
+	if ((tile == PIECE_TRENCH) || (tile == PIECE_CLIMB)) {
+		height = (tile == PIECE_TRENCH) ? EMPTY_TRENCH : EMPTY_CLIMB;
+		occupied = 1;
+	}
+	return occupied + ((height > own_height) ? (height - own_height) : (own_height - height));
+}
+
+/* Fills in, for every tile, the cost in moves and builds for a piece of the
+ * given side standing there to reach the enemy base given the current tile
+ * heights. Costs of bound or more are reported as bound. Runs backwards from
+ * the enemy base, so one pass serves all pieces of a side. */
+void distance_height_table(const struct game_t *game, enum side_t side, uint8_t *distances, unsigned int bound) {
+	const unsigned int tile_count = NUMBER_TILES(game->n);
+	const uint8_t enemy_base = distance_enemy_base(side);
+	uint8_t buckets[DISTANCE_BUCKETS][tile_count];
+	unsigned int bucket_size[DISTANCE_BUCKETS] = { 0 };
+	if (bound > DISTANCE_MAX_BOUND) {
+		bound = DISTANCE_MAX_BOUND;
+	}
+
+	memset(distances, bound, tile_count);
+	unsigned int pending = 0;
+	for (unsigned int i = 0; i < tile_count; i++) {
+		if (game->canpos[i].loc_flags & enemy_base) {
+			distances[i] = 0;
+			buckets[0][bucket_size[0]++] = i;
+			pending++;
+		}
+	}
+	for (unsigned int current = 0; pending && (current < bound); current++) {
+		const unsigned int bucket = current % DISTANCE_BUCKETS;
+		for (unsigned int i = 0; i < bucket_size[bucket]; i++) {
+			const unsigned int tile = buckets[bucket][i];
+			pending--;
+			if (distances[tile] != current) {
+				/* Stale entry, tile was reached cheaper meanwhile */
+				continue;
+			}
+
+			/* Stepping from any neighbor onto this tile */
+			const unsigned int new_cost = current + 1 + distance_enter_cost(game->board->tiles[tile], side);
+			if (new_cost >= bound) {
+				continue;
+			}
+			for (unsigned int j = 0; j < game->canpos[tile].adjacent_count; j++) {
+				const unsigned int adjacent = game->canpos[tile].adjacent_tiles[j];
+				if (new_cost < distances[adjacent]) {
+					distances[adjacent] = new_cost;
+					const unsigned int new_bucket = new_cost % DISTANCE_BUCKETS;
+					buckets[new_bucket][bucket_size[new_bucket]++] = adjacent;
+					pending++;
+				}
+			}
+		}
+		bucket_size[bucket] = 0;
+	}
+}
@@ -0,0 +1,38 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __DISTANCE_H__
+#define __DISTANCE_H__
+
+#include <stdint.h>
+#include "game.h"
+
+/* Bound for height-aware searches that is sufficient for every board size
+ * the engine supports */
+#define DISTANCE_MAX_BOUND		255
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+void distance_goal_table(const struct game_t *game, enum side_t side, uint8_t *distances);
+void distance_height_table(const struct game_t *game, enum side_t side, uint8_t *distances, unsigned int bound);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
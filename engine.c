@@ -0,0 +1,287 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "engine.h"
+#include "notation.h"
+#include "evaluation.h"
+#include "search.h"
+#include "monotime.h"
+
+#define ENGINE_TOKEN_SEPARATORS		" \t\r\n"
+
+struct engine_t {
+	const struct engine_params_t *params;
+	struct game_t *game;
+	FILE *out;
+	bool quit;
+};
+
+struct list_actions_ctx_t {
+	FILE *out;
+	unsigned int count;
+};
+
+struct perft_ctx_t {
+	unsigned int depth;
+	uint64_t count;
+};
+
+static bool list_actions_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct list_actions_ctx_t *ctx = (struct list_actions_ctx_t*)vctx;
+	char action_str[ACTION_STRING_MAXLEN];
+	action_to_string(action_str, sizeof(action_str), action);
+	fprintf(ctx->out, "%s%s", ctx->count ? " " : "actions ", action_str);
+	ctx->count++;
+	return true;
+}
+
+static bool perft_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct perft_ctx_t *ctx = (struct perft_ctx_t*)vctx;
+	if (game_won_by(game, game->side_turn)) {
+		/* The game ends here, nothing follows */
+		return true;
+	}
+	game_pass_turn(game);
+	ctx->count += engine_perft(game, ctx->depth - 1);
+	game_pass_turn(game);
+	return true;
+}
+
+/* Number of action sequences of the given length from the current position;
+ * sequences end early when an action wins the game. The last ply is counted
+ * combinatorially instead of being enumerated. */
+uint64_t engine_perft(struct game_t *game, unsigned int depth) {
+	if (depth == 0) {
+		return 1;
+	}
+	if (depth == 1) {
+		return game_count_actions(game, game->side_turn);
+	}
+	struct perft_ctx_t ctx = {
+		.depth = depth,
+	};
+	enumerate_valid_actions(game, perft_callback, &ctx);
+	return ctx.count;
+}
+
+static bool engine_parse_uint(const char *string, uint64_t *value) {
+	if (!string) {
+		return false;
+	}
+	char *end;
+	*value = strtoull(string, &end, 10);
+	return (*string != 0) && (*end == 0);
+}
+
+static bool engine_error(struct engine_t *engine, const char *reason) {
+	fprintf(engine->out, "error %s\n", reason);
+	return false;
+}
+
+static bool engine_cmd_new(struct engine_t *engine, char **saveptr) {
+	game_reset(engine->game);
+	return true;
+}
+
+static bool engine_cmd_position(struct engine_t *engine, char **saveptr) {
+	const char *tiles_str = strtok_r(NULL, ENGINE_TOKEN_SEPARATORS, saveptr);
+	const char *side_str = strtok_r(NULL, ENGINE_TOKEN_SEPARATORS, saveptr);
+	uint8_t tiles[NUMBER_TILES(engine->game->n)];
+	enum side_t side;
+	if (!tiles_str || !position_from_string(tiles_str, engine->game->n, tiles)) {
+		return engine_error(engine, "invalid position");
+	}
+	if (!side_str || !side_from_string(side_str, &side)) {
+		return engine_error(engine, "invalid side");
+	}
+	game_set_position(engine->game, tiles, side);
+	return true;
+}
+
+static bool engine_cmd_show(struct engine_t *engine, char **saveptr) {
+	char position_str[POSITION_STRING_MAXLEN(engine->game->n)];
+	position_to_string(position_str, engine->game);
+	fprintf(engine->out, "position %s %s\n", position_str, side_to_string(engine->game->side_turn));
+	fprintf(engine->out, "hash %016" PRIx64 "\n", engine->game->hash);
+	return true;
+}
+
+static bool engine_cmd_apply(struct engine_t *engine, char **saveptr) {
+	const char *action_str;
+	while ((action_str = strtok_r(NULL, ENGINE_TOKEN_SEPARATORS, saveptr))) {
+		struct action_t action;
+		if (!action_from_string(action_str, &action)) {
+			return engine_error(engine, "invalid action");
+		}
+		if (!game_action_valid(engine->game, &action)) {
+			return engine_error(engine, "illegal action");
+		}
+		game_perform_action(engine->game, &action);
+	}
+	return true;
+}
+
+static bool engine_cmd_actions(struct engine_t *engine, char **saveptr) {
+	struct list_actions_ctx_t ctx = {
+		.out = engine->out,
+	};
+	enumerate_valid_actions(engine->game, list_actions_callback, &ctx);
+	if (ctx.count) {
+		fprintf(engine->out, "\n");
+	}
+	return true;
+}
+
+static bool engine_cmd_evaluate(struct engine_t *engine, char **saveptr) {
+	const struct strategy_t *strategy = engine->params->strategy;
+	struct feature_vector_t features;
+	evaluation_extract_features(engine->game, strategy->distance_metric, FEATURE_MASK_ALL, &features);
+	for (int i = 0; i < FEATURE_USED_COUNT; i++) {
+		fprintf(engine->out, "feature %s %g\n", evaluation_feature_name(i), features.values[i]);
+	}
+	fprintf(engine->out, "evaluation %g\n", evaluation_dot(&strategy->weights, &features));
+	return true;
+}
+
+static bool engine_cmd_perft(struct engine_t *engine, char **saveptr) {
+	uint64_t depth;
+	if (!engine_parse_uint(strtok_r(NULL, ENGINE_TOKEN_SEPARATORS, saveptr), &depth)) {
+		return engine_error(engine, "invalid depth");
+	}
+	double t0 = monotime_secs();
+	uint64_t count = engine_perft(engine->game, depth);
+	fprintf(engine->out, "perft %" PRIu64 " nodes %" PRIu64 " time %.3f\n", depth, count, monotime_secs() - t0);
+	return true;
+}
+
+static bool engine_cmd_search(struct engine_t *engine, char **saveptr) {
+	struct search_params_t params = {
+		.strategy = engine->params->strategy,
+		.iterative = true,
+		.ttable = engine->params->ttable,
+	};
+	bool limited = false;
+	const char *limit;
+	while ((limit = strtok_r(NULL, ENGINE_TOKEN_SEPARATORS, saveptr))) {
+		uint64_t value;
+		if (!engine_parse_uint(strtok_r(NULL, ENGINE_TOKEN_SEPARATORS, saveptr), &value)) {
+			return engine_error(engine, "invalid limit");
+		}
+		if (!strcmp(limit, "depth")) {
+			params.depth = value;
+		} else if (!strcmp(limit, "nodes")) {
+			params.node_budget = value;
+		} else if (!strcmp(limit, "time")) {
+			params.time_budget = value / 1000.;
+		} else {
+			return engine_error(engine, "unknown limit");
+		}
+		limited = true;
+	}
+	if (!limited) {
+		params.depth = engine->params->search_depth;
+		params.node_budget = engine->params->node_budget;
+	}
+
+	struct search_result_t result;
+	double t0 = monotime_secs();
+	if (!search_best_action(engine->game, &params, &result)) {
+		return engine_error(engine, "no legal action");
+	}
+	char action_str[ACTION_STRING_MAXLEN];
+	action_to_string(action_str, sizeof(action_str), &result.best_action);
+	fprintf(engine->out, "bestaction %s score %g depth %u nodes %" PRIu64 " time %.3f\n", action_str, result.score, result.depth, result.nodes, monotime_secs() - t0);
+	return true;
+}
+
+static bool engine_cmd_isready(struct engine_t *engine, char **saveptr) {
+	return true;
+}
+
+static bool engine_cmd_quit(struct engine_t *engine, char **saveptr) {
+	engine->quit = true;
+	return true;
+}
+
+static const struct engine_command_t {
+	const char *name;
+	bool (*handler)(struct engine_t *engine, char **saveptr);
+} engine_commands[] = {
+	{ "new", engine_cmd_new },
+	{ "position", engine_cmd_position },
+	{ "show", engine_cmd_show },
+	{ "apply", engine_cmd_apply },
+	{ "actions", engine_cmd_actions },
+	{ "evaluate", engine_cmd_evaluate },
+	{ "perft", engine_cmd_perft },
+	{ "search", engine_cmd_search },
+	{ "isready", engine_cmd_isready },
+	{ "quit", engine_cmd_quit },
+	{ 0 }
+};
+
+static void engine_execute(struct engine_t *engine, char *line) {
+	char *saveptr;
+	const char *name = strtok_r(line, ENGINE_TOKEN_SEPARATORS, &saveptr);
+	if (!name || (name[0] == '#')) {
+		/* Empty lines and comments get no answer */
+		return;
+	}
+	const struct engine_command_t *command;
+	for (command = engine_commands; command->name; command++) {
+		if (!strcmp(command->name, name)) {
+			break;
+		}
+	}
+	if (!command->name) {
+		engine_error(engine, "unknown command");
+	} else if (command->handler(engine, &saveptr)) {
+		fprintf(engine->out, "ok\n");
+	}
+	fflush(engine->out);
+}
+
+/* Runs until "quit" or the end of the input */
+bool engine_run(const struct engine_params_t *params, FILE *in, FILE *out) {
+	struct engine_t engine = {
+		.params = params,
+		.game = game_init(params->n),
+		.out = out,
+	};
+	if (!engine.game) {
+		fprintf(stderr, "Cannot play on a board of size %u.\n", params->n);
+		return false;
+	}
+
+	char *line = NULL;
+	size_t line_size = 0;
+	while (!engine.quit && (getline(&line, &line_size, in) != -1)) {
+		engine_execute(&engine, line);
+	}
+	free(line);
+	game_free(engine.game);
+	return true;
+}
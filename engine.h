@@ -0,0 +1,65 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __ENGINE_H__
+#define __ENGINE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "strategy.h"
+#include "ttable.h"
+
+/* A long-lived engine that reads one command per line and answers every
+ * command with zero or more result lines followed by either "ok" or
+ * "error <reason>". The game with its topology tables and the transposition
+ * table stay alive between commands. Commands:
+ *
+ *   new                      Reset to the starting position
+ *   position <tiles> <side>  Set up a position, see position_to_string
+ *   show                     Print the current position and its hash
+ *   apply <action> ...       Perform one or more legal actions in order; on an
+ *                            illegal one, those before it stay applied
+ *   actions                  List all legal actions
+ *   evaluate                 Print the features and static evaluation
+ *   perft <depth>            Count the action sequences of that length
+ *   search [depth plies] [nodes count] [time ms]
+ *                            Search with iterative deepening
+ *   isready                  Do nothing, synchronizes with the caller
+ *   quit                     Leave the engine loop
+ */
+struct engine_params_t {
+	uint8_t n;
+	const struct strategy_t *strategy;
+	struct ttable_t *ttable;
+
+	/* Limits of a search command that does not give any */
+	unsigned int search_depth;
+	uint64_t node_budget;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+uint64_t engine_perft(struct game_t *game, unsigned int depth);
+bool engine_run(const struct engine_params_t *params, FILE *in, FILE *out);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,268 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "evaluation.h"
+#include "distance.h"
+#include "stats.h"
+
+/* Cost bound for height-aware distances; a piece that needs more than that
+ * is as good as stuck */
+#define HEIGHT_DISTANCE_BOUND(n)	(8 * (n))
+
+/* Minimum distance reported for a side without pieces */
+#define NO_PIECE_DISTANCE			1000
+
+static const char *feature_names[FEATURE_USED_COUNT] = {
+	[FEATURE_WON] = "won",
+	[FEATURE_THREATENED] = "threatened",
+	[FEATURE_MIN_DISTANCE] = "min_distance",
+	[FEATURE_SUM_DISTANCE] = "sum_distance",
+	[FEATURE_PIECES] = "pieces",
+	[FEATURE_MOBILITY] = "mobility",
+	[FEATURE_HEIGHT_HOME] = "height_home",
+	[FEATURE_HEIGHT_EQUATOR] = "height_equator",
+	[FEATURE_HEIGHT_AWAY] = "height_away",
+	[FEATURE_ACTIONS] = "actions",
+};
+
+static int feature_piece_distance(const struct game_t *game, enum distance_metric_t metric, enum side_t side, const uint8_t *height_distances, unsigned int tile) {
+	if (metric == DISTANCE_PATH) {
+		return game->goal_distances[side][tile];
+	} else if (metric == DISTANCE_HEIGHT) {
+		return height_distances[tile];
+	} else {
+		int target_row = (side == TRENCH) ? 0 : ((game->n * 2) - 2);
+		int distance = target_row - (int)game->canpos[tile].row_number;
+		return (distance < 0) ? -distance : distance;
+	}
+}
+
+/* Height profile bands seen from a side: rows next to its own base, the
+ * equator, and rows next to the enemy base. */
+static enum feature_t feature_height_band(const struct game_t *game, enum side_t side, unsigned int tile) {
+	const unsigned int equator = game->n - 1;
+	const unsigned int row = game->canpos[tile].row_number;
+	if (row == equator) {
+		return FEATURE_HEIGHT_EQUATOR;
+	}
+	/* Trench sits at the bottom, i.e., south of the equator */
+	bool south = row > equator;
+	return (south == (side == TRENCH)) ? FEATURE_HEIGHT_HOME : FEATURE_HEIGHT_AWAY;
+}
+
+/* The features that contribute to an evaluation with the given weights */
+uint32_t evaluation_feature_mask(const struct feature_vector_t *weights) {
+	uint32_t mask = 0;
+	for (int i = 0; i < FEATURE_USED_COUNT; i++) {
+		if (weights->values[i] != 0) {
+			mask |= FEATURE_BIT(i);
+		}
+	}
+	return mask;
+}
+
+/* Extracts the features of both sides in a single pass over the board and
+ * stores their difference, seen from the side to move. Feature groups that
+ * have no bit in feature_mask are skipped and left at zero; pieces and the
+ * won flag are cheap and always computed. */
+void evaluation_extract_features(struct game_t *game, enum distance_metric_t metric, uint32_t feature_mask, struct feature_vector_t *features) {
+	STATS_INC(STATS_EVALUATIONS);
+	const unsigned int tile_count = NUMBER_TILES(game->n);
+	const uint8_t *tiles = game->board->tiles;
+	struct feature_vector_t sides[2] = { 0 };
+	const bool want_heights = feature_mask & (FEATURE_BIT(FEATURE_HEIGHT_HOME) | FEATURE_BIT(FEATURE_HEIGHT_EQUATOR) | FEATURE_BIT(FEATURE_HEIGHT_AWAY));
+	const bool want_distances = feature_mask & (FEATURE_BIT(FEATURE_MIN_DISTANCE) | FEATURE_BIT(FEATURE_SUM_DISTANCE));
+	const bool want_mobility = feature_mask & FEATURE_BIT(FEATURE_MOBILITY);
+	uint8_t height_distances[2][tile_count];
+	if (want_distances && (metric == DISTANCE_HEIGHT)) {
+		distance_height_table(game, TRENCH, height_distances[TRENCH], HEIGHT_DISTANCE_BOUND(game->n));
+		distance_height_table(game, CLIMB, height_distances[CLIMB], HEIGHT_DISTANCE_BOUND(game->n));
+	}
+
+	int min_distance[2] = { NO_PIECE_DISTANCE, NO_PIECE_DISTANCE };
+	for (unsigned int i = 0; i < tile_count; i++) {
+		const uint8_t tile = tiles[i];
+		if (!want_heights) {
+			/* Height profile not needed */
+		} else if ((tile == EMPTY_TRENCH) || (tile == PIECE_TRENCH)) {
+			sides[TRENCH].values[feature_height_band(game, TRENCH, i)] += 1;
+		} else if ((tile == EMPTY_CLIMB) || (tile == PIECE_CLIMB)) {
+			sides[CLIMB].values[feature_height_band(game, CLIMB, i)] += 1;
+		}
+		if ((tile != PIECE_TRENCH) && (tile != PIECE_CLIMB)) {
+			continue;
+		}
+
+		const enum side_t side = (tile == PIECE_TRENCH) ? TRENCH : CLIMB;
+		const uint8_t own_empty = (side == TRENCH) ? EMPTY_TRENCH : EMPTY_CLIMB;
+		const uint8_t enemy_base = (side == TRENCH) ? CANONICAL_LOCFLAG_CLIMB_BASE : CANONICAL_LOCFLAG_TRENCH_BASE;
+		struct feature_vector_t *own = &sides[side];
+
+		own->values[FEATURE_PIECES] += 1;
+		if (game->canpos[i].loc_flags & enemy_base) {
+			own->values[FEATURE_WON] = 1;
+		}
+
+		if (want_distances) {
+			int distance = feature_piece_distance(game, metric, side, height_distances[side], i);
+			if (distance < min_distance[side]) {
+				min_distance[side] = distance;
+			}
+			own->values[FEATURE_SUM_DISTANCE] += distance;
+		}
+
+		/* A piece can move onto every adjacent empty tile of its own height */
+		if (want_mobility) {
+			for (unsigned int j = 0; j < game->canpos[i].adjacent_count; j++) {
+				own->values[FEATURE_MOBILITY] += (tiles[game->canpos[i].adjacent_tiles[j]] == own_empty);
+			}
+		}
+	}
+
+	/* Second winning condition: all enemies captured. Threatened pieces are
+	 * maintained by the game itself and legal actions are counted without
+	 * enumerating them. */
+	for (int side = 0; side < 2; side++) {
+		if (want_distances) {
+			sides[side].values[FEATURE_MIN_DISTANCE] = min_distance[side];
+		}
+		sides[side].values[FEATURE_THREATENED] = game->threatened_counts[side];
+		if (feature_mask & FEATURE_BIT(FEATURE_ACTIONS)) {
+			sides[side].values[FEATURE_ACTIONS] = game_count_actions(game, side);
+		}
+		if (sides[!side].values[FEATURE_PIECES] == 0) {
+			sides[side].values[FEATURE_WON] = 1;
+		}
+	}
+
+	const enum side_t us = game->side_turn;
+	const enum side_t them = (us == TRENCH) ? CLIMB : TRENCH;
+	for (int i = 0; i < FEATURE_LANE_COUNT; i++) {
+		features->lanes[i] = sides[us].lanes[i] - sides[them].lanes[i];
+	}
+}
+
+float evaluation_dot(const struct feature_vector_t *weights, const struct feature_vector_t *features) {
+	feature_lane_t sum = weights->lanes[0] * features->lanes[0];
+	for (int i = 1; i < FEATURE_LANE_COUNT; i++) {
+		sum += weights->lanes[i] * features->lanes[i];
+	}
+	float result = 0;
+	for (int i = 0; i < FEATURE_LANES; i++) {
+		result += sum[i];
+	}
+	return result;
+}
+
+/* The weights the engine always played with: a large bonus for a won
+ * position and penalties for the distance of pieces to the enemy base. */
+void evaluation_default_weights(struct feature_vector_t *weights) {
+	memset(weights, 0, sizeof(struct feature_vector_t));
+	weights->values[FEATURE_WON] = 1000;
+	weights->values[FEATURE_MIN_DISTANCE] = -10;
+	weights->values[FEATURE_SUM_DISTANCE] = -3;
+}
+
+bool evaluation_lookup_feature(const char *name, enum feature_t *feature) {
+	for (int i = 0; i < FEATURE_USED_COUNT; i++) {
+		if (!strcmp(feature_names[i], name)) {
+			*feature = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Weight files are text with one "name value" pair per line; '#' starts a
+ * comment. Features that are not listed get a weight of zero. */
+bool evaluation_load_weights(const char *filename, struct feature_vector_t *weights) {
+	FILE *f = fopen(filename, "r");
+	if (!f) {
+		perror(filename);
+		return false;
+	}
+
+	memset(weights, 0, sizeof(struct feature_vector_t));
+	char line[256];
+	unsigned int line_number = 0;
+	bool success = true;
+	while (success && fgets(line, sizeof(line), f)) {
+		line_number++;
+		char *comment = strchr(line, '#');
+		if (comment) {
+			*comment = 0;
+		}
+
+		char name[64];
+		float value;
+		int consumed = 0;
+		int fields = sscanf(line, " %63s %f %n", name, &value, &consumed);
+		if (fields == EOF) {
+			/* Blank or comment only */
+			continue;
+		}
+		enum feature_t feature;
+		if ((fields != 2) || (line[consumed] != 0)) {
+			fprintf(stderr, "%s:%u: expected feature name and weight\n", filename, line_number);
+			success = false;
+		} else if (!evaluation_lookup_feature(name, &feature)) {
+			fprintf(stderr, "%s:%u: unknown feature: %s\n", filename, line_number, name);
+			success = false;
+		} else {
+			weights->values[feature] = value;
+		}
+	}
+	fclose(f);
+	return success;
+}
+
+/* Writes all weights in the format evaluation_load_weights reads. The file
+ * is replaced atomically so that an interrupted write never leaves a
+ * truncated weights file behind. */
+bool evaluation_save_weights(const char *filename, const struct feature_vector_t *weights) {
+	char tmp_filename[256];
+	snprintf(tmp_filename, sizeof(tmp_filename), "%s.new", filename);
+	FILE *f = fopen(tmp_filename, "w");
+	if (!f) {
+		perror(tmp_filename);
+		return false;
+	}
+	bool success = true;
+	for (int i = 0; i < FEATURE_USED_COUNT; i++) {
+		success = (fprintf(f, "%s %.9g\n", feature_names[i], weights->values[i]) > 0) && success;
+	}
+	success = !fflush(f) && !fsync(fileno(f)) && success;
+	success = !fclose(f) && success;
+	if (!success || rename(tmp_filename, filename)) {
+		perror(filename);
+		unlink(tmp_filename);
+		return false;
+	}
+	return true;
+}
+
+const char *evaluation_feature_name(enum feature_t feature) {
+	return (feature < FEATURE_USED_COUNT) ? feature_names[feature] : NULL;
+}
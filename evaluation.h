@@ -0,0 +1,84 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __EVALUATION_H__
+#define __EVALUATION_H__
+
+#include "game.h"
+
+/* Terms of the linear evaluation. Every feature is the difference between
+ * the side to move and its enemy, so that the evaluation is the dot product
+ * of the feature vector with the weights. New features are appended here
+ * and get a name in evaluation.c; the vector is padded to a fixed length so
+ * that the dot product does not depend on the number of terms in use. */
+enum feature_t {
+	FEATURE_WON,
+	FEATURE_THREATENED,
+	FEATURE_MIN_DISTANCE,
+	FEATURE_SUM_DISTANCE,
+	FEATURE_PIECES,
+	FEATURE_MOBILITY,
+	FEATURE_HEIGHT_HOME,
+	FEATURE_HEIGHT_EQUATOR,
+	FEATURE_HEIGHT_AWAY,
+	FEATURE_ACTIONS,
+	FEATURE_USED_COUNT,
+};
+
+#define FEATURE_COUNT			16
+#define FEATURE_BIT(feature)	(1u << (feature))
+#define FEATURE_MASK_ALL		(FEATURE_BIT(FEATURE_USED_COUNT) - 1)
+#define FEATURE_LANES			4
+#define FEATURE_LANE_COUNT		(FEATURE_COUNT / FEATURE_LANES)
+
+typedef float feature_lane_t __attribute__((vector_size(FEATURE_LANES * sizeof(float))));
+
+/* Used both for extracted features and for the weights they are evaluated
+ * against; unused entries are always zero. */
+struct feature_vector_t {
+	union {
+		float values[FEATURE_COUNT];
+		feature_lane_t lanes[FEATURE_LANE_COUNT];
+	};
+};
+
+/* How the distance of a piece to the enemy base is measured: steps over the
+ * adjacency graph from a precomputed table, plain row difference, or moves
+ * plus builds needed given the current tile heights. */
+enum distance_metric_t {
+	DISTANCE_PATH,
+	DISTANCE_ROWS,
+	DISTANCE_HEIGHT,
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+uint32_t evaluation_feature_mask(const struct feature_vector_t *weights);
+void evaluation_extract_features(struct game_t *game, enum distance_metric_t metric, uint32_t feature_mask, struct feature_vector_t *features);
+float evaluation_dot(const struct feature_vector_t *weights, const struct feature_vector_t *features);
+void evaluation_default_weights(struct feature_vector_t *weights);
+bool evaluation_lookup_feature(const char *name, enum feature_t *feature);
+bool evaluation_load_weights(const char *filename, struct feature_vector_t *weights);
+bool evaluation_save_weights(const char *filename, const struct feature_vector_t *weights);
+const char *evaluation_feature_name(enum feature_t feature);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
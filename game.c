@@ -26,10 +26,32 @@
 #include <stdbool.h>
 #include <string.h>
 #include "game.h"
+#include "rng.h"
+#include "distance.h"
+#include "stats.h"
+
+#define ZOBRIST_SEED		0x1507a7b5eedULL
+#define ZOBRIST_SIDE_KEY(game)	((game)->zobrist_keys[NUMBER_TILES((game)->n) * TILE_STATE_COUNT])
+
+/* Build pruning: relevant tiles are near pieces; all other tiles of the same
+ * height are interchangeable as far as the pieces are concerned, so only the
+ * first one of each height stands in for them. */
+struct build_filter_t {
+	struct tile_mask_t relevant;
+	struct tile_mask_t representatives;
+	struct tile_mask_t candidates;
+};
 
 struct first_move_ctx {
-	void (*action_callback)(struct game_t *game, const struct action_t *action, void *vctx);
+	bool (*action_callback)(struct game_t *game, const struct action_t *action, void *vctx);
 	void *action_ctx;
+	const struct build_filter_t *filter;
+	bool emitted;
+};
+
+struct capture_ctx {
+	bool (*capture_callback)(struct game_t *game, const struct move_t *move, void *vctx);
+	void *capture_ctx;
 };
 
 struct second_move_ctx {
@@ -46,52 +68,126 @@ static bool are_tiles_adjacent(const struct game_t *game, unsigned int index1, u
 	return false;
 }
 
+static inline uint64_t zobrist_key(const struct game_t *game, unsigned int tile_index, uint8_t tile) {
+	return game->zobrist_keys[(tile_index * TILE_STATE_COUNT) + tile];
+}
+
+static inline bool is_piece(uint8_t tile) {
+	return (tile == PIECE_TRENCH) || (tile == PIECE_CLIMB);
+}
+
+/* Every piece attacks its adjacent tiles. When a piece enters or leaves a
+ * tile, the attack counts of its neighbors change and an enemy neighbor may
+ * become (or stop being) threatened, i.e., attacked twice. The piece itself
+ * is threatened when its tile is attacked twice by the enemy. */
+static void add_piece_attacks(struct game_t *game, unsigned int tile_index, enum side_t side) {
+	const enum side_t enemy = (side == TRENCH) ? CLIMB : TRENCH;
+	const uint8_t enemy_piece = (side == TRENCH) ? PIECE_CLIMB : PIECE_TRENCH;
+	uint8_t *attacks = game->attack_counts[side];
+	for (int i = 0; i < game->canpos[tile_index].adjacent_count; i++) {
+		unsigned int adjacent_tile_index = game->canpos[tile_index].adjacent_tiles[i];
+		attacks[adjacent_tile_index]++;
+		if ((attacks[adjacent_tile_index] == 2) && (game->board->tiles[adjacent_tile_index] == enemy_piece)) {
+			game->threatened_counts[enemy]++;
+		}
+	}
+	if (game->attack_counts[enemy][tile_index] >= 2) {
+		game->threatened_counts[side]++;
+	}
+}
+
+static void remove_piece_attacks(struct game_t *game, unsigned int tile_index, enum side_t side) {
+	const enum side_t enemy = (side == TRENCH) ? CLIMB : TRENCH;
+	const uint8_t enemy_piece = (side == TRENCH) ? PIECE_CLIMB : PIECE_TRENCH;
+	uint8_t *attacks = game->attack_counts[side];
+	for (int i = 0; i < game->canpos[tile_index].adjacent_count; i++) {
+		unsigned int adjacent_tile_index = game->canpos[tile_index].adjacent_tiles[i];
+		if ((attacks[adjacent_tile_index] == 2) && (game->board->tiles[adjacent_tile_index] == enemy_piece)) {
+			game->threatened_counts[enemy]--;
+		}
+		attacks[adjacent_tile_index]--;
+	}
+	if (game->attack_counts[enemy][tile_index] >= 2) {
+		game->threatened_counts[side]--;
+	}
+}
+
+static inline void set_tile(struct game_t *game, unsigned int tile_index, uint8_t new_tile) {
+	uint8_t *tile = &game->board->tiles[tile_index];
+	game->hash ^= zobrist_key(game, tile_index, *tile) ^ zobrist_key(game, tile_index, new_tile);
+	if (is_piece(*tile)) {
+		remove_piece_attacks(game, tile_index, (*tile == PIECE_TRENCH) ? TRENCH : CLIMB);
+	}
+	*tile = new_tile;
+	if (is_piece(new_tile)) {
+		add_piece_attacks(game, tile_index, (new_tile == PIECE_TRENCH) ? TRENCH : CLIMB);
+	}
+}
+
+/* Recomputes attack and threat counts after the board was changed other than
+ * through set_tile */
+static void game_compute_attacks(struct game_t *game) {
+	memset(game->attack_counts[TRENCH], 0, 2 * NUMBER_TILES(game->n));
+	game->threatened_counts[TRENCH] = 0;
+	game->threatened_counts[CLIMB] = 0;
+	for (int i = 0; i < NUMBER_TILES(game->n); i++) {
+		if (is_piece(game->board->tiles[i])) {
+			uint8_t *attacks = game->attack_counts[(game->board->tiles[i] == PIECE_TRENCH) ? TRENCH : CLIMB];
+			for (int j = 0; j < game->canpos[i].adjacent_count; j++) {
+				attacks[game->canpos[i].adjacent_tiles[j]]++;
+			}
+		}
+	}
+	for (int i = 0; i < NUMBER_TILES(game->n); i++) {
+		if ((game->board->tiles[i] == PIECE_TRENCH) && (game->attack_counts[CLIMB][i] >= 2)) {
+			game->threatened_counts[TRENCH]++;
+		} else if ((game->board->tiles[i] == PIECE_CLIMB) && (game->attack_counts[TRENCH][i] >= 2)) {
+			game->threatened_counts[CLIMB]++;
+		}
+	}
+}
+
 static void revert_move(struct game_t *game, const struct move_t *move) {
 	struct board_t *board = game->board;
 	if (move->type == BUILD) {
-		board->tiles[move->src_tile]++;
-		board->tiles[move->dst_tile]--;
+		set_tile(game, move->src_tile, board->tiles[move->src_tile] + 1);
+		set_tile(game, move->dst_tile, board->tiles[move->dst_tile] - 1);
 	} else if (move->type == MOVE) {
 		uint8_t player_piece = (game->side_turn == TRENCH) ? PIECE_TRENCH : PIECE_CLIMB;
 		uint8_t empty_piece = (game->side_turn == TRENCH) ? EMPTY_TRENCH : EMPTY_CLIMB;
-		board->tiles[move->dst_tile] = empty_piece;
-		board->tiles[move->src_tile] = player_piece;
+		set_tile(game, move->dst_tile, empty_piece);
+		set_tile(game, move->src_tile, player_piece);
 	} else if (move->type == CAPTURE) {
 		uint8_t enemy_piece = (game->side_turn == TRENCH) ? PIECE_CLIMB : PIECE_TRENCH;
-		board->tiles[move->dst_tile] = enemy_piece;
+		set_tile(game, move->dst_tile, enemy_piece);
 	}
 }
 
 static void apply_move(struct game_t *game, const struct move_t *move) {
 	struct board_t *board = game->board;
 	if (move->type == BUILD) {
-		board->tiles[move->src_tile]--;
-		board->tiles[move->dst_tile]++;
+		set_tile(game, move->src_tile, board->tiles[move->src_tile] - 1);
+		set_tile(game, move->dst_tile, board->tiles[move->dst_tile] + 1);
 	} else if (move->type == MOVE) {
 		uint8_t player_piece = (game->side_turn == TRENCH) ? PIECE_TRENCH : PIECE_CLIMB;
 		uint8_t empty_piece = (game->side_turn == TRENCH) ? EMPTY_TRENCH : EMPTY_CLIMB;
-		board->tiles[move->dst_tile] = player_piece;
-		board->tiles[move->src_tile] = empty_piece;
+		set_tile(game, move->dst_tile, player_piece);
+		set_tile(game, move->src_tile, empty_piece);
 	} else if (move->type == CAPTURE) {
 		uint8_t empty_enemy_piece = (game->side_turn == TRENCH) ? EMPTY_CLIMB : EMPTY_TRENCH;
-		board->tiles[move->dst_tile] = empty_enemy_piece;
+		set_tile(game, move->dst_tile, empty_enemy_piece);
 	}
 }
 
-static bool tile_surrounded(const struct game_t *game, unsigned int index, uint8_t by_tile) {
-	/* Now look at all adjacent tiles and see if there's a player on there.
-	 * We need at least two.  */
-	int surrounded_by = 0;
-	for (int i = 0; i < game->canpos[index].adjacent_count; i++) {
-		unsigned int adjacent_tile_index = game->canpos[index].adjacent_tiles[i];
-		if (game->board->tiles[adjacent_tile_index] == by_tile) {
-			surrounded_by++;
-			if (surrounded_by == 2) {
-				return true;
-			}
-		}
+uint64_t game_compute_hash(const struct game_t *game) {
+	uint64_t hash = 0;
+	for (int i = 0; i < NUMBER_TILES(game->n); i++) {
+		hash ^= zobrist_key(game, i, game->board->tiles[i]);
 	}
-	return false;
+	if (game->side_turn == CLIMB) {
+		hash ^= ZOBRIST_SIDE_KEY(game);
+	}
+	return hash;
 }
 
 static bool is_move_legal(struct game_t *game, const struct move_t *move) {
@@ -103,11 +199,14 @@ static bool is_move_legal(struct game_t *game, const struct move_t *move) {
 			 * it) */
 			return false;
 		}
-		if ((board->tiles[move->dst_tile] != EMPTY_TRENCH) && (board->tiles[move->src_tile] != EMPTY_NEUTRAL)) {
+		if ((board->tiles[move->dst_tile] != EMPTY_TRENCH) && (board->tiles[move->dst_tile] != EMPTY_NEUTRAL)) {
 			/* Can only move to a tile where's either nothing or neutral (and
 			 * no piece on it).  */
 			return false;
 		}
+		if (move->src_tile == move->dst_tile) {
+			return false;
+		}
 	} else if (move->type == MOVE) {
 		uint8_t player_piece = (player == TRENCH) ? PIECE_TRENCH : PIECE_CLIMB;
 		uint8_t empty_piece = (player == TRENCH) ? EMPTY_TRENCH : EMPTY_CLIMB;
@@ -127,15 +226,13 @@ static bool is_move_legal(struct game_t *game, const struct move_t *move) {
 		}
 	} else if (move->type == CAPTURE) {
 		uint8_t enemy_piece = (player == TRENCH) ? PIECE_CLIMB : PIECE_TRENCH;
-		uint8_t player_piece = (player == TRENCH) ? PIECE_TRENCH : PIECE_CLIMB;
 		if (board->tiles[move->dst_tile] != enemy_piece) {
 			/* There's no enemy on the piece we're trying to capture */
 			return false;
 		}
 
-		/* Now look at all adjacent tiles and see if there's a player on there.
-		 * We need at least two. */
-		if (!tile_surrounded(game, move->dst_tile, player_piece)) {
+		/* The enemy needs to be adjacent to at least two of our pieces */
+		if (game->attack_counts[player][move->dst_tile] < 2) {
 			/* Cannot capture, not surrounded by enough player pieces */
 			return false;
 		}
@@ -155,25 +252,181 @@ bool is_action_legal(struct game_t *game, const struct action_t *action) {
 	return is_legal;
 }
 
+/* Like is_action_legal, but also safe on actions read from files: tiles have
+ * to be on the board and the moves in an order the rules permit (a build
+ * followed by a move, or a capture followed by a build or a move). Unlike
+ * game_action_valid, this does not enumerate all actions. */
+bool is_action_legal_checked(struct game_t *game, const struct action_t *action) {
+	for (int i = 0; i < 2; i++) {
+		if ((action->moves[i].src_tile >= NUMBER_TILES(game->n)) || (action->moves[i].dst_tile >= NUMBER_TILES(game->n))) {
+			return false;
+		}
+	}
+	const enum movetype_t first = action->moves[0].type;
+	const enum movetype_t second = action->moves[1].type;
+	if (!((first == BUILD) && (second == MOVE)) && !((first == CAPTURE) && ((second == BUILD) || (second == MOVE)))) {
+		return false;
+	}
+	return is_action_legal(game, action);
+}
+
+struct valid_action_ctx_t {
+	uint32_t packed_action;
+	bool found;
+};
+
+static bool valid_action_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct valid_action_ctx_t *ctx = (struct valid_action_ctx_t*)vctx;
+	if (game_pack_action(action) == ctx->packed_action) {
+		ctx->found = true;
+		return false;
+	}
+	return true;
+}
+
+/* Unlike is_action_legal, this also accepts actions from untrusted input,
+ * e.g., with tiles off the board or moves in an order the rules do not
+ * permit: the action has to be one of the enumerated ones. */
+bool game_action_valid(struct game_t *game, const struct action_t *action) {
+	for (int i = 0; i < 2; i++) {
+		if ((action->moves[i].src_tile >= NUMBER_TILES(game->n)) || (action->moves[i].dst_tile >= NUMBER_TILES(game->n))) {
+			return false;
+		}
+	}
+	struct valid_action_ctx_t ctx = {
+		.packed_action = game_pack_action(action),
+	};
+	enumerate_valid_actions(game, valid_action_callback, &ctx);
+	return ctx.found;
+}
+
+/* Hands the turn to the other side without changing the board. Searches use
+ * this to recurse from within an enumeration callback, in which the action
+ * has been applied to the board but the side to move is still the mover. */
+void game_pass_turn(struct game_t *game) {
+	game->side_turn = (game->side_turn == TRENCH) ? CLIMB : TRENCH;
+	game->hash ^= ZOBRIST_SIDE_KEY(game);
+}
+
 void game_perform_action(struct game_t *game, const struct action_t *action) {
 	apply_move(game, &action->moves[0]);
 	apply_move(game, &action->moves[1]);
-	game->side_turn = (game->side_turn == TRENCH) ? CLIMB : TRENCH;
+	game_pass_turn(game);
+}
+
+/* Like game_perform_action, but remembers the action so that
+ * game_unmake_action restores the board, side to move, hash and attack
+ * counts exactly. This lets deep traversals walk the tree on a single game
+ * instead of copying or re-creating positions. */
+void game_make_action(struct game_t *game, const struct action_t *action) {
+	if (game->undo_depth == GAME_UNDO_CAPACITY) {
+		fprintf(stderr, "fatal: undo stack of %u actions exhausted.\n", GAME_UNDO_CAPACITY);
+		abort();
+	}
+	game->undo_stack[game->undo_depth++] = *action;
+	game_perform_action(game, action);
+}
+
+void game_unmake_action(struct game_t *game) {
+	if (game->undo_depth == 0) {
+		fprintf(stderr, "fatal: no action to unmake.\n");
+		abort();
+	}
+	const struct action_t *action = &game->undo_stack[--game->undo_depth];
+	game_pass_turn(game);
+	revert_move(game, &action->moves[1]);
+	revert_move(game, &action->moves[0]);
+}
+
+static uint16_t pack_move(const struct move_t *move) {
+	return (move->type << 14) | ((move->src_tile & 0x7f) << 7) | (move->dst_tile & 0x7f);
+}
+
+static void unpack_move(uint16_t packed_move, struct move_t *move) {
+	move->type = (packed_move >> 14) & 0x3;
+	move->src_tile = (packed_move >> 7) & 0x7f;
+	move->dst_tile = packed_move & 0x7f;
+}
+
+uint32_t game_pack_action(const struct action_t *action) {
+	return ((uint32_t)pack_move(&action->moves[0]) << 16) | pack_move(&action->moves[1]);
 }
 
-static void enumerate_valid_moves(struct game_t *game, bool allow_capture, bool allow_build, bool allow_move, void (*enumeration_callback)(struct game_t *game, const struct move_t *move, void *ctx), void *ctx) {
+void game_unpack_action(uint32_t packed_action, struct action_t *action) {
+	unpack_move(packed_action >> 16, &action->moves[0]);
+	unpack_move(packed_action & 0xffff, &action->moves[1]);
+}
+
+/* The side to move is given explicitly so that positions can be packed from
+ * within enumeration callbacks, where the action has been applied but the
+ * turn has not been passed yet. */
+void game_pack_position(const struct game_t *game, enum side_t side_turn, struct packed_position_t *packed) {
+	packed->words[0] = 0;
+	packed->words[1] = (uint64_t)side_turn << 63;
+	for (int i = 0; i < NUMBER_TILES(game->n); i++) {
+		const unsigned int bit = 3 * i;
+		const uint64_t tile = game->board->tiles[i];
+		packed->words[bit / 64] |= tile << (bit % 64);
+		if ((bit % 64) > 61) {
+			/* Tile straddles both words */
+			packed->words[1] |= tile >> (64 - (bit % 64));
+		}
+	}
+}
+
+void game_unpack_position(struct game_t *game, const struct packed_position_t *packed) {
+	for (int i = 0; i < NUMBER_TILES(game->n); i++) {
+		const unsigned int bit = 3 * i;
+		uint64_t tile = packed->words[bit / 64] >> (bit % 64);
+		if ((bit % 64) > 61) {
+			tile |= packed->words[1] << (64 - (bit % 64));
+		}
+		game->board->tiles[i] = tile & 0x7;
+	}
+	game->side_turn = packed->words[1] >> 63;
+	game->hash = game_compute_hash(game);
+	game_compute_attacks(game);
+	game->undo_depth = 0;
+}
+
+static inline void tile_mask_set(struct tile_mask_t *mask, unsigned int tile_index) {
+	mask->words[tile_index / 64] |= 1ULL << (tile_index % 64);
+}
+
+static inline bool tile_mask_test(const struct tile_mask_t *mask, unsigned int tile_index) {
+	return (mask->words[tile_index / 64] >> (tile_index % 64)) & 1;
+}
+
+static inline unsigned int tile_mask_count(const struct tile_mask_t *mask) {
+	return __builtin_popcountll(mask->words[0]) + __builtin_popcountll(mask->words[1]);
+}
+
+static inline unsigned int tile_mask_count_common(const struct tile_mask_t *a, const struct tile_mask_t *b) {
+	return __builtin_popcountll(a->words[0] & b->words[0]) + __builtin_popcountll(a->words[1] & b->words[1]);
+}
+
+/* Enumeration callbacks return true to continue enumeration or false to stop
+ * it early (e.g., on a search cutoff). The enumeration functions return false
+ * when they have been stopped.
+ *
+ * With a filter, builds are only enumerated if both tiles are candidates and
+ * at least one of them is relevant. */
+static bool enumerate_valid_moves(struct game_t *game, bool allow_capture, bool allow_build, bool allow_move, const struct build_filter_t *filter, bool (*enumeration_callback)(struct game_t *game, const struct move_t *move, void *ctx), void *ctx) {
 	/* First determine if there's pieces that can be captured */
-	if (allow_capture) {
+	const enum side_t enemy = (game->side_turn == TRENCH) ? CLIMB : TRENCH;
+	if (allow_capture && game->threatened_counts[enemy]) {
 		uint8_t enemy_piece = (game->side_turn == TRENCH) ? PIECE_CLIMB : PIECE_TRENCH;
-		uint8_t player_piece = (game->side_turn == TRENCH) ? PIECE_TRENCH : PIECE_CLIMB;
+		const uint8_t *attacks = game->attack_counts[game->side_turn];
 		for (int i = 0; i < NUMBER_TILES(game->n); i++) {
-			if ((game->board->tiles[i] == enemy_piece) && tile_surrounded(game, i, player_piece)) {
+			if ((game->board->tiles[i] == enemy_piece) && (attacks[i] >= 2)) {
 				/* Yes! Capture is possible. */
 				struct move_t move = {
 					.type = CAPTURE,
 					.dst_tile = i,
 				};
-				enumeration_callback(game, &move, ctx);
+				if (!enumeration_callback(game, &move, ctx)) {
+					return false;
+				}
 			}
 		}
 	}
@@ -184,13 +437,18 @@ static void enumerate_valid_moves(struct game_t *game, bool allow_capture, bool
 			if ((game->board->tiles[src] == EMPTY_NEUTRAL) || (game->board->tiles[src] == EMPTY_CLIMB)) {
 				for (int dst = 0; dst < NUMBER_TILES(game->n); dst++) {
 					if (((game->board->tiles[dst] == EMPTY_NEUTRAL) || (game->board->tiles[dst] == EMPTY_TRENCH)) && (src != dst)) {
+						if (filter && (!tile_mask_test(&filter->candidates, src) || !tile_mask_test(&filter->candidates, dst) || (!tile_mask_test(&filter->relevant, src) && !tile_mask_test(&filter->relevant, dst)))) {
+							continue;
+						}
 						/* Have a valid build move. */
 						struct move_t move = {
 							.type = BUILD,
 							.src_tile = src,
 							.dst_tile = dst,
 						};
-						enumeration_callback(game, &move, ctx);
+						if (!enumeration_callback(game, &move, ctx)) {
+							return false;
+						}
 					}
 				}
 			}
@@ -213,23 +471,29 @@ static void enumerate_valid_moves(struct game_t *game, bool allow_capture, bool
 							.src_tile = src,
 							.dst_tile = adjacent_tile_index,
 						};
-						enumeration_callback(game, &move, ctx);
+						if (!enumeration_callback(game, &move, ctx)) {
+							return false;
+						}
 					}
 				}
 			}
 		}
 	}
+	return true;
 }
 
-static void second_move_callback(struct game_t *game, const struct move_t *move, void *vctx) {
+static bool second_move_callback(struct game_t *game, const struct move_t *move, void *vctx) {
 	struct second_move_ctx *ctx = (struct second_move_ctx*)vctx;
 	ctx->action.moves[1] = *move;
+	ctx->first->emitted = true;
+	STATS_INC((ctx->action.moves[0].type == BUILD) ? STATS_ACTIONS_BUILD_MOVE : (move->type == BUILD) ? STATS_ACTIONS_CAPTURE_BUILD : STATS_ACTIONS_CAPTURE_MOVE);
 	apply_move(game, move);
-	ctx->first->action_callback(game, &ctx->action, ctx->first->action_ctx);
+	bool continue_enumeration = ctx->first->action_callback(game, &ctx->action, ctx->first->action_ctx);
 	revert_move(game, move);
+	return continue_enumeration;
 }
 
-static void first_move_callback(struct game_t *game, const struct move_t *move, void *vctx) {
+static bool first_move_callback(struct game_t *game, const struct move_t *move, void *vctx) {
 	struct first_move_ctx *ctx = (struct first_move_ctx*)vctx;
 
 	/* We have just enumerated all possible first moves */
@@ -237,27 +501,233 @@ static void first_move_callback(struct game_t *game, const struct move_t *move,
 		.first = ctx,
 	};
 	second_ctx.action.moves[0] = *move;
+	bool continue_enumeration = true;
 	apply_move(game, move);
 	if (move->type == BUILD) {
 		/* If first was a build move, second must be movement move. */
-		enumerate_valid_moves(game, false, false, true, second_move_callback, &second_ctx);
+		continue_enumeration = enumerate_valid_moves(game, false, false, true, NULL, second_move_callback, &second_ctx);
 	} else if (move->type == CAPTURE) {
 		/* If first was a build move, second can be either build or movement
 		 * move. */
-		enumerate_valid_moves(game, false, true, true, second_move_callback, &second_ctx);
+		continue_enumeration = enumerate_valid_moves(game, false, true, true, ctx->filter, second_move_callback, &second_ctx);
 	}
 	revert_move(game, move);
+	return continue_enumeration;
 }
 
-void enumerate_valid_actions(struct game_t *game, void (*enumeration_callback)(struct game_t *game, const struct action_t *action, void *vctx), void *vctx) {
+bool enumerate_valid_actions(struct game_t *game, bool (*enumeration_callback)(struct game_t *game, const struct action_t *action, void *vctx), void *vctx) {
 	struct first_move_ctx ctx = {
 		.action_callback = enumeration_callback,
 		.action_ctx = vctx,
 	};
-	enumerate_valid_moves(game, true, true, false, first_move_callback, &ctx);
+	return enumerate_valid_moves(game, true, true, false, NULL, first_move_callback, &ctx);
+}
+
+static bool capture_move_callback(struct game_t *game, const struct move_t *move, void *vctx) {
+	struct capture_ctx *ctx = (struct capture_ctx*)vctx;
+	apply_move(game, move);
+	bool continue_enumeration = ctx->capture_callback(game, move, ctx->capture_ctx);
+	revert_move(game, move);
+	return continue_enumeration;
+}
+
+/* Enumerates the captures of the side to move on their own, i.e., without
+ * the move that has to follow them. Like actions, each capture is applied
+ * while the callback runs and the side to move is unchanged. */
+bool enumerate_captures(struct game_t *game, bool (*capture_callback)(struct game_t *game, const struct move_t *move, void *vctx), void *vctx) {
+	struct capture_ctx ctx = {
+		.capture_callback = capture_callback,
+		.capture_ctx = vctx,
+	};
+	return enumerate_valid_moves(game, true, false, false, NULL, capture_move_callback, &ctx);
+}
+
+/* Tiles that builds may touch when pruning: everything within radius steps
+ * of any piece, plus every tile on a shortest path of the leading pieces of
+ * either side to the enemy base. Paths of all pieces together would cover
+ * most of the board. */
+static void game_relevant_tiles(const struct game_t *game, unsigned int radius, struct tile_mask_t *relevant) {
+	struct tile_mask_t pieces[2] = { 0 };
+	struct tile_mask_t leading[2] = { 0 };
+	uint8_t leading_distance[2] = { UINT8_MAX, UINT8_MAX };
+	for (int i = 0; i < NUMBER_TILES(game->n); i++) {
+		if ((game->board->tiles[i] != PIECE_TRENCH) && (game->board->tiles[i] != PIECE_CLIMB)) {
+			continue;
+		}
+		const enum side_t side = (game->board->tiles[i] == PIECE_TRENCH) ? TRENCH : CLIMB;
+		tile_mask_set(&pieces[side], i);
+		if (game->goal_distances[side][i] < leading_distance[side]) {
+			leading_distance[side] = game->goal_distances[side][i];
+			leading[side] = (struct tile_mask_t) { 0 };
+		}
+		if (game->goal_distances[side][i] == leading_distance[side]) {
+			tile_mask_set(&leading[side], i);
+		}
+	}
+
+	*relevant = (struct tile_mask_t) {
+		.words = {
+			pieces[TRENCH].words[0] | pieces[CLIMB].words[0],
+			pieces[TRENCH].words[1] | pieces[CLIMB].words[1],
+		},
+	};
+	for (unsigned int step = 0; step < radius; step++) {
+		struct tile_mask_t expanded = *relevant;
+		for (int word = 0; word < 2; word++) {
+			uint64_t bits = relevant->words[word];
+			while (bits) {
+				const struct tile_mask_t *adjacent = &game->adjacent_masks[(64 * word) + __builtin_ctzll(bits)];
+				expanded.words[0] |= adjacent->words[0];
+				expanded.words[1] |= adjacent->words[1];
+				bits &= bits - 1;
+			}
+		}
+		*relevant = expanded;
+	}
+
+	/* Walk down the goal distances from the leading pieces */
+	for (int side = 0; side < 2; side++) {
+		const uint8_t *goal_distances = game->goal_distances[side];
+		struct tile_mask_t frontier = leading[side];
+		while (frontier.words[0] | frontier.words[1]) {
+			struct tile_mask_t next = { 0 };
+			for (int word = 0; word < 2; word++) {
+				uint64_t bits = frontier.words[word];
+				while (bits) {
+					const unsigned int tile_index = (64 * word) + __builtin_ctzll(bits);
+					for (int i = 0; i < game->canpos[tile_index].adjacent_count; i++) {
+						const unsigned int adjacent_tile_index = game->canpos[tile_index].adjacent_tiles[i];
+						if (goal_distances[adjacent_tile_index] + 1 == goal_distances[tile_index]) {
+							tile_mask_set(&next, adjacent_tile_index);
+						}
+					}
+					bits &= bits - 1;
+				}
+			}
+			relevant->words[0] |= next.words[0];
+			relevant->words[1] |= next.words[1];
+			frontier = next;
+		}
+	}
+}
+
+static unsigned int game_count_builds(const struct tile_mask_t masks[static 3], const struct tile_mask_t *within) {
+	const unsigned int neutral = tile_mask_count_common(&masks[EMPTY_NEUTRAL], within);
+	const unsigned int sources = neutral + tile_mask_count_common(&masks[EMPTY_CLIMB], within);
+	const unsigned int destinations = neutral + tile_mask_count_common(&masks[EMPTY_TRENCH], within);
+	return (sources * destinations) - neutral;
+}
+
+static void game_build_filter(const struct game_t *game, unsigned int radius, struct build_filter_t *filter, uint64_t *kept, uint64_t *total) {
+	game_relevant_tiles(game, radius, &filter->relevant);
+	filter->representatives = (struct tile_mask_t) { 0 };
+	struct tile_mask_t masks[3] = { 0 };
+	for (int i = 0; i < NUMBER_TILES(game->n); i++) {
+		const uint8_t tile = game->board->tiles[i];
+		if (tile <= EMPTY_CLIMB) {
+			if (!tile_mask_test(&filter->relevant, i) && !tile_mask_count_common(&masks[tile], &filter->representatives)) {
+				tile_mask_set(&filter->representatives, i);
+			}
+			tile_mask_set(&masks[tile], i);
+		}
+	}
+	filter->candidates = (struct tile_mask_t) {
+		.words = {
+			filter->relevant.words[0] | filter->representatives.words[0],
+			filter->relevant.words[1] | filter->representatives.words[1],
+		},
+	};
+
+	const struct tile_mask_t all = { .words = { ~0ULL, ~0ULL } };
+	*total = game_count_builds(masks, &all);
+	*kept = game_count_builds(masks, &filter->candidates) - game_count_builds(masks, &filter->representatives);
+}
+
+/* Like enumerate_valid_actions, but only builds that touch a relevant tile
+ * (see game_relevant_tiles) are emitted, and their other tile must be
+ * relevant as well or stand in for all irrelevant tiles of its height.
+ * Captures and moves are never pruned. Should pruning leave no action at all,
+ * every action is enumerated instead. The game's prune statistics account for
+ * the builds that were kept. */
+bool enumerate_relevant_actions(struct game_t *game, unsigned int build_radius, bool (*enumeration_callback)(struct game_t *game, const struct action_t *action, void *vctx), void *vctx) {
+	struct build_filter_t filter;
+	uint64_t kept, total;
+	game_build_filter(game, build_radius, &filter, &kept, &total);
+	game->prune_stats.nodes++;
+	game->prune_stats.builds_kept += kept;
+	game->prune_stats.builds_total += total;
+
+	struct first_move_ctx ctx = {
+		.action_callback = enumeration_callback,
+		.action_ctx = vctx,
+		.filter = &filter,
+	};
+	bool completed = enumerate_valid_moves(game, true, true, false, &filter, first_move_callback, &ctx);
+	if (completed && !ctx.emitted) {
+		return enumerate_valid_actions(game, enumeration_callback, vctx);
+	}
+	return completed;
+}
+
+/* Counts the legal actions of a side as if it were to move, without
+ * enumerating them. With N, T and C the sets of empty neutral, trench and
+ * climb tiles, builds go from S = N + C to D = N + T, so there are
+ * |S| |D| - |N| of them. Every build is followed by one of the M moves
+ * onto own-height tiles, except that the build changes the height of its
+ * two tiles: for trench, a neutral source opens up the moves of the pieces
+ * adjacent to it and a trench destination closes them; for climb, a climb
+ * source closes and a neutral destination opens them. Summing this over
+ * all builds only needs the number of own pieces adjacent to each of N, T
+ * and C. A capture is followed by any build (with the captured tile added
+ * to S or D respectively) or by any of the M moves, as the emptied tile has
+ * enemy height. */
+unsigned int game_count_actions(const struct game_t *game, enum side_t side) {
+	struct tile_mask_t masks[TILE_STATE_COUNT] = { 0 };
+	for (int i = 0; i < NUMBER_TILES(game->n); i++) {
+		tile_mask_set(&masks[game->board->tiles[i]], i);
+	}
+
+	/* For each empty tile class, the number of (own piece, adjacent tile)
+	 * pairs */
+	const struct tile_mask_t *pieces = &masks[(side == TRENCH) ? PIECE_TRENCH : PIECE_CLIMB];
+	int adjacent_neutral = 0, adjacent_trench = 0, adjacent_climb = 0;
+	for (int word = 0; word < 2; word++) {
+		uint64_t bits = pieces->words[word];
+		while (bits) {
+			const unsigned int tile_index = (64 * word) + __builtin_ctzll(bits);
+			const struct tile_mask_t *adjacent = &game->adjacent_masks[tile_index];
+			adjacent_neutral += tile_mask_count_common(adjacent, &masks[EMPTY_NEUTRAL]);
+			adjacent_trench += tile_mask_count_common(adjacent, &masks[EMPTY_TRENCH]);
+			adjacent_climb += tile_mask_count_common(adjacent, &masks[EMPTY_CLIMB]);
+			bits &= bits - 1;
+		}
+	}
+
+	const int neutral = tile_mask_count(&masks[EMPTY_NEUTRAL]);
+	const int sources = neutral + tile_mask_count(&masks[EMPTY_CLIMB]);
+	const int destinations = neutral + tile_mask_count(&masks[EMPTY_TRENCH]);
+	const int builds = (sources * destinations) - neutral;
+	int moves, build_moves, capture_builds;
+	if (side == TRENCH) {
+		moves = adjacent_trench;
+		build_moves = (builds * moves) + ((destinations - 1) * adjacent_neutral) - (sources * adjacent_trench);
+		capture_builds = ((sources + 1) * destinations) - neutral;
+	} else {
+		moves = adjacent_climb;
+		build_moves = (builds * moves) - (destinations * adjacent_climb) + ((sources - 1) * adjacent_neutral);
+		capture_builds = (sources * (destinations + 1)) - neutral;
+	}
+	const int captures = game->threatened_counts[(side == TRENCH) ? CLIMB : TRENCH];
+	return build_moves + (captures * (capture_builds + moves));
+}
+
+/* True if the enemy of the given side could capture one of its pieces */
+bool game_piece_threatened(const struct game_t *game, enum side_t side) {
+	return game->threatened_counts[side] != 0;
 }
 
 bool game_won_by(struct game_t *game, enum side_t player) {
+	STATS_INC(STATS_WIN_CHECKS);
 	uint8_t enemy_piece = (player == TRENCH) ? PIECE_CLIMB : PIECE_TRENCH;
 	uint8_t player_piece = (player == TRENCH) ? PIECE_TRENCH : PIECE_CLIMB;
 	uint8_t enemy_base = (player == TRENCH) ? CANONICAL_LOCFLAG_CLIMB_BASE : CANONICAL_LOCFLAG_TRENCH_BASE;
@@ -277,11 +747,31 @@ bool game_won_by(struct game_t *game, enum side_t player) {
 	return enemy_count == 0;
 }
 
+void game_reset(struct game_t *game) {
+	board_reset(game->board);
+	game->side_turn = CLIMB;
+	game->hash = game_compute_hash(game);
+	game_compute_attacks(game);
+	game->undo_depth = 0;
+}
+
+void game_set_position(struct game_t *game, const uint8_t *tiles, enum side_t side_turn) {
+	memcpy(game->board->tiles, tiles, NUMBER_TILES(game->n));
+	game->side_turn = side_turn;
+	game->hash = game_compute_hash(game);
+	game_compute_attacks(game);
+	game->undo_depth = 0;
+}
+
 struct game_t* game_init(uint8_t n) {
 	struct game_t *result = calloc(1, sizeof(struct game_t));
 	if (!result) {
 		return NULL;
 	}
+	if (n > TILE_MASK_MAX_N) {
+		free(result);
+		return NULL;
+	}
 	result->n = n;
 	result->canpos = malloc(sizeof(struct canonical_position_t) * NUMBER_TILES(n));
 	if (!result->canpos) {
@@ -294,14 +784,57 @@ struct game_t* game_init(uint8_t n) {
 		free(result);
 		return NULL;
 	}
+	const unsigned int key_count = (NUMBER_TILES(n) * TILE_STATE_COUNT) + 1;
+	result->zobrist_keys = malloc(sizeof(uint64_t) * key_count);
+	if (!result->zobrist_keys) {
+		board_free(result->board);
+		free(result->canpos);
+		free(result);
+		return NULL;
+	}
 	for (int i = 0; i < NUMBER_TILES(n); i++) {
 		tile_index_to_canonical_pos(i, n, &result->canpos[i]);
 	}
+	result->goal_distances[TRENCH] = malloc(2 * NUMBER_TILES(n));
+	result->attack_counts[TRENCH] = malloc(2 * NUMBER_TILES(n));
+	result->adjacent_masks = calloc(NUMBER_TILES(n), sizeof(struct tile_mask_t));
+	result->undo_stack = malloc(sizeof(struct action_t) * GAME_UNDO_CAPACITY);
+	if (!result->goal_distances[TRENCH] || !result->attack_counts[TRENCH] || !result->adjacent_masks || !result->undo_stack) {
+		free(result->undo_stack);
+		free(result->adjacent_masks);
+		free(result->attack_counts[TRENCH]);
+		free(result->goal_distances[TRENCH]);
+		free(result->zobrist_keys);
+		board_free(result->board);
+		free(result->canpos);
+		free(result);
+		return NULL;
+	}
+	result->goal_distances[CLIMB] = result->goal_distances[TRENCH] + NUMBER_TILES(n);
+	result->attack_counts[CLIMB] = result->attack_counts[TRENCH] + NUMBER_TILES(n);
+	for (int i = 0; i < NUMBER_TILES(n); i++) {
+		for (int j = 0; j < result->canpos[i].adjacent_count; j++) {
+			tile_mask_set(&result->adjacent_masks[i], result->canpos[i].adjacent_tiles[j]);
+		}
+	}
+	distance_goal_table(result, TRENCH, result->goal_distances[TRENCH]);
+	distance_goal_table(result, CLIMB, result->goal_distances[CLIMB]);
+	uint64_t seed = ZOBRIST_SEED + n;
+	for (unsigned int i = 0; i < key_count; i++) {
+		result->zobrist_keys[i] = rng_splitmix64(&seed);
+	}
 	result->side_turn = CLIMB;
+	result->hash = game_compute_hash(result);
+	game_compute_attacks(result);
 	return result;
 }
 
 void game_free(struct game_t *game) {
+	free(game->undo_stack);
+	free(game->adjacent_masks);
+	free(game->attack_counts[TRENCH]);
+	free(game->goal_distances[TRENCH]);
+	free(game->zobrist_keys);
 	board_free(game->board);
 	free(game->canpos);
 	free(game);
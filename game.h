@@ -43,23 +43,95 @@ struct action_t {
 	struct move_t moves[2];
 };
 
+/* Packed positions store every tile in 3 bits, the side to move is the
+ * topmost bit. This fits boards of up to 42 tiles, i.e., Iso-Path(4). Unlike
+ * the Zobrist hash, packing is lossless. */
+#define PACKED_POSITION_MAX_N	4
+struct packed_position_t {
+	uint64_t words[2];
+};
+
+/* Packed actions hold two 16-bit moves, each consisting of 2 bits move type
+ * and 7 bits each for source and destination tile. This limits packing to
+ * boards with at most 128 tiles, i.e., Iso-Path(7). */
+#define PACKED_ACTION_MAX_N		7
+
+/* Sets of tiles as bitmasks. Two words cover every board that actions can
+ * be packed for, which is also the largest board the engine plays on. */
+#define TILE_MASK_MAX_N			PACKED_ACTION_MAX_N
+struct tile_mask_t {
+	uint64_t words[2];
+};
+
+/* Effect of build pruning, accumulated over all pruned enumerations */
+struct prune_stats_t {
+	uint64_t nodes;
+	uint64_t builds_kept;
+	uint64_t builds_total;
+};
+
 enum side_t {
 	TRENCH,
 	CLIMB,
 };
 
+/* Capacity of the undo stack, i.e., the number of plies that can be made
+ * with game_make_action before unmaking any of them */
+#define GAME_UNDO_CAPACITY		1024
+
 struct game_t {
 	uint8_t n;
 	enum side_t side_turn;
 	struct canonical_position_t *canpos;
 	struct board_t *board;
+
+	/* Zobrist hash of board and side to move, kept up to date by every
+	 * move that is applied or reverted. */
+	uint64_t hash;
+	uint64_t *zobrist_keys;
+
+	/* Per side and tile, the number of steps to the enemy base over the
+	 * adjacency graph, ignoring tile heights. */
+	uint8_t *goal_distances[2];
+
+	/* Per side and tile, the number of adjacent pieces of that side, and per
+	 * side the number of its pieces that are attacked by at least two enemy
+	 * pieces and can therefore be captured. Kept up to date like the hash. */
+	uint8_t *attack_counts[2];
+	unsigned int threatened_counts[2];
+
+	/* Per tile, the mask of its adjacent tiles */
+	struct tile_mask_t *adjacent_masks;
+
+	/* Actions performed by game_make_action that game_unmake_action can
+	 * take back. Setting up a position clears it. */
+	struct action_t *undo_stack;
+	unsigned int undo_depth;
+
+	struct prune_stats_t prune_stats;
 };
 
 /*************** AUTO GENERATED SECTION FOLLOWS ***************/
+uint64_t game_compute_hash(const struct game_t *game);
 bool is_action_legal(struct game_t *game, const struct action_t *action);
+bool is_action_legal_checked(struct game_t *game, const struct action_t *action);
+bool game_action_valid(struct game_t *game, const struct action_t *action);
+void game_pass_turn(struct game_t *game);
 void game_perform_action(struct game_t *game, const struct action_t *action);
-void enumerate_valid_actions(struct game_t *game, void (*enumeration_callback)(struct game_t *game, const struct action_t *action, void *vctx), void *vctx);
+void game_make_action(struct game_t *game, const struct action_t *action);
+void game_unmake_action(struct game_t *game);
+uint32_t game_pack_action(const struct action_t *action);
+void game_unpack_action(uint32_t packed_action, struct action_t *action);
+void game_pack_position(const struct game_t *game, enum side_t side_turn, struct packed_position_t *packed);
+void game_unpack_position(struct game_t *game, const struct packed_position_t *packed);
+bool enumerate_valid_actions(struct game_t *game, bool (*enumeration_callback)(struct game_t *game, const struct action_t *action, void *vctx), void *vctx);
+bool enumerate_captures(struct game_t *game, bool (*capture_callback)(struct game_t *game, const struct move_t *move, void *vctx), void *vctx);
+bool enumerate_relevant_actions(struct game_t *game, unsigned int build_radius, bool (*enumeration_callback)(struct game_t *game, const struct action_t *action, void *vctx), void *vctx);
+unsigned int game_count_actions(const struct game_t *game, enum side_t side);
+bool game_piece_threatened(const struct game_t *game, enum side_t side);
 bool game_won_by(struct game_t *game, enum side_t player);
+void game_reset(struct game_t *game);
+void game_set_position(struct game_t *game, const uint8_t *tiles, enum side_t side_turn);
 struct game_t* game_init(uint8_t n);
 void game_free(struct game_t *game);
 /***************  AUTO GENERATED SECTION ENDS   ***************/
@@ -0,0 +1,237 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "gamerecord.h"
+
+struct gamerecord_writer_t *gamerecord_writer_open(const char *filename) {
+	struct gamerecord_writer_t *writer = calloc(1, sizeof(struct gamerecord_writer_t));
+	if (!writer) {
+		return NULL;
+	}
+	writer->fd = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if (writer->fd == -1) {
+		perror(filename);
+		free(writer);
+		return NULL;
+	}
+	pthread_mutex_init(&writer->lock, NULL);
+	return writer;
+}
+
+static void gamerecord_store_strategy(struct gamerecord_strategy_t *stored, const struct strategy_t *strategy) {
+	*stored = (struct gamerecord_strategy_t) {
+		.distance_metric = strategy->distance_metric,
+		.build_mode = strategy->build_mode,
+		.uses_book = (strategy->book != NULL),
+		.build_radius = strategy->build_radius,
+		.quiescence_depth = strategy->quiescence_depth,
+		.search_depth = strategy->search_depth,
+		.move_time = strategy->move_time,
+		.move_nodes = (strategy->move_nodes > UINT32_MAX) ? UINT32_MAX : strategy->move_nodes,
+	};
+	memcpy(stored->weights, strategy->weights.values, sizeof(stored->weights));
+}
+
+/* The record is written to a file opened with O_APPEND while holding the
+ * writer's lock, so records of concurrent threads never interleave. A
+ * record normally goes out in a single write(); only if that is cut short
+ * (e.g., by a signal) is the rest written separately, in which case a
+ * concurrent writer in another process could interleave. */
+bool gamerecord_append(struct gamerecord_writer_t *writer, uint8_t n, enum side_t first_side, const struct strategy_t *first_strategy, const struct strategy_t *second_strategy, const struct history_t *history, enum game_result_t result) {
+	/* The first history entry is the starting position without action */
+	const unsigned int ply_count = history->length ? history->length - 1 : 0;
+	const size_t record_size = sizeof(struct gamerecord_header_t) + (sizeof(uint32_t) * ply_count);
+	uint8_t *record = malloc(record_size);
+	if (!record) {
+		return false;
+	}
+
+	struct gamerecord_header_t *header = (struct gamerecord_header_t*)record;
+	*header = (struct gamerecord_header_t) {
+		.magic = GAMERECORD_MAGIC,
+		.version = GAMERECORD_VERSION,
+		.n = n,
+		.first_side = first_side,
+		.result = result,
+		.ply_count = ply_count,
+	};
+	gamerecord_store_strategy(&header->strategies[0], first_strategy);
+	gamerecord_store_strategy(&header->strategies[1], second_strategy);
+
+	uint32_t *actions = (uint32_t*)(record + sizeof(struct gamerecord_header_t));
+	for (unsigned int i = 0; i < ply_count; i++) {
+		actions[i] = game_pack_action(&history->entries[i + 1].action);
+	}
+
+	bool success = true;
+	size_t written = 0;
+	pthread_mutex_lock(&writer->lock);
+	while (written < record_size) {
+		ssize_t result_size = write(writer->fd, record + written, record_size - written);
+		if (result_size < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("gamerecord: write");
+			success = false;
+			break;
+		}
+		written += result_size;
+	}
+	pthread_mutex_unlock(&writer->lock);
+	free(record);
+	return success;
+}
+
+void gamerecord_writer_close(struct gamerecord_writer_t *writer) {
+	if (!writer) {
+		return;
+	}
+	close(writer->fd);
+	pthread_mutex_destroy(&writer->lock);
+	free(writer);
+}
+
+struct gamerecord_reader_t *gamerecord_reader_open(const char *filename) {
+	struct gamerecord_reader_t *reader = calloc(1, sizeof(struct gamerecord_reader_t));
+	if (!reader) {
+		return NULL;
+	}
+	reader->file = mmapfile_open(filename, false);
+	if (!reader->file) {
+		free(reader);
+		return NULL;
+	}
+	return reader;
+}
+
+static void gamerecord_start(const struct gamerecord_header_t *header, struct game_t *game) {
+	game_reset(game);
+	game->side_turn = header->first_side;
+	game->hash = game_compute_hash(game);
+}
+
+/* Records come from files and are not trusted: the header has to be sane and
+ * every action has to be legal when replayed, so that replaying never runs
+ * off the board. Checking each action on its own is much cheaper than
+ * enumerating all actions of every ply. */
+static bool gamerecord_validate(struct gamerecord_reader_t *reader, const struct gamerecord_header_t *header, const uint32_t *actions) {
+	if ((header->n < 2) || (header->n > PACKED_ACTION_MAX_N)) {
+		return false;
+	}
+	if (((header->first_side != TRENCH) && (header->first_side != CLIMB)) || (header->result > RESULT_DRAW)) {
+		return false;
+	}
+	if (!reader->game || (reader->game->n != header->n)) {
+		if (reader->game) {
+			game_free(reader->game);
+		}
+		reader->game = game_init(header->n);
+		if (!reader->game) {
+			return false;
+		}
+	}
+
+	struct game_t *game = reader->game;
+	gamerecord_start(header, game);
+	for (unsigned int i = 0; i < header->ply_count; i++) {
+		if (game_won_by(game, TRENCH) || game_won_by(game, CLIMB)) {
+			return false;
+		}
+		struct action_t action;
+		game_unpack_action(actions[i], &action);
+		if (!is_action_legal_checked(game, &action)) {
+			return false;
+		}
+		game_perform_action(game, &action);
+	}
+	return true;
+}
+
+void gamerecord_reader_rewind(struct gamerecord_reader_t *reader) {
+	reader->offset = 0;
+}
+
+/* Returns the next record of the file, pointing directly into the mapping.
+ * Returns false at the end of the file or if the file is truncated, corrupt
+ * or holds an illegal game at the current offset. */
+bool gamerecord_next(struct gamerecord_reader_t *reader, struct gamerecord_t *record) {
+	const size_t remaining = reader->file->length - reader->offset;
+	if (remaining < sizeof(struct gamerecord_header_t)) {
+		return false;
+	}
+	const uint8_t *data = (const uint8_t*)reader->file->data + reader->offset;
+	const struct gamerecord_header_t *header = (const struct gamerecord_header_t*)data;
+	if ((header->magic != GAMERECORD_MAGIC) || (header->version != GAMERECORD_VERSION)) {
+		fprintf(stderr, "gamerecord: bad record header at offset %zu.\n", reader->offset);
+		return false;
+	}
+	const size_t record_size = sizeof(struct gamerecord_header_t) + (sizeof(uint32_t) * header->ply_count);
+	if (remaining < record_size) {
+		fprintf(stderr, "gamerecord: truncated record at offset %zu.\n", reader->offset);
+		return false;
+	}
+	const uint32_t *actions = (const uint32_t*)(data + sizeof(struct gamerecord_header_t));
+	if (!gamerecord_validate(reader, header, actions)) {
+		fprintf(stderr, "gamerecord: invalid record at offset %zu.\n", reader->offset);
+		return false;
+	}
+	record->header = header;
+	record->actions = actions;
+	reader->offset += record_size;
+	return true;
+}
+
+/* Replays a record on the given game, which must have been initialized with
+ * the same n. The callback (if any) is invoked once for the starting position
+ * (with ply 0 and no action) and then after every action. */
+void gamerecord_replay(const struct gamerecord_t *record, struct game_t *game, void (*replay_callback)(struct game_t *game, unsigned int ply, const struct action_t *action, void *vctx), void *vctx) {
+	gamerecord_start(record->header, game);
+	if (replay_callback) {
+		replay_callback(game, 0, NULL, vctx);
+	}
+	for (unsigned int i = 0; i < record->header->ply_count; i++) {
+		struct action_t action;
+		game_unpack_action(record->actions[i], &action);
+		game_perform_action(game, &action);
+		if (replay_callback) {
+			replay_callback(game, i + 1, &action, vctx);
+		}
+	}
+}
+
+void gamerecord_reader_close(struct gamerecord_reader_t *reader) {
+	if (!reader) {
+		return;
+	}
+	if (reader->game) {
+		game_free(reader->game);
+	}
+	mmapfile_close(reader->file);
+	free(reader);
+}
@@ -0,0 +1,95 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __GAMERECORD_H__
+#define __GAMERECORD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "game.h"
+#include "history.h"
+#include "strategy.h"
+#include "mmapfile.h"
+
+#define GAMERECORD_MAGIC		0x52475049		/* "IPGR" */
+#define GAMERECORD_VERSION		2
+
+/* Everything about a strategy that affects how it plays, so that a game can
+ * be attributed to the exact settings that produced it. The node budget is
+ * saturated at UINT32_MAX. */
+struct gamerecord_strategy_t {
+	float weights[FEATURE_COUNT];
+	uint8_t distance_metric;
+	uint8_t build_mode;
+	uint8_t uses_book;
+	uint8_t reserved;
+	uint32_t build_radius;
+	uint32_t quiescence_depth;
+	uint32_t search_depth;
+	float move_time;
+	uint32_t move_nodes;
+};
+
+/* A record file is a plain concatenation of records. Every record is a
+ * header followed by ply_count packed actions (see game_pack_action). All
+ * fields are 32-bit aligned, so records can be accessed in place. The first
+ * strategy is the one that made the first move. */
+struct gamerecord_header_t {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t n;
+	uint8_t first_side;
+	uint8_t result;
+	uint32_t ply_count;
+	struct gamerecord_strategy_t strategies[2];
+};
+
+struct gamerecord_t {
+	const struct gamerecord_header_t *header;
+	const uint32_t *actions;
+};
+
+struct gamerecord_writer_t {
+	int fd;
+	pthread_mutex_t lock;
+};
+
+struct gamerecord_reader_t {
+	struct mmapfile_t *file;
+	size_t offset;
+	/* Scratch game that records are validated on */
+	struct game_t *game;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+struct gamerecord_writer_t *gamerecord_writer_open(const char *filename);
+bool gamerecord_append(struct gamerecord_writer_t *writer, uint8_t n, enum side_t first_side, const struct strategy_t *first_strategy, const struct strategy_t *second_strategy, const struct history_t *history, enum game_result_t result);
+void gamerecord_writer_close(struct gamerecord_writer_t *writer);
+struct gamerecord_reader_t *gamerecord_reader_open(const char *filename);
+void gamerecord_reader_rewind(struct gamerecord_reader_t *reader);
+bool gamerecord_next(struct gamerecord_reader_t *reader, struct gamerecord_t *record);
+void gamerecord_replay(const struct gamerecord_t *record, struct game_t *game, void (*replay_callback)(struct game_t *game, unsigned int ply, const struct action_t *action, void *vctx), void *vctx);
+void gamerecord_reader_close(struct gamerecord_reader_t *reader);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdlib.h>
+#include <string.h>
+#include "history.h"
+
+struct history_t *history_init(unsigned int initial_capacity) {
+	struct history_t *result = calloc(1, sizeof(struct history_t));
+	if (!result) {
+		return NULL;
+	}
+	if (initial_capacity < 16) {
+		initial_capacity = 16;
+	}
+	result->entries = malloc(sizeof(struct history_entry_t) * initial_capacity);
+	if (!result->entries) {
+		free(result);
+		return NULL;
+	}
+	result->capacity = initial_capacity;
+	return result;
+}
+
+void history_clear(struct history_t *history) {
+	history->length = 0;
+}
+
+bool history_push(struct history_t *history, uint64_t hash, const struct action_t *action) {
+	if (history->length == history->capacity) {
+		unsigned int new_capacity = history->capacity * 2;
+		struct history_entry_t *new_entries = realloc(history->entries, sizeof(struct history_entry_t) * new_capacity);
+		if (!new_entries) {
+			return false;
+		}
+		history->entries = new_entries;
+		history->capacity = new_capacity;
+	}
+	struct history_entry_t *entry = &history->entries[history->length++];
+	entry->hash = hash;
+	if (action) {
+		entry->action = *action;
+	} else {
+		memset(&entry->action, 0, sizeof(struct action_t));
+	}
+	return true;
+}
+
+void history_pop(struct history_t *history) {
+	if (history->length) {
+		history->length--;
+	}
+}
+
+unsigned int history_occurrences(const struct history_t *history, uint64_t hash) {
+	/* The side to move is part of the hash, so a position can only recur
+	 * every other ply. Scan backwards from the most recent entry that has
+	 * the same side to move as the one we're looking for. */
+	unsigned int occurrences = 0;
+	if (history->length == 0) {
+		return 0;
+	}
+	for (int i = history->length - 1; i >= 0; i -= 2) {
+		if (history->entries[i].hash == hash) {
+			occurrences++;
+		}
+	}
+	return occurrences;
+}
+
+void history_free(struct history_t *history) {
+	if (!history) {
+		return;
+	}
+	free(history->entries);
+	free(history);
+}
@@ -0,0 +1,52 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __HISTORY_H__
+#define __HISTORY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game.h"
+
+/* Entry i holds the position hash after ply i and the action that led there;
+ * entry 0 is the starting position and carries no action. */
+struct history_entry_t {
+	uint64_t hash;
+	struct action_t action;
+};
+
+struct history_t {
+	unsigned int length;
+	unsigned int capacity;
+	struct history_entry_t *entries;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+struct history_t *history_init(unsigned int initial_capacity);
+void history_clear(struct history_t *history);
+bool history_push(struct history_t *history, uint64_t hash, const struct action_t *action);
+void history_pop(struct history_t *history);
+unsigned int history_occurrences(const struct history_t *history, uint64_t hash);
+void history_free(struct history_t *history);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
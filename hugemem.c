@@ -0,0 +1,208 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "hugemem.h"
+#include "parallel.h"
+
+/* Large, randomly probed tables. The mapping is first attempted from the
+ * hugetlbfs pool; when no huge pages are reserved there, an ordinary
+ * anonymous mapping is aligned to the huge page size and advised to be backed
+ * by transparent huge pages. Which backing the kernel actually used is read
+ * back from /proc/self/smaps after prefaulting, since MADV_HUGEPAGE is merely
+ * a hint. */
+
+#define HUGEMEM_DEFAULT_HUGE_PAGE	(2 * 1024 * 1024)
+
+struct hugemem_prefault_ctx_t {
+	struct hugemem_t *mem;
+	unsigned int thread_count;
+};
+
+/* Accepts a plain number of MiB or a number with one of the suffixes K, M, G
+ * or T. Returns zero for malformed input. */
+size_t hugemem_parse_size(const char *str) {
+	char *end;
+	unsigned long long value = strtoull(str, &end, 10);
+	if (end == str) {
+		return 0;
+	}
+	unsigned int shift = 20;
+	switch (toupper((unsigned char)*end)) {
+		case 'K':	shift = 10; end++; break;
+		case 'M':	shift = 20; end++; break;
+		case 'G':	shift = 30; end++; break;
+		case 'T':	shift = 40; end++; break;
+	}
+
+	/* "M", "MB" and "MiB" all mean 2^20 */
+	if (toupper((unsigned char)*end) == 'I') {
+		end++;
+	}
+	if (toupper((unsigned char)*end) == 'B') {
+		end++;
+	}
+	return *end ? 0 : (size_t)(value << shift);
+}
+
+/* Largest power of two not exceeding length. */
+size_t hugemem_round_pow2(size_t length) {
+	if (length == 0) {
+		return 0;
+	}
+	size_t result = 1;
+	while (result <= length / 2) {
+		result *= 2;
+	}
+	return result;
+}
+
+const char *hugemem_backing_to_string(enum hugemem_backing_t backing) {
+	switch (backing) {
+		case HUGEMEM_HUGETLB:		return "hugetlbfs";
+		case HUGEMEM_TRANSPARENT:	return "transparent huge";
+		case HUGEMEM_DEFAULT:		return "default";
+	}
+	return "?";
+}
+
+static size_t hugemem_huge_page_size(void) {
+	FILE *f = fopen("/proc/meminfo", "r");
+	if (!f) {
+		return HUGEMEM_DEFAULT_HUGE_PAGE;
+	}
+	char line[128];
+	size_t result = HUGEMEM_DEFAULT_HUGE_PAGE;
+	while (fgets(line, sizeof(line), f)) {
+		unsigned long kib;
+		if (sscanf(line, "Hugepagesize: %lu kB", &kib) == 1) {
+			result = (size_t)kib * 1024;
+			break;
+		}
+	}
+	fclose(f);
+	return result;
+}
+
+/* Returns the number of bytes of the mapping that are backed by transparent
+ * huge pages. */
+static size_t hugemem_anon_huge_bytes(const struct hugemem_t *mem) {
+	FILE *f = fopen("/proc/self/smaps", "r");
+	if (!f) {
+		return 0;
+	}
+	char line[256];
+	bool in_mapping = false;
+	size_t result = 0;
+	while (fgets(line, sizeof(line), f)) {
+		unsigned long start, end;
+		if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+			in_mapping = (start < (unsigned long)mem->data + mem->length) && (end > (unsigned long)mem->data);
+			continue;
+		}
+		unsigned long kib;
+		if (in_mapping && (sscanf(line, "AnonHugePages: %lu kB", &kib) == 1)) {
+			result += (size_t)kib * 1024;
+		}
+	}
+	fclose(f);
+	return result;
+}
+
+static void hugemem_prefault_thread(unsigned int thread_id, void *vctx) {
+	struct hugemem_prefault_ctx_t *ctx = (struct hugemem_prefault_ctx_t*)vctx;
+	const size_t pages = ctx->mem->length / ctx->mem->page_size;
+	const size_t first = pages * thread_id / ctx->thread_count;
+	const size_t last = pages * (thread_id + 1) / ctx->thread_count;
+	volatile uint8_t *data = (volatile uint8_t*)ctx->mem->data;
+	for (size_t page = first; page < last; page++) {
+		data[page * ctx->mem->page_size] = 0;
+	}
+}
+
+/* Maps length bytes of zeroed memory, backed by huge pages if the system
+ * allows. With prefault_threads > 0, every page is touched up front by that
+ * many threads so that the first probes do not take page faults. */
+bool hugemem_alloc(struct hugemem_t *mem, size_t length, unsigned int prefault_threads) {
+	const size_t huge_page_size = hugemem_huge_page_size();
+	*mem = (struct hugemem_t) { 0 };
+
+	if ((length % huge_page_size) == 0) {
+		void *data = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (data != MAP_FAILED) {
+			*mem = (struct hugemem_t) {
+				.data = data,
+				.length = length,
+				.page_size = huge_page_size,
+				.backing = HUGEMEM_HUGETLB,
+			};
+		}
+	}
+	if (!mem->data) {
+		/* Over-allocate so that the table can start on a huge page
+		 * boundary, then give back what is not needed */
+		const size_t map_length = length + huge_page_size;
+		uint8_t *data = mmap(NULL, map_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (data == MAP_FAILED) {
+			perror("mmap");
+			return false;
+		}
+		uint8_t *aligned = (uint8_t*)(((uintptr_t)data + huge_page_size - 1) & ~(uintptr_t)(huge_page_size - 1));
+		if (aligned != data) {
+			munmap(data, aligned - data);
+		}
+		munmap(aligned + length, (data + map_length) - (aligned + length));
+		madvise(aligned, length, MADV_HUGEPAGE);
+		*mem = (struct hugemem_t) {
+			.data = aligned,
+			.length = length,
+			.page_size = sysconf(_SC_PAGESIZE),
+			.backing = HUGEMEM_DEFAULT,
+		};
+	}
+
+	if (prefault_threads) {
+		struct hugemem_prefault_ctx_t ctx = {
+			.mem = mem,
+			.thread_count = prefault_threads,
+		};
+		parallel_run(prefault_threads, hugemem_prefault_thread, &ctx);
+	}
+	if ((mem->backing == HUGEMEM_DEFAULT) && (hugemem_anon_huge_bytes(mem) > 0)) {
+		mem->backing = HUGEMEM_TRANSPARENT;
+		mem->page_size = huge_page_size;
+	}
+	return true;
+}
+
+void hugemem_free(struct hugemem_t *mem) {
+	if (mem->data) {
+		munmap(mem->data, mem->length);
+		mem->data = NULL;
+	}
+}
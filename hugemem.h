@@ -0,0 +1,50 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __HUGEMEM_H__
+#define __HUGEMEM_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+
+enum hugemem_backing_t {
+	HUGEMEM_HUGETLB,
+	HUGEMEM_TRANSPARENT,
+	HUGEMEM_DEFAULT,
+};
+
+struct hugemem_t {
+	void *data;
+	size_t length;
+	size_t page_size;
+	enum hugemem_backing_t backing;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+size_t hugemem_parse_size(const char *str);
+size_t hugemem_round_pow2(size_t length);
+const char *hugemem_backing_to_string(enum hugemem_backing_t backing);
+bool hugemem_alloc(struct hugemem_t *mem, size_t length, unsigned int prefault_threads);
+void hugemem_free(struct hugemem_t *mem);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
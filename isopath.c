@@ -21,19 +21,1022 @@
 **/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include "game.h"
 #include "strategy.h"
+#include "trace.h"
+#include "selfplay.h"
+#include "gamerecord.h"
+#include "parallel.h"
+#include "posdb.h"
+#include "notation.h"
+#include "book.h"
+#include "reach.h"
+#include "solve.h"
+#include "shard.h"
+#include "ttable.h"
+#include "engine.h"
+#include "server.h"
+#include "stats.h"
+#include "latency.h"
+#include "match.h"
+#include "tune.h"
+#include "monotime.h"
 
-int main(int argc, char **argv) {
-	struct game_t *game = game_init(4);
+struct options_t {
+	uint8_t n;
+	enum trace_format_t trace_format;
+	const char *trace_filename;
+	struct playout_params_t playout_params;
+	unsigned int game_count;
+	unsigned int thread_count;
+	const char *record_filename;
+	const char *replay_filename;
+	const char *posdb_build_filename;
+	const char *posdb_query_filename;
+	const char *tmpdir;
+	unsigned int memory_mib;
+	const char *book_build_filename;
+	const char *book_filename;
+	unsigned int book_depth;
+	unsigned int book_width;
+	unsigned int search_depth;
+	uint64_t node_budget;
+	size_t hash_bytes;
+	enum distance_metric_t distance_metric;
+	const char *weights_filename;
+	enum build_mode_t build_mode;
+	unsigned int build_radius;
+	unsigned int quiescence_depth;
+	double move_time;
+	uint64_t move_nodes;
+	unsigned int move_depth;
+	bool reach;
+	unsigned int reach_depth;
+	bool solve;
+	bool shard;
+	unsigned int split_depth;
+	const char *checkpoint_filename;
+	unsigned int checkpoint_interval;
+	bool engine;
+	const char *server_socket;
+	bool stats;
+	double stats_interval;
+	const char *stats_filename;
+	bool latency;
+	const char *match_weights_filename;
+	unsigned int match_pairs;
+	double sprt_elo0, sprt_elo1;
+	const char *tune_filename;
+	unsigned int tune_iterations;
+	unsigned int tune_pairs;
+	const char *tune_features;
+	const char **input_filenames;
+	unsigned int input_file_count;
+};
+
+static void syntax(const char *pgmname) {
+	fprintf(stderr, "%s (-n size) (--trace-format none|binary|json) (--trace-file filename)\n", pgmname);
+	fprintf(stderr, "        (--max-plies count) (--repetitions count) (--random-plies count) (--seed seed)\n");
+	fprintf(stderr, "        (--games count) (--threads count) (--record filename) (--replay filename)\n");
+	fprintf(stderr, "        (--posdb-build filename (--tmpdir path) (--memory MiB) [recordfile ...])\n");
+	fprintf(stderr, "        (--posdb-query filename)\n");
+	fprintf(stderr, "        (--book-build filename (--book-depth plies) (--book-width count)) (--book filename)\n");
+	fprintf(stderr, "        (--search-depth plies) (--node-budget count) (--hash size)\n");
+	fprintf(stderr, "        (--distance path|rows|height) (--weights filename)\n");
+	fprintf(stderr, "        (--builds all|relevant (--build-radius steps)) (--quiescence captures)\n");
+	fprintf(stderr, "        (--move-time ms) (--move-nodes count) (--move-depth plies)\n");
+	fprintf(stderr, "        (--reach (--reach-depth plies)) (--solve (--split-depth plies))\n");
+	fprintf(stderr, "        (--checkpoint filename (--checkpoint-interval secs)) (--engine)\n");
+	fprintf(stderr, "        (--server socket) (--stats secs (--stats-file filename)) (--latency)\n");
+	fprintf(stderr, "        (--match filename (--pairs count) (--sprt elo0,elo1))\n");
+	fprintf(stderr, "        (--tune filename (--tune-iterations count) (--tune-pairs count)\n");
+	fprintf(stderr, "        (--tune-features name,...))\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "-n, --size size           Size of the Iso-Path board, defaults to 4.\n");
+	fprintf(stderr, "-t, --trace-format fmt    Format in which every played action is traced, can be\n");
+	fprintf(stderr, "                          one of none, binary or json. Defaults to none.\n");
+	fprintf(stderr, "-o, --trace-file filename File to write the trace to, defaults to stdout.\n");
+	fprintf(stderr, "--max-plies count         Adjudicate a game as draw after this many plies.\n");
+	fprintf(stderr, "                          Zero means unlimited, defaults to 500.\n");
+	fprintf(stderr, "--repetitions count       Adjudicate a game as draw when a position occurs this\n");
+	fprintf(stderr, "                          often. Zero means never, defaults to 3.\n");
+	fprintf(stderr, "--random-plies count      Play this many plies at random at the start of every\n");
+	fprintf(stderr, "                          game. Defaults to 0.\n");
+	fprintf(stderr, "--seed seed               Seed for the random opening plies, defaults to 0.\n");
+	fprintf(stderr, "-g, --games count         Number of self-play games to play, defaults to 1.\n");
+	fprintf(stderr, "-j, --threads count       Number of threads to play on, defaults to the number of\n");
+	fprintf(stderr, "                          CPUs.\n");
+	fprintf(stderr, "-r, --record filename     Append every played game to this game record file.\n");
+	fprintf(stderr, "--replay filename         Do not play, but replay all games of a game record file.\n");
+	fprintf(stderr, "--posdb-build filename    Do not play, but aggregate the positions of all given\n");
+	fprintf(stderr, "                          game record files into a position database.\n");
+	fprintf(stderr, "--tmpdir path             Directory for temporary files, defaults to /tmp.\n");
+	fprintf(stderr, "--memory MiB              Memory to use for sorting, defaults to 256 MiB.\n");
+	fprintf(stderr, "--posdb-query filename    Print position database statistics for the starting\n");
+	fprintf(stderr, "                          position and its successors.\n");
+	fprintf(stderr, "--book-build filename     Do not play, but build an opening book.\n");
+	fprintf(stderr, "--book-depth plies        Number of plies the opening book covers, defaults to 4.\n");
+	fprintf(stderr, "--book-width count        Number of statically best actions that are followed\n");
+	fprintf(stderr, "                          from every book position, defaults to 4.\n");
+	fprintf(stderr, "--book filename           Consult this opening book before searching.\n");
+	fprintf(stderr, "--search-depth plies      Search depth for book positions, defaults to 2.\n");
+	fprintf(stderr, "--node-budget count       Maximum nodes per search, zero means unlimited.\n");
+	fprintf(stderr, "                          Defaults to 1000000.\n");
+	fprintf(stderr, "--hash size               Size of the transposition table used by searches,\n");
+	fprintf(stderr, "                          e.g., 512M or 4G; rounded down to a power of two and\n");
+	fprintf(stderr, "                          backed by huge pages if available. Defaults to none.\n");
+	fprintf(stderr, "--distance metric         How the evaluation measures the distance of pieces to\n");
+	fprintf(stderr, "                          the enemy base: path (steps over the board graph),\n");
+	fprintf(stderr, "                          rows (row difference) or height (moves plus builds on\n");
+	fprintf(stderr, "                          the current board). Defaults to path.\n");
+	fprintf(stderr, "--weights filename        Load the evaluation weights from this file, one\n");
+	fprintf(stderr, "                          \"feature weight\" pair per line. Unlisted features\n");
+	fprintf(stderr, "                          weigh zero. Defaults to built-in weights.\n");
+	fprintf(stderr, "--builds mode             Builds considered when playing and searching: all,\n");
+	fprintf(stderr, "                          or only relevant ones that touch a tile near a piece\n");
+	fprintf(stderr, "                          or on a shortest path of a piece to the enemy base.\n");
+	fprintf(stderr, "                          Defaults to all.\n");
+	fprintf(stderr, "--build-radius steps      Tiles within this many steps of a piece are relevant\n");
+	fprintf(stderr, "                          for --builds relevant, defaults to 1.\n");
+	fprintf(stderr, "--quiescence captures     Play out up to this many captures in a row before\n");
+	fprintf(stderr, "                          evaluating a position. Defaults to 0.\n");
+	fprintf(stderr, "--move-time ms            Instead of choosing moves greedily, search every\n");
+	fprintf(stderr, "                          move with iterative deepening for this long.\n");
+	fprintf(stderr, "--move-nodes count        Like --move-time, but limits the nodes per move.\n");
+	fprintf(stderr, "                          Both limits can be combined.\n");
+	fprintf(stderr, "--move-depth plies        Maximum depth of move searches, defaults to no limit.\n");
+	fprintf(stderr, "--reach                   Do not play, but enumerate all reachable positions\n");
+	fprintf(stderr, "                          breadth-first. Uses --memory, --tmpdir and --threads.\n");
+	fprintf(stderr, "--reach-depth plies       Stop enumeration after this many plies, defaults to\n");
+	fprintf(stderr, "                          unlimited.\n");
+	fprintf(stderr, "--solve                   Do not play, but prove or disprove a forced win for\n");
+	fprintf(stderr, "                          the side to move after --random-plies random plies.\n");
+	fprintf(stderr, "                          Uses --memory for the node table and --node-budget\n");
+	fprintf(stderr, "                          as the maximum number of expansions.\n");
+	fprintf(stderr, "--split-depth plies       Shard the solve at this depth into work units that\n");
+	fprintf(stderr, "                          are solved by --threads worker processes.\n");
+	fprintf(stderr, "--checkpoint filename     Keep the state of --reach or --solve in this file and\n");
+	fprintf(stderr, "                          resume from it if it exists.\n");
+	fprintf(stderr, "--checkpoint-interval secs\n");
+	fprintf(stderr, "                          Sync the solver checkpoint to disk this often,\n");
+	fprintf(stderr, "                          defaults to 60 seconds.\n");
+	fprintf(stderr, "--engine                  Do not play, but run as a persistent engine that\n");
+	fprintf(stderr, "                          reads commands from stdin, one per line. Searches\n");
+	fprintf(stderr, "                          without limits use --search-depth, --node-budget.\n");
+	fprintf(stderr, "--server socket           Do not play, but answer analysis requests of any\n");
+	fprintf(stderr, "                          number of clients on this Unix domain socket with\n");
+	fprintf(stderr, "                          --threads workers until interrupted.\n");
+	fprintf(stderr, "--stats secs              Report performance counters as JSON lines this\n");
+	fprintf(stderr, "                          often, on SIGUSR1 and at exit. Zero only reports on\n");
+	fprintf(stderr, "                          SIGUSR1 and at exit. Needs a build with STATS=1.\n");
+	fprintf(stderr, "--stats-file filename     Write the reports there instead of to stderr.\n");
+	fprintf(stderr, "--latency                 After self-play, print percentiles of the time every\n");
+	fprintf(stderr, "                          move decision took, by ply and by number of actions.\n");
+	fprintf(stderr, "--match filename          Instead of self-play, play pairs of games of the\n");
+	fprintf(stderr, "                          configured strategy against the same strategy with\n");
+	fprintf(stderr, "                          the weights in this file, both from the same random\n");
+	fprintf(stderr, "                          opening (see --random-plies). Stops as soon as a\n");
+	fprintf(stderr, "                          sequential probability ratio test is decided.\n");
+	fprintf(stderr, "--pairs count             Play at most this many pairs, defaults to 10000.\n");
+	fprintf(stderr, "--sprt elo0,elo1          Hypotheses of the test: the configured strategy is\n");
+	fprintf(stderr, "                          elo0 (H0) or elo1 (H1) stronger. Defaults to 0,10.\n");
+	fprintf(stderr, "--tune filename           Instead of self-play, tune the evaluation weights\n");
+	fprintf(stderr, "                          by SPSA, starting from the configured ones. The\n");
+	fprintf(stderr, "                          best weights found are saved to this file, those\n");
+	fprintf(stderr, "                          of the last iteration to filename.final.\n");
+	fprintf(stderr, "--tune-iterations count   Number of SPSA iterations, defaults to 200.\n");
+	fprintf(stderr, "--tune-pairs count        Pairs of games played per iteration, defaults to 8;\n");
+	fprintf(stderr, "                          rounded up to a multiple of the thread count.\n");
+	fprintf(stderr, "--tune-features names     Comma separated features to tune. Defaults to all\n");
+	fprintf(stderr, "                          features with a nonzero initial weight.\n");
+}
+
+static void parse_options(struct options_t *options, int argc, char **argv) {
+	enum {
+		OPT_MAX_PLIES = 1000,
+		OPT_REPETITIONS,
+		OPT_RANDOM_PLIES,
+		OPT_SEED,
+		OPT_REPLAY,
+		OPT_POSDB_BUILD,
+		OPT_POSDB_QUERY,
+		OPT_TMPDIR,
+		OPT_MEMORY,
+		OPT_BOOK_BUILD,
+		OPT_BOOK_DEPTH,
+		OPT_BOOK_WIDTH,
+		OPT_BOOK,
+		OPT_SEARCH_DEPTH,
+		OPT_NODE_BUDGET,
+		OPT_HASH,
+		OPT_DISTANCE,
+		OPT_WEIGHTS,
+		OPT_BUILDS,
+		OPT_BUILD_RADIUS,
+		OPT_QUIESCENCE,
+		OPT_MOVE_TIME,
+		OPT_MOVE_NODES,
+		OPT_MOVE_DEPTH,
+		OPT_REACH,
+		OPT_REACH_DEPTH,
+		OPT_SOLVE,
+		OPT_SPLIT_DEPTH,
+		OPT_CHECKPOINT,
+		OPT_CHECKPOINT_INTERVAL,
+		OPT_ENGINE,
+		OPT_SERVER,
+		OPT_STATS,
+		OPT_STATS_FILE,
+		OPT_LATENCY,
+		OPT_MATCH,
+		OPT_PAIRS,
+		OPT_SPRT,
+		OPT_TUNE,
+		OPT_TUNE_ITERATIONS,
+		OPT_TUNE_PAIRS,
+		OPT_TUNE_FEATURES,
+	};
+	struct option long_options[] = {
+		{ "size",			required_argument, 0, 'n' },
+		{ "trace-format",	required_argument, 0, 't' },
+		{ "trace-file",		required_argument, 0, 'o' },
+		{ "max-plies",		required_argument, 0, OPT_MAX_PLIES },
+		{ "repetitions",	required_argument, 0, OPT_REPETITIONS },
+		{ "random-plies",	required_argument, 0, OPT_RANDOM_PLIES },
+		{ "seed",			required_argument, 0, OPT_SEED },
+		{ "games",			required_argument, 0, 'g' },
+		{ "threads",		required_argument, 0, 'j' },
+		{ "record",			required_argument, 0, 'r' },
+		{ "replay",			required_argument, 0, OPT_REPLAY },
+		{ "posdb-build",	required_argument, 0, OPT_POSDB_BUILD },
+		{ "posdb-query",	required_argument, 0, OPT_POSDB_QUERY },
+		{ "tmpdir",			required_argument, 0, OPT_TMPDIR },
+		{ "memory",			required_argument, 0, OPT_MEMORY },
+		{ "book-build",		required_argument, 0, OPT_BOOK_BUILD },
+		{ "book-depth",		required_argument, 0, OPT_BOOK_DEPTH },
+		{ "book-width",		required_argument, 0, OPT_BOOK_WIDTH },
+		{ "book",			required_argument, 0, OPT_BOOK },
+		{ "search-depth",	required_argument, 0, OPT_SEARCH_DEPTH },
+		{ "node-budget",	required_argument, 0, OPT_NODE_BUDGET },
+		{ "hash",			required_argument, 0, OPT_HASH },
+		{ "distance",		required_argument, 0, OPT_DISTANCE },
+		{ "weights",		required_argument, 0, OPT_WEIGHTS },
+		{ "builds",			required_argument, 0, OPT_BUILDS },
+		{ "build-radius",	required_argument, 0, OPT_BUILD_RADIUS },
+		{ "quiescence",		required_argument, 0, OPT_QUIESCENCE },
+		{ "move-time",		required_argument, 0, OPT_MOVE_TIME },
+		{ "move-nodes",		required_argument, 0, OPT_MOVE_NODES },
+		{ "move-depth",		required_argument, 0, OPT_MOVE_DEPTH },
+		{ "reach",			no_argument, 0, OPT_REACH },
+		{ "reach-depth",	required_argument, 0, OPT_REACH_DEPTH },
+		{ "solve",			no_argument, 0, OPT_SOLVE },
+		{ "split-depth",	required_argument, 0, OPT_SPLIT_DEPTH },
+		{ "checkpoint",		required_argument, 0, OPT_CHECKPOINT },
+		{ "checkpoint-interval",	required_argument, 0, OPT_CHECKPOINT_INTERVAL },
+		{ "engine",			no_argument, 0, OPT_ENGINE },
+		{ "server",			required_argument, 0, OPT_SERVER },
+		{ "stats",			required_argument, 0, OPT_STATS },
+		{ "stats-file",		required_argument, 0, OPT_STATS_FILE },
+		{ "latency",		no_argument, 0, OPT_LATENCY },
+		{ "match",			required_argument, 0, OPT_MATCH },
+		{ "pairs",			required_argument, 0, OPT_PAIRS },
+		{ "sprt",			required_argument, 0, OPT_SPRT },
+		{ "tune",			required_argument, 0, OPT_TUNE },
+		{ "tune-iterations",	required_argument, 0, OPT_TUNE_ITERATIONS },
+		{ "tune-pairs",		required_argument, 0, OPT_TUNE_PAIRS },
+		{ "tune-features",	required_argument, 0, OPT_TUNE_FEATURES },
+		{ "help",			no_argument, 0, 'h' },
+		{ 0 }
+	};
+
+	*options = (struct options_t) {
+		.n = 4,
+		.trace_format = TRACE_NONE,
+		.playout_params = {
+			.max_plies = 500,
+			.repetition_count = 3,
+		},
+		.game_count = 1,
+		.thread_count = parallel_cpu_count(),
+		.tmpdir = "/tmp",
+		.memory_mib = 256,
+		.book_depth = 4,
+		.book_width = 4,
+		.search_depth = 2,
+		.build_radius = 1,
+		.node_budget = 1000000,
+		.reach_depth = UINT_MAX,
+		.checkpoint_interval = 60,
+		.match_pairs = 10000,
+		.sprt_elo1 = 10,
+		.tune_iterations = 200,
+		.tune_pairs = 8,
+	};
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "n:t:o:g:j:r:h", long_options, NULL)) != -1) {
+		switch (opt) {
+			case 'n':
+				options->n = atoi(optarg);
+				if ((options->n < 2) || (options->n > PACKED_ACTION_MAX_N)) {
+					fprintf(stderr, "Board size must be between 2 and %d.\n", PACKED_ACTION_MAX_N);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case 't':
+				if (!trace_parse_format(optarg, &options->trace_format)) {
+					fprintf(stderr, "Unknown trace format: %s\n", optarg);
+					syntax(argv[0]);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case 'o':
+				options->trace_filename = optarg;
+				break;
+
+			case OPT_MAX_PLIES:
+				options->playout_params.max_plies = atoi(optarg);
+				break;
+
+			case OPT_REPETITIONS:
+				options->playout_params.repetition_count = atoi(optarg);
+				break;
+
+			case OPT_RANDOM_PLIES:
+				options->playout_params.random_plies = atoi(optarg);
+				break;
+
+			case OPT_SEED:
+				options->playout_params.seed = strtoull(optarg, NULL, 0);
+				break;
+
+			case 'g':
+				options->game_count = atoi(optarg);
+				break;
+
+			case 'j':
+				options->thread_count = atoi(optarg);
+				break;
+
+			case 'r':
+				options->record_filename = optarg;
+				break;
+
+			case OPT_REPLAY:
+				options->replay_filename = optarg;
+				break;
+
+			case OPT_POSDB_BUILD:
+				options->posdb_build_filename = optarg;
+				break;
+
+			case OPT_POSDB_QUERY:
+				options->posdb_query_filename = optarg;
+				break;
+
+			case OPT_TMPDIR:
+				options->tmpdir = optarg;
+				break;
+
+			case OPT_MEMORY:
+				options->memory_mib = atoi(optarg);
+				break;
+
+			case OPT_BOOK_BUILD:
+				options->book_build_filename = optarg;
+				break;
+
+			case OPT_BOOK_DEPTH:
+				options->book_depth = atoi(optarg);
+				break;
+
+			case OPT_BOOK_WIDTH:
+				options->book_width = atoi(optarg);
+				break;
+
+			case OPT_BOOK:
+				options->book_filename = optarg;
+				break;
+
+			case OPT_SEARCH_DEPTH:
+				options->search_depth = atoi(optarg);
+				break;
+
+			case OPT_NODE_BUDGET:
+				options->node_budget = strtoull(optarg, NULL, 0);
+				break;
+
+			case OPT_HASH:
+				options->hash_bytes = hugemem_parse_size(optarg);
+				if (!options->hash_bytes) {
+					fprintf(stderr, "Invalid table size: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case OPT_DISTANCE:
+				if (!strategy_parse_distance_metric(optarg, &options->distance_metric)) {
+					fprintf(stderr, "Unknown distance metric: %s\n", optarg);
+					syntax(argv[0]);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case OPT_WEIGHTS:
+				options->weights_filename = optarg;
+				break;
+
+			case OPT_BUILDS:
+				if (!strategy_parse_build_mode(optarg, &options->build_mode)) {
+					fprintf(stderr, "Unknown build mode: %s\n", optarg);
+					syntax(argv[0]);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case OPT_BUILD_RADIUS:
+				options->build_radius = atoi(optarg);
+				break;
+
+			case OPT_QUIESCENCE:
+				options->quiescence_depth = atoi(optarg);
+				break;
+
+			case OPT_MOVE_TIME:
+				options->move_time = atof(optarg) / 1000;
+				break;
+
+			case OPT_MOVE_NODES:
+				options->move_nodes = strtoull(optarg, NULL, 0);
+				break;
+
+			case OPT_MOVE_DEPTH:
+				options->move_depth = atoi(optarg);
+				break;
+
+			case OPT_REACH:
+				options->reach = true;
+				break;
+
+			case OPT_REACH_DEPTH:
+				options->reach_depth = atoi(optarg);
+				break;
+
+			case OPT_SOLVE:
+				options->solve = true;
+				break;
+
+			case OPT_SPLIT_DEPTH:
+				options->shard = true;
+				options->split_depth = atoi(optarg);
+				break;
+
+			case OPT_CHECKPOINT:
+				options->checkpoint_filename = optarg;
+				break;
+
+			case OPT_CHECKPOINT_INTERVAL:
+				options->checkpoint_interval = atoi(optarg);
+				break;
+
+			case OPT_ENGINE:
+				options->engine = true;
+				break;
+
+			case OPT_SERVER:
+				options->server_socket = optarg;
+				break;
+
+			case OPT_STATS:
+				options->stats = true;
+				options->stats_interval = atof(optarg);
+				break;
+
+			case OPT_STATS_FILE:
+				options->stats_filename = optarg;
+				break;
+
+			case OPT_LATENCY:
+				options->latency = true;
+				break;
+
+			case OPT_MATCH:
+				options->match_weights_filename = optarg;
+				break;
+
+			case OPT_PAIRS:
+				options->match_pairs = atoi(optarg);
+				if (options->match_pairs < 1) {
+					fprintf(stderr, "At least one pair must be played.\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case OPT_SPRT:
+				if ((sscanf(optarg, "%lf,%lf", &options->sprt_elo0, &options->sprt_elo1) != 2) || (options->sprt_elo0 >= options->sprt_elo1)) {
+					fprintf(stderr, "SPRT bounds must be given as elo0,elo1 with elo0 < elo1: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case OPT_TUNE:
+				options->tune_filename = optarg;
+				break;
+
+			case OPT_TUNE_ITERATIONS:
+				options->tune_iterations = atoi(optarg);
+				if (options->tune_iterations < 1) {
+					fprintf(stderr, "At least one tuning iteration must be run.\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case OPT_TUNE_PAIRS:
+				options->tune_pairs = atoi(optarg);
+				if (options->tune_pairs < 1) {
+					fprintf(stderr, "At least one pair must be played per tuning iteration.\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case OPT_TUNE_FEATURES:
+				options->tune_features = optarg;
+				break;
+
+			case 'h':
+				syntax(argv[0]);
+				exit(EXIT_SUCCESS);
+
+			default:
+				syntax(argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+	options->input_filenames = (const char**)(argv + optind);
+	options->input_file_count = argc - optind;
+	if (options->input_file_count && !options->posdb_build_filename) {
+		fprintf(stderr, "Unexpected excess argument.\n");
+		syntax(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static atomic_bool server_stop;
+
+static void server_stop_handler(int signal_number) {
+	atomic_store(&server_stop, true);
+}
+
+static int replay_records(const char *filename) {
+	struct gamerecord_reader_t *reader = gamerecord_reader_open(filename);
+	if (!reader) {
+		return 1;
+	}
+
+	struct game_t *game = NULL;
+	struct gamerecord_t record;
+	unsigned long long game_count = 0, ply_count = 0;
+	unsigned long long outcomes[3] = { 0 };
+	double t0 = monotime_secs();
+	while (gamerecord_next(reader, &record)) {
+		if (!game || (game->n != record.header->n)) {
+			if (game) {
+				game_free(game);
+			}
+			game = game_init(record.header->n);
+			if (!game) {
+				gamerecord_reader_close(reader);
+				return 1;
+			}
+		}
+		gamerecord_replay(&record, game, NULL, NULL);
+		game_count++;
+		ply_count += record.header->ply_count;
+		if (record.header->result <= RESULT_DRAW) {
+			outcomes[record.header->result]++;
+		}
+	}
+	double t = monotime_secs() - t0;
+	fprintf(stderr, "Replayed %llu games with %llu plies in %.3f secs (%.0f plies/sec)\n", game_count, ply_count, t, (t > 0) ? ply_count / t : 0);
+	fprintf(stderr, "First side: %llu wins, %llu losses, %llu draws\n", outcomes[RESULT_WIN], outcomes[RESULT_LOSS], outcomes[RESULT_DRAW]);
+	if (game) {
+		game_free(game);
+	}
+	gamerecord_reader_close(reader);
+	return 0;
+}
+
+struct posdb_successor_t {
+	struct action_t action;
+	const struct posdb_entry_t *stats;
+};
+
+struct posdb_successor_ctx_t {
+	unsigned int count;
+	unsigned int capacity;
+	struct posdb_successor_t *successors;
+};
+
+static bool posdb_collect_successor(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct posdb_successor_ctx_t *ctx = (struct posdb_successor_ctx_t*)vctx;
+	if (ctx->count == ctx->capacity) {
+		ctx->capacity = ctx->capacity ? (2 * ctx->capacity) : 256;
+		ctx->successors = realloc(ctx->successors, sizeof(struct posdb_successor_t) * ctx->capacity);
+		if (!ctx->successors) {
+			fprintf(stderr, "Failed to grow successor list to %u actions.\n", ctx->capacity);
+			abort();
+		}
+	}
+	ctx->successors[ctx->count++].action = *action;
+	return true;
+}
+
+static int posdb_successor_cmp(const void *v_succ1, const void *v_succ2) {
+	const struct posdb_successor_t *succ1 = (const struct posdb_successor_t*)v_succ1;
+	const struct posdb_successor_t *succ2 = (const struct posdb_successor_t*)v_succ2;
+	unsigned int visits1 = succ1->stats ? succ1->stats->visits : 0;
+	unsigned int visits2 = succ2->stats ? succ2->stats->visits : 0;
+	return (visits1 < visits2) - (visits1 > visits2);
+}
+
+static int posdb_query_start(const char *filename, uint8_t n) {
+	struct posdb_t *db = posdb_open(filename);
+	if (!db) {
+		return 1;
+	}
+	fprintf(stderr, "%s: %" PRIu64 " positions from %" PRIu64 " games, %u bits table\n", filename, db->header->entry_count, db->header->game_count, db->header->table_bits);
+	if (db->header->n != n) {
+		fprintf(stderr, "%s: database holds games of Iso-Path(%u), not Iso-Path(%u).\n", filename, db->header->n, n);
+		posdb_close(db);
+		return 1;
+	}
+
+	struct game_t *game = game_init(n);
+	if (!game) {
+		posdb_close(db);
+		return 1;
+	}
+	const enum side_t mover = game->side_turn;
+	const struct posdb_entry_t *stats = posdb_query(db, game);
+	if (!stats) {
+		printf("Starting position of Iso-Path(%u) not in database.\n", n);
+	} else {
+		printf("Start: %u visits, %s wins %u, draws %u\n", stats->visits, side_to_string(mover), stats->wins[mover], stats->draws);
+
+		struct posdb_successor_ctx_t ctx = { 0 };
+		enumerate_valid_actions(game, posdb_collect_successor, &ctx);
+		for (unsigned int i = 0; i < ctx.count; i++) {
+			game_reset(game);
+			game_perform_action(game, &ctx.successors[i].action);
+			ctx.successors[i].stats = posdb_query(db, game);
+		}
+		qsort(ctx.successors, ctx.count, sizeof(struct posdb_successor_t), posdb_successor_cmp);
+		for (unsigned int i = 0; (i < ctx.count) && ctx.successors[i].stats; i++) {
+			char action_str[ACTION_STRING_MAXLEN];
+			action_to_string(action_str, sizeof(action_str), &ctx.successors[i].action);
+			const struct posdb_entry_t *succ_stats = ctx.successors[i].stats;
+			printf("%-20s %8u visits  %5.1f%% %s wins  %5.1f%% draws\n", action_str, succ_stats->visits, 100.0 * succ_stats->wins[mover] / succ_stats->visits, side_to_string(mover), 100.0 * succ_stats->draws / succ_stats->visits);
+		}
+		free(ctx.successors);
+	}
+	game_free(game);
+	posdb_close(db);
+	return 0;
+}
+
+static int solve_start(const struct options_t *options) {
+	struct game_t *game = game_init(options->n);
+	uint64_t rng_state = options->playout_params.seed;
+	for (unsigned int i = 0; i < options->playout_params.random_plies; i++) {
+		if (game_won_by(game, TRENCH) || game_won_by(game, CLIMB)) {
+			break;
+		}
+		struct action_t action;
+		char action_str[ACTION_STRING_MAXLEN];
+		if (!strategy_perform_random_move(game, &rng_state, &action)) {
+			break;
+		}
+		action_to_string(action_str, sizeof(action_str), &action);
+		printf("%s ", action_str);
+	}
+	printf("\n");
 	board_dump(game->board);
-	struct strategy_t strategy = {
-		.winning_coefficient = 1000,
-		.threat_coefficient = 100,
-		.min_distance_coefficient = 10,
-		.sum_distance_coefficient = 3,
+	printf("Solving for %s to move.\n", side_to_string(game->side_turn));
+
+	struct solve_params_t solve_params = {
+		.memory_bytes = (size_t)options->memory_mib * 1024 * 1024,
+		.expansion_budget = options->node_budget,
+		.progress_interval = 1,
+		.checkpoint_filename = options->checkpoint_filename,
+		.checkpoint_interval = options->checkpoint_interval,
 	};
-	strategy_play_out(game, &strategy, &strategy);
+	if (options->shard) {
+		struct shard_params_t shard_params = {
+			.split_depth = options->split_depth,
+			.worker_count = options->thread_count,
+			.solve_params = solve_params,
+		};
+		struct shard_result_t result;
+		if (!shard_solve(game, &shard_params, &result)) {
+			game_free(game);
+			return 1;
+		}
+		printf("Result: %s after %" PRIu64 " expansions, %u nodes peak per worker\n", solve_outcome_to_string(result.outcome), result.expansions, result.peak_nodes);
+		printf("Units: %u total, %u solved, %u skipped, %u failed, %u dispatched again\n", result.unit_count, result.units_solved, result.units_skipped, result.units_failed, result.redispatches);
+		if (result.have_action) {
+			char action_str[ACTION_STRING_MAXLEN];
+			action_to_string(action_str, sizeof(action_str), &result.winning_action);
+			printf("Winning action: %s\n", action_str);
+		}
+		game_free(game);
+		return 0;
+	}
+
+	struct solve_result_t result;
+	if (!solve_position(game, game->side_turn, &solve_params, &result)) {
+		game_free(game);
+		return 1;
+	}
+	printf("Result: %s after %" PRIu64 " expansions, %u nodes peak\n", solve_outcome_to_string(result.outcome), result.expansions, result.peak_nodes);
+	if (result.have_action) {
+		char action_str[ACTION_STRING_MAXLEN];
+		action_to_string(action_str, sizeof(action_str), &result.winning_action);
+		printf("Winning action: %s\n", action_str);
+	}
 	game_free(game);
 	return 0;
 }
+
+static int match_start(const struct options_t *options, const struct strategy_t *candidate) {
+	struct strategy_t baseline = *candidate;
+	baseline.ttable = NULL;
+	if (!evaluation_load_weights(options->match_weights_filename, &baseline.weights)) {
+		return 1;
+	}
+	if (options->playout_params.random_plies == 0) {
+		fprintf(stderr, "Warning: without --random-plies, every pair starts from the same position.\n");
+	}
+
+	struct match_params_t match_params = {
+		.n = options->n,
+		.thread_count = options->thread_count,
+		.max_pairs = options->match_pairs,
+		.playout_params = options->playout_params,
+		.candidate = candidate,
+		.baseline = &baseline,
+		.elo0 = options->sprt_elo0,
+		.elo1 = options->sprt_elo1,
+		.alpha = 0.05,
+		.beta = 0.05,
+		.report_interval = 100,
+	};
+	struct match_results_t results;
+	double t0 = monotime_secs();
+	match_run(&match_params, &results);
+	double t = monotime_secs() - t0;
+	fprintf(stderr, "Played %u pairs in %.3f secs: %u wins, %u losses, %u draws\n", results.pairs, t, results.wins, results.losses, results.draws);
+	fprintf(stderr, "Pair scores 0/0.5/1/1.5/2: %u %u %u %u %u\n", results.pentanomial[0], results.pentanomial[1], results.pentanomial[2], results.pentanomial[3], results.pentanomial[4]);
+	fprintf(stderr, "Elo %+.1f, 95%% confidence [%+.1f, %+.1f]\n", results.elo, results.elo_lower, results.elo_upper);
+	fprintf(stderr, "SPRT elo0 %g elo1 %g: LLR %.2f [%.2f, %.2f], %s\n", options->sprt_elo0, options->sprt_elo1, results.llr, results.llr_lower, results.llr_upper, sprt_decision_to_string(results.decision));
+	return 0;
+}
+
+static int tune_start(const struct options_t *options, const struct strategy_t *strategy) {
+	char final_filename[256];
+	snprintf(final_filename, sizeof(final_filename), "%s.final", options->tune_filename);
+	struct tune_params_t tune_params = {
+		.n = options->n,
+		.thread_count = options->thread_count,
+		.iterations = options->tune_iterations,
+		.pairs_per_iteration = options->tune_pairs,
+		.evaluation_interval = 20,
+		.evaluation_pairs = 8 * options->tune_pairs,
+		.playout_params = options->playout_params,
+		.strategy = strategy,
+		.a = 0.5,
+		.c = 0.2,
+		.checkpoint_filename = options->tune_filename,
+		.final_filename = final_filename,
+	};
+	if (options->tune_features) {
+		char names[256];
+		snprintf(names, sizeof(names), "%s", options->tune_features);
+		char *saveptr = NULL;
+		for (const char *name = strtok_r(names, ",", &saveptr); name; name = strtok_r(NULL, ",", &saveptr)) {
+			enum feature_t feature;
+			if (!evaluation_lookup_feature(name, &feature)) {
+				fprintf(stderr, "Unknown feature: %s\n", name);
+				return 1;
+			}
+			tune_params.tuned[feature] = true;
+		}
+	} else {
+		for (unsigned int i = 0; i < FEATURE_COUNT; i++) {
+			tune_params.tuned[i] = (strategy->weights.values[i] != 0);
+		}
+	}
+	if (options->playout_params.random_plies == 0) {
+		fprintf(stderr, "Warning: without --random-plies, every pair starts from the same position.\n");
+	}
+
+	struct tune_results_t results;
+	if (!tune_run(&tune_params, &results)) {
+		return 1;
+	}
+	fprintf(stderr, "Best weights: Elo %+.1f against the initial weights, %.3f CPU-hours, %u pairs per iteration\n", results.best_elo, results.cpu_hours, results.pairs_per_iteration);
+	fprintf(stderr, "%-16s %10s    %10s %10s\n", "feature", "initial", "best", "final");
+	for (unsigned int i = 0; i < FEATURE_USED_COUNT; i++) {
+		if (tune_params.tuned[i] || results.best_weights.values[i] || results.final_weights.values[i]) {
+			fprintf(stderr, "%-16s %10.3f -> %10.3f %10.3f\n", evaluation_feature_name(i), strategy->weights.values[i], results.best_weights.values[i], results.final_weights.values[i]);
+		}
+	}
+	fprintf(stderr, "Best weights are in %s, final weights in %s\n", options->tune_filename, final_filename);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	struct options_t options;
+	parse_options(&options, argc, argv);
+	if (options.stats) {
+		if (!stats_start_reporter(options.stats_filename, options.stats_interval)) {
+			exit(EXIT_FAILURE);
+		}
+		atexit(stats_stop_reporter);
+	}
+
+	if (options.replay_filename) {
+		return replay_records(options.replay_filename);
+	}
+	if (options.posdb_build_filename) {
+		struct posdb_build_params_t posdb_params = {
+			.record_filenames = options.input_filenames,
+			.record_file_count = options.input_file_count,
+			.output_filename = options.posdb_build_filename,
+			.tmpdir = options.tmpdir,
+			.memory_bytes = (size_t)options.memory_mib * 1024 * 1024,
+			.thread_count = options.thread_count,
+		};
+		return posdb_build(&posdb_params) ? 0 : 1;
+	}
+	if (options.posdb_query_filename) {
+		return posdb_query_start(options.posdb_query_filename, options.n);
+	}
+	if (options.reach) {
+		struct reach_params_t reach_params = {
+			.n = options.n,
+			.max_depth = options.reach_depth,
+			.memory_bytes = (size_t)options.memory_mib * 1024 * 1024,
+			.thread_count = options.thread_count,
+			.tmpdir = options.tmpdir,
+			.checkpoint_filename = options.checkpoint_filename,
+		};
+		return reach_enumerate(&reach_params) ? 0 : 1;
+	}
+	if (options.solve) {
+		return solve_start(&options);
+	}
+
+	struct strategy_t strategy = {
+		.distance_metric = options.distance_metric,
+		.build_mode = options.build_mode,
+		.build_radius = options.build_radius,
+		.quiescence_depth = options.quiescence_depth,
+		.move_time = options.move_time,
+		.move_nodes = options.move_nodes,
+		.search_depth = options.move_depth,
+	};
+	if (options.weights_filename) {
+		if (!evaluation_load_weights(options.weights_filename, &strategy.weights)) {
+			exit(EXIT_FAILURE);
+		}
+	} else {
+		evaluation_default_weights(&strategy.weights);
+	}
+	struct ttable_t *ttable = NULL;
+	if (options.hash_bytes) {
+		ttable = ttable_init(options.hash_bytes, options.thread_count);
+		if (!ttable) {
+			exit(EXIT_FAILURE);
+		}
+		fprintf(stderr, "Transposition table: %zu MiB, %" PRIu64 " entries, %s pages of %zu KiB\n", ttable->mem.length >> 20, ttable->mask + 1, hugemem_backing_to_string(ttable->mem.backing), ttable->mem.page_size >> 10);
+	}
+	if (options.engine) {
+		struct engine_params_t engine_params = {
+			.n = options.n,
+			.strategy = &strategy,
+			.ttable = ttable,
+			.search_depth = options.search_depth,
+			.node_budget = options.node_budget,
+		};
+		bool success = engine_run(&engine_params, stdin, stdout);
+		ttable_free(ttable);
+		return success ? 0 : 1;
+	}
+	if (options.server_socket) {
+		struct sigaction stop_action = {
+			.sa_handler = server_stop_handler,
+		};
+		sigaction(SIGINT, &stop_action, NULL);
+		sigaction(SIGTERM, &stop_action, NULL);
+		struct server_params_t server_params = {
+			.socket_path = options.server_socket,
+			.n = options.n,
+			.thread_count = options.thread_count,
+			.strategy = &strategy,
+			.ttable = ttable,
+			.search_depth = options.search_depth,
+			.node_budget = options.node_budget,
+			.stop = &server_stop,
+		};
+		bool success = server_run(&server_params);
+		ttable_free(ttable);
+		return success ? 0 : 1;
+	}
+	if (options.book_build_filename) {
+		struct book_build_params_t book_params = {
+			.n = options.n,
+			.strategy = &strategy,
+			.book_depth = options.book_depth,
+			.width = options.book_width,
+			.search_depth = options.search_depth,
+			.node_budget = options.node_budget,
+			.thread_count = options.thread_count,
+			.ttable = ttable,
+			.output_filename = options.book_build_filename,
+		};
+		bool success = book_build(&book_params);
+		ttable_free(ttable);
+		return success ? 0 : 1;
+	}
+	struct book_t *book = NULL;
+	if (options.book_filename) {
+		book = book_open(options.book_filename);
+		if (!book) {
+			exit(EXIT_FAILURE);
+		}
+		strategy.book = book;
+	}
+	strategy.ttable = ttable;
+
+	if (!trace_init(options.trace_format, options.trace_filename)) {
+		exit(EXIT_FAILURE);
+	}
+	if (options.match_weights_filename || options.tune_filename) {
+		int result = options.tune_filename ? tune_start(&options, &strategy) : match_start(&options, &strategy);
+		book_close(book);
+		ttable_free(ttable);
+		trace_shutdown();
+		return result;
+	}
+
+	struct selfplay_params_t selfplay_params = {
+		.n = options.n,
+		.game_count = options.game_count,
+		.thread_count = options.thread_count,
+		.playout_params = options.playout_params,
+		.strategies = { &strategy, &strategy },
+	};
+	if (options.latency) {
+		selfplay_params.latency = latency_init();
+		if (!selfplay_params.latency) {
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (options.record_filename) {
+		selfplay_params.record_writer = gamerecord_writer_open(options.record_filename);
+		if (!selfplay_params.record_writer) {
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	struct selfplay_results_t results;
+	double t0 = monotime_secs();
+	selfplay_run(&selfplay_params, &results);
+	double t = monotime_secs() - t0;
+	fprintf(stderr, "Played %u games with %llu plies in %.3f secs\n", options.game_count, results.plies, t);
+	fprintf(stderr, "First side: %u wins, %u losses, %u draws\n", results.wins, results.losses, results.draws);
+	if (results.prune_stats.builds_total) {
+		const struct prune_stats_t *stats = &results.prune_stats;
+		fprintf(stderr, "Build pruning: kept %" PRIu64 " of %" PRIu64 " builds (%.1f%%) over %" PRIu64 " positions\n", stats->builds_kept, stats->builds_total, 100.0 * stats->builds_kept / stats->builds_total, stats->nodes);
+	}
+
+	if (selfplay_params.latency) {
+		latency_print(stderr, selfplay_params.latency);
+	}
+
+	latency_free(selfplay_params.latency);
+	gamerecord_writer_close(selfplay_params.record_writer);
+	book_close(book);
+	ttable_free(ttable);
+	trace_shutdown();
+	return 0;
+}
@@ -0,0 +1,178 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "latency.h"
+
+#define LATENCY_HALF_BUCKETS			(1 << (LATENCY_SUB_BITS - 1))
+
+/* Exclusive upper bounds of all but the last class */
+static const unsigned int ply_class_limits[LATENCY_PLY_CLASSES - 1] = { 10, 20, 40, 80 };
+static const unsigned int action_class_limits[LATENCY_ACTION_CLASSES - 1] = { 64, 256, 1024, 4096 };
+
+static unsigned int bucket_index(uint64_t value) {
+	if (value < (1 << LATENCY_SUB_BITS)) {
+		return value;
+	}
+	const unsigned int magnitude = 63 - __builtin_clzll(value);
+	const unsigned int shift = magnitude - LATENCY_SUB_BITS + 1;
+	return (shift * LATENCY_HALF_BUCKETS) + (value >> shift);
+}
+
+/* Highest value that falls into the given bucket */
+static uint64_t bucket_value(unsigned int index) {
+	if (index < (1 << LATENCY_SUB_BITS)) {
+		return index;
+	}
+	const unsigned int shift = (index / LATENCY_HALF_BUCKETS) - 1;
+	const uint64_t sub_bucket = (index % LATENCY_HALF_BUCKETS) + LATENCY_HALF_BUCKETS;
+	return (sub_bucket << shift) + ((1ULL << shift) - 1);
+}
+
+static unsigned int classify(unsigned int value, const unsigned int *limits, unsigned int class_count) {
+	unsigned int class = 0;
+	while ((class < class_count - 1) && (value >= limits[class])) {
+		class++;
+	}
+	return class;
+}
+
+void latency_histogram_clear(struct latency_histogram_t *histogram) {
+	memset(histogram, 0, sizeof(*histogram));
+}
+
+void latency_histogram_record(struct latency_histogram_t *histogram, uint64_t value) {
+	if ((histogram->count == 0) || (value < histogram->min)) {
+		histogram->min = value;
+	}
+	if (value > histogram->max) {
+		histogram->max = value;
+	}
+	histogram->count++;
+	histogram->buckets[bucket_index(value)]++;
+}
+
+void latency_histogram_merge(struct latency_histogram_t *dest, const struct latency_histogram_t *src) {
+	if (src->count == 0) {
+		return;
+	}
+	if ((dest->count == 0) || (src->min < dest->min)) {
+		dest->min = src->min;
+	}
+	if (src->max > dest->max) {
+		dest->max = src->max;
+	}
+	dest->count += src->count;
+	for (unsigned int i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+		dest->buckets[i] += src->buckets[i];
+	}
+}
+
+/* Returns the smallest bucket value that at least the given fraction (0..1)
+ * of all recorded values is less than or equal to, clamped to the observed
+ * range. An empty histogram yields 0. */
+uint64_t latency_histogram_percentile(const struct latency_histogram_t *histogram, double percentile) {
+	if (histogram->count == 0) {
+		return 0;
+	}
+	uint64_t rank = (uint64_t)(percentile * histogram->count + 0.5);
+	if (rank < 1) {
+		rank = 1;
+	} else if (rank > histogram->count) {
+		rank = histogram->count;
+	}
+
+	uint64_t seen = 0;
+	for (unsigned int i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+		seen += histogram->buckets[i];
+		if (seen >= rank) {
+			uint64_t value = bucket_value(i);
+			if (value < histogram->min) {
+				return histogram->min;
+			}
+			return (value > histogram->max) ? histogram->max : value;
+		}
+	}
+	return histogram->max;
+}
+
+struct latency_t *latency_init(void) {
+	struct latency_t *latency = calloc(1, sizeof(struct latency_t));
+	if (!latency) {
+		perror("calloc");
+		return NULL;
+	}
+	return latency;
+}
+
+void latency_record(struct latency_t *latency, unsigned int ply, unsigned int action_count, uint64_t nanoseconds) {
+	latency_histogram_record(&latency->all, nanoseconds);
+	latency_histogram_record(&latency->by_ply[classify(ply, ply_class_limits, LATENCY_PLY_CLASSES)], nanoseconds);
+	latency_histogram_record(&latency->by_actions[classify(action_count, action_class_limits, LATENCY_ACTION_CLASSES)], nanoseconds);
+}
+
+void latency_merge(struct latency_t *dest, const struct latency_t *src) {
+	latency_histogram_merge(&dest->all, &src->all);
+	for (unsigned int i = 0; i < LATENCY_PLY_CLASSES; i++) {
+		latency_histogram_merge(&dest->by_ply[i], &src->by_ply[i]);
+	}
+	for (unsigned int i = 0; i < LATENCY_ACTION_CLASSES; i++) {
+		latency_histogram_merge(&dest->by_actions[i], &src->by_actions[i]);
+	}
+}
+
+static void print_histogram(FILE *f, const char *name, const struct latency_histogram_t *histogram) {
+	if (histogram->count == 0) {
+		return;
+	}
+	fprintf(f, "%-18s %10" PRIu64 " %10.3f %10.3f %10.3f %10.3f\n", name, histogram->count,
+			latency_histogram_percentile(histogram, 0.5) * 1e-6,
+			latency_histogram_percentile(histogram, 0.99) * 1e-6,
+			latency_histogram_percentile(histogram, 0.999) * 1e-6,
+			histogram->max * 1e-6);
+}
+
+static void print_classes(FILE *f, const char *prefix, const struct latency_histogram_t *histograms, const unsigned int *limits, unsigned int class_count) {
+	for (unsigned int i = 0; i < class_count; i++) {
+		char name[32];
+		unsigned int lower = (i == 0) ? 0 : limits[i - 1];
+		if (i < class_count - 1) {
+			snprintf(name, sizeof(name), "%s %u-%u", prefix, lower, limits[i] - 1);
+		} else {
+			snprintf(name, sizeof(name), "%s %u+", prefix, lower);
+		}
+		print_histogram(f, name, &histograms[i]);
+	}
+}
+
+void latency_print(FILE *f, const struct latency_t *latency) {
+	fprintf(f, "%-18s %10s %10s %10s %10s %10s\n", "Move latency [ms]", "decisions", "p50", "p99", "p99.9", "max");
+	print_histogram(f, "all", &latency->all);
+	print_classes(f, "ply", latency->by_ply, ply_class_limits, LATENCY_PLY_CLASSES);
+	print_classes(f, "actions", latency->by_actions, action_class_limits, LATENCY_ACTION_CLASSES);
+}
+
+void latency_free(struct latency_t *latency) {
+	free(latency);
+}
@@ -0,0 +1,66 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Log-linear buckets in the style of HdrHistogram: values below
+ * 2^LATENCY_SUB_BITS are counted exactly, every power of two above that is
+ * split into 2^(LATENCY_SUB_BITS - 1) equally wide buckets. This bounds the
+ * relative error of any reported value to 2^-(LATENCY_SUB_BITS - 1) (3.1%). */
+#define LATENCY_SUB_BITS				6
+#define LATENCY_BUCKET_COUNT			((64 - LATENCY_SUB_BITS + 2) << (LATENCY_SUB_BITS - 1))
+
+/* Decisions are additionally classified by ply and by the number of legal
+ * actions in the position, the two things move latency mostly depends on. */
+#define LATENCY_PLY_CLASSES				5
+#define LATENCY_ACTION_CLASSES			5
+
+struct latency_histogram_t {
+	uint64_t count;
+	uint64_t min, max;
+	uint64_t buckets[LATENCY_BUCKET_COUNT];
+};
+
+struct latency_t {
+	struct latency_histogram_t all;
+	struct latency_histogram_t by_ply[LATENCY_PLY_CLASSES];
+	struct latency_histogram_t by_actions[LATENCY_ACTION_CLASSES];
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+void latency_histogram_clear(struct latency_histogram_t *histogram);
+void latency_histogram_record(struct latency_histogram_t *histogram, uint64_t value);
+void latency_histogram_merge(struct latency_histogram_t *dest, const struct latency_histogram_t *src);
+uint64_t latency_histogram_percentile(const struct latency_histogram_t *histogram, double percentile);
+struct latency_t *latency_init(void);
+void latency_record(struct latency_t *latency, unsigned int ply, unsigned int action_count, uint64_t nanoseconds);
+void latency_merge(struct latency_t *dest, const struct latency_t *src);
+void latency_print(FILE *f, const struct latency_t *latency);
+void latency_free(struct latency_t *latency);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
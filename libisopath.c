@@ -0,0 +1,238 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libisopath.h"
+#include "game.h"
+#include "notation.h"
+#include "strategy.h"
+#include "evaluation.h"
+#include "search.h"
+#include "ttable.h"
+
+/* Only the functions of libisopath.h are exported from the shared library,
+ * everything else is compiled with hidden visibility */
+#define ISOPATH_EXPORT		__attribute__((visibility("default")))
+
+_Static_assert((ISOPATH_TRENCH == TRENCH) && (ISOPATH_CLIMB == CLIMB), "side numbering of the API and the game differ");
+
+struct isopath_game_t {
+	struct game_t *game;
+	struct strategy_t strategy;
+	struct ttable_t *ttable;
+};
+
+struct generate_actions_ctx_t {
+	uint32_t *actions;
+	unsigned int capacity;
+	unsigned int count;
+};
+
+ISOPATH_EXPORT unsigned int isopath_api_version(void) {
+	return ISOPATH_API_VERSION;
+}
+
+ISOPATH_EXPORT struct isopath_game_t *isopath_game_new(unsigned int n) {
+	if ((n < 2) || (n > PACKED_ACTION_MAX_N)) {
+		return NULL;
+	}
+	struct isopath_game_t *handle = calloc(1, sizeof(struct isopath_game_t));
+	if (!handle) {
+		return NULL;
+	}
+	handle->game = game_init(n);
+	if (!handle->game) {
+		free(handle);
+		return NULL;
+	}
+	evaluation_default_weights(&handle->strategy.weights);
+	return handle;
+}
+
+ISOPATH_EXPORT void isopath_game_free(struct isopath_game_t *handle) {
+	if (!handle) {
+		return;
+	}
+	ttable_free(handle->ttable);
+	game_free(handle->game);
+	free(handle);
+}
+
+/* Gives searches a transposition table of (about) the given size that is
+ * kept across searches; zero removes it */
+ISOPATH_EXPORT bool isopath_set_hash_size(struct isopath_game_t *handle, size_t bytes) {
+	ttable_free(handle->ttable);
+	handle->ttable = NULL;
+	if (bytes) {
+		handle->ttable = ttable_init(bytes, 1);
+	}
+	return !bytes || handle->ttable;
+}
+
+ISOPATH_EXPORT bool isopath_load_weights(struct isopath_game_t *handle, const char *filename) {
+	struct feature_vector_t weights;
+	if (!evaluation_load_weights(filename, &weights)) {
+		return false;
+	}
+	handle->strategy.weights = weights;
+
+	/* Scores in the table were computed with the previous weights */
+	if (handle->ttable) {
+		ttable_clear(handle->ttable);
+	}
+	return true;
+}
+
+ISOPATH_EXPORT void isopath_reset(struct isopath_game_t *handle) {
+	game_reset(handle->game);
+}
+
+ISOPATH_EXPORT bool isopath_set_position(struct isopath_game_t *handle, const char *position, int side) {
+	uint8_t tiles[NUMBER_TILES(handle->game->n)];
+	if (((side != ISOPATH_TRENCH) && (side != ISOPATH_CLIMB)) || !position_from_string(position, handle->game->n, tiles)) {
+		return false;
+	}
+	game_set_position(handle->game, tiles, side);
+	return true;
+}
+
+ISOPATH_EXPORT bool isopath_get_position(const struct isopath_game_t *handle, char *buffer, size_t buffer_size) {
+	if (buffer_size < POSITION_STRING_MAXLEN(handle->game->n)) {
+		return false;
+	}
+	position_to_string(buffer, handle->game);
+	return true;
+}
+
+ISOPATH_EXPORT int isopath_side_to_move(const struct isopath_game_t *handle) {
+	return handle->game->side_turn;
+}
+
+ISOPATH_EXPORT uint64_t isopath_hash(const struct isopath_game_t *handle) {
+	return handle->game->hash;
+}
+
+ISOPATH_EXPORT int isopath_winner(const struct isopath_game_t *handle) {
+	if (game_won_by(handle->game, TRENCH)) {
+		return ISOPATH_TRENCH;
+	} else if (game_won_by(handle->game, CLIMB)) {
+		return ISOPATH_CLIMB;
+	}
+	return ISOPATH_NO_WINNER;
+}
+
+static bool generate_actions_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct generate_actions_ctx_t *ctx = (struct generate_actions_ctx_t*)vctx;
+	if (ctx->count < ctx->capacity) {
+		ctx->actions[ctx->count] = game_pack_action(action);
+	}
+	ctx->count++;
+	return true;
+}
+
+/* Stores up to capacity legal actions and returns how many there are in
+ * total; when that exceeds the capacity, call again with a larger buffer */
+ISOPATH_EXPORT unsigned int isopath_generate_actions(struct isopath_game_t *handle, uint32_t *actions, unsigned int capacity) {
+	struct generate_actions_ctx_t ctx = {
+		.actions = actions,
+		.capacity = capacity,
+	};
+	enumerate_valid_actions(handle->game, generate_actions_callback, &ctx);
+	return ctx.count;
+}
+
+/* Fails for illegal actions and once GAME_UNDO_CAPACITY actions have been
+ * applied without undoing any */
+ISOPATH_EXPORT bool isopath_apply(struct isopath_game_t *handle, uint32_t packed_action) {
+	struct action_t action;
+	game_unpack_action(packed_action, &action);
+	if ((handle->game->undo_depth == GAME_UNDO_CAPACITY) || !game_action_valid(handle->game, &action)) {
+		return false;
+	}
+	game_make_action(handle->game, &action);
+	return true;
+}
+
+/* Takes back the last action applied with isopath_apply */
+ISOPATH_EXPORT bool isopath_undo(struct isopath_game_t *handle) {
+	if (!handle->game->undo_depth) {
+		return false;
+	}
+	game_unmake_action(handle->game);
+	return true;
+}
+
+/* Static evaluation from the view of the side to move */
+ISOPATH_EXPORT float isopath_evaluate(struct isopath_game_t *handle) {
+	return strategy_evaluate(handle->game, &handle->strategy);
+}
+
+/* Iterative deepening search; zero for any of the limits means no limit,
+ * but at least one of them has to be given */
+ISOPATH_EXPORT bool isopath_search(struct isopath_game_t *handle, unsigned int depth, uint64_t node_budget, unsigned int time_ms, uint32_t *best_action, float *score) {
+	if (!depth && !node_budget && !time_ms) {
+		return false;
+	}
+	const struct search_params_t params = {
+		.strategy = &handle->strategy,
+		.depth = depth,
+		.iterative = true,
+		.node_budget = node_budget,
+		.time_budget = time_ms / 1000.,
+		.ttable = handle->ttable,
+	};
+	struct search_result_t result;
+	if (!search_best_action(handle->game, &params, &result)) {
+		return false;
+	}
+	*best_action = game_pack_action(&result.best_action);
+	if (score) {
+		*score = result.score;
+	}
+	return true;
+}
+
+ISOPATH_EXPORT bool isopath_action_to_string(uint32_t packed_action, char *buffer, size_t buffer_size) {
+	if (buffer_size < ACTION_STRING_MAXLEN) {
+		return false;
+	}
+	struct action_t action;
+	game_unpack_action(packed_action, &action);
+	action_to_string(buffer, buffer_size, &action);
+	return true;
+}
+
+ISOPATH_EXPORT bool isopath_action_from_string(const char *string, uint32_t *packed_action) {
+	struct action_t action;
+	if (!action_from_string(string, &action)) {
+		return false;
+	}
+	for (int i = 0; i < 2; i++) {
+		if ((action.moves[i].src_tile > 0x7f) || (action.moves[i].dst_tile > 0x7f)) {
+			return false;
+		}
+	}
+	*packed_action = game_pack_action(&action);
+	return true;
+}
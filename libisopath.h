@@ -0,0 +1,69 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __LIBISOPATH_H__
+#define __LIBISOPATH_H__
+
+/* Embedding API of libisopath. This header is self-contained so that it can
+ * be used from FFI bindings; a game is an opaque handle and actions are
+ * exchanged in their packed 32-bit form (two 16-bit moves of 2 bits type
+ * and 7 bits each for source and destination tile), which is the same
+ * encoding that game records use. Sides are ISOPATH_TRENCH and
+ * ISOPATH_CLIMB, positions are strings with one character per tile: '0',
+ * '1' or '2' for the height of an empty tile, 'T' or 'C' for a piece.
+ *
+ * Incompatible changes increase ISOPATH_API_VERSION. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define ISOPATH_API_VERSION		1
+
+#define ISOPATH_TRENCH			0
+#define ISOPATH_CLIMB			1
+#define ISOPATH_NO_WINNER		-1
+
+struct isopath_game_t;
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+unsigned int isopath_api_version(void);
+struct isopath_game_t *isopath_game_new(unsigned int n);
+void isopath_game_free(struct isopath_game_t *handle);
+bool isopath_set_hash_size(struct isopath_game_t *handle, size_t bytes);
+bool isopath_load_weights(struct isopath_game_t *handle, const char *filename);
+void isopath_reset(struct isopath_game_t *handle);
+bool isopath_set_position(struct isopath_game_t *handle, const char *position, int side);
+bool isopath_get_position(const struct isopath_game_t *handle, char *buffer, size_t buffer_size);
+int isopath_side_to_move(const struct isopath_game_t *handle);
+uint64_t isopath_hash(const struct isopath_game_t *handle);
+int isopath_winner(const struct isopath_game_t *handle);
+unsigned int isopath_generate_actions(struct isopath_game_t *handle, uint32_t *actions, unsigned int capacity);
+bool isopath_apply(struct isopath_game_t *handle, uint32_t action);
+bool isopath_undo(struct isopath_game_t *handle);
+float isopath_evaluate(struct isopath_game_t *handle);
+bool isopath_search(struct isopath_game_t *handle, unsigned int depth, uint64_t node_budget, unsigned int time_ms, uint32_t *best_action, float *score);
+bool isopath_action_to_string(uint32_t action, char *buffer, size_t buffer_size);
+bool isopath_action_from_string(const char *string, uint32_t *action);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
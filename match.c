@@ -0,0 +1,212 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "match.h"
+#include "parallel.h"
+#include "history.h"
+#include "trace.h"
+#include "rng.h"
+
+#define PAIR_PENDING		0xff
+
+struct match_ctx_t {
+	const struct match_params_t *params;
+	atomic_uint next_pair;
+	atomic_bool stop;
+	pthread_mutex_t lock;
+	/* Candidate's points (0, 1 or 2) of every pair as first * 3 + second,
+	 * evaluated strictly in pair order so that the result does not depend on
+	 * thread timing */
+	uint8_t *pair_points;
+	unsigned int evaluated_pairs;
+	struct match_results_t results;
+};
+
+static double logistic_score(double elo) {
+	return 1 / (1 + pow(10, -elo / 400));
+}
+
+static double logistic_elo(double score) {
+	if (score <= 0) {
+		return -INFINITY;
+	} else if (score >= 1) {
+		return INFINITY;
+	}
+	return 400 * log10(score / (1 - score));
+}
+
+static unsigned int candidate_points(enum game_result_t result) {
+	switch (result) {
+		case RESULT_WIN: return 2;
+		case RESULT_DRAW: return 1;
+		case RESULT_LOSS: break;
+	}
+	return 0;
+}
+
+/* Recomputes LLR, decision and Elo estimate from the pentanomial counts.
+ * The LLR uses the normal approximation of the generalized SPRT on the pair
+ * scores, which stays valid when the two games of a pair are correlated. */
+void match_evaluate(const struct match_params_t *params, struct match_results_t *results) {
+	results->llr_lower = (params->beta > 0) ? log(params->beta / (1 - params->alpha)) : -INFINITY;
+	results->llr_upper = (params->alpha > 0) ? log((1 - params->beta) / params->alpha) : INFINITY;
+	results->llr = 0;
+	results->decision = SPRT_UNDECIDED;
+	results->elo = 0;
+	results->elo_lower = -INFINITY;
+	results->elo_upper = INFINITY;
+	if (results->pairs == 0) {
+		return;
+	}
+
+	const double pairs = results->pairs;
+	double mean = 0;
+	for (unsigned int i = 0; i < 5; i++) {
+		mean += results->pentanomial[i] * (i / 4.);
+	}
+	mean /= pairs;
+	double variance = 0;
+	for (unsigned int i = 0; i < 5; i++) {
+		variance += results->pentanomial[i] * ((i / 4.) - mean) * ((i / 4.) - mean);
+	}
+	variance /= pairs;
+
+	const double deviation = 1.959964 * sqrt(variance / pairs);
+	results->elo = logistic_elo(mean);
+	results->elo_lower = logistic_elo(mean - deviation);
+	results->elo_upper = logistic_elo(mean + deviation);
+
+	if (variance > 0) {
+		const double score0 = logistic_score(params->elo0);
+		const double score1 = logistic_score(params->elo1);
+		results->llr = pairs * (score1 - score0) * ((2 * mean) - score0 - score1) / (2 * variance);
+	}
+	if (results->llr >= results->llr_upper) {
+		results->decision = SPRT_ACCEPT_H1;
+	} else if (results->llr <= results->llr_lower) {
+		results->decision = SPRT_ACCEPT_H0;
+	}
+}
+
+const char *sprt_decision_to_string(enum sprt_decision_t decision) {
+	switch (decision) {
+		case SPRT_UNDECIDED: return "undecided";
+		case SPRT_ACCEPT_H0: return "H0 accepted";
+		case SPRT_ACCEPT_H1: return "H1 accepted";
+	}
+	return "?";
+}
+
+static void match_report_progress(const struct match_results_t *results) {
+	fprintf(stderr, "Pairs %u: +%u -%u =%u, LLR %.2f [%.2f, %.2f], Elo %+.1f [%+.1f, %+.1f]\n", results->pairs, results->wins, results->losses, results->draws, results->llr, results->llr_lower, results->llr_upper, results->elo, results->elo_lower, results->elo_upper);
+}
+
+static void match_count_game(struct match_results_t *results, unsigned int points) {
+	switch (points) {
+		case 2: results->wins++; break;
+		case 1: results->draws++; break;
+		default: results->losses++; break;
+	}
+}
+
+static void match_finish_pair(struct match_ctx_t *ctx, unsigned int pair_index, enum game_result_t first, enum game_result_t second) {
+	const struct match_params_t *params = ctx->params;
+	struct match_results_t *results = &ctx->results;
+	pthread_mutex_lock(&ctx->lock);
+	ctx->pair_points[pair_index] = (candidate_points(first) * 3) + candidate_points(second);
+	while ((ctx->evaluated_pairs < params->max_pairs) && (ctx->pair_points[ctx->evaluated_pairs] != PAIR_PENDING) && (results->decision == SPRT_UNDECIDED)) {
+		const unsigned int points = ctx->pair_points[ctx->evaluated_pairs++];
+		match_count_game(results, points / 3);
+		match_count_game(results, points % 3);
+		results->pairs++;
+		results->pentanomial[(points / 3) + (points % 3)]++;
+		match_evaluate(params, results);
+		if (params->report_interval && ((results->pairs % params->report_interval) == 0)) {
+			match_report_progress(results);
+		}
+	}
+	if (results->decision != SPRT_UNDECIDED) {
+		atomic_store(&ctx->stop, true);
+	}
+	pthread_mutex_unlock(&ctx->lock);
+}
+
+static void match_thread(unsigned int thread_id, void *vctx) {
+	struct match_ctx_t *ctx = (struct match_ctx_t*)vctx;
+	const struct match_params_t *params = ctx->params;
+	struct game_t *game = game_init(params->n);
+	struct history_t *history = history_init(params->playout_params.max_plies + 1);
+	if (!game || !history) {
+		fprintf(stderr, "fatal: cannot allocate match game in thread %u.\n", thread_id);
+		abort();
+	}
+
+	while (!atomic_load(&ctx->stop)) {
+		unsigned int pair_index = atomic_fetch_add(&ctx->next_pair, 1);
+		if (pair_index >= params->max_pairs) {
+			break;
+		}
+
+		/* Both games of a pair share their random opening */
+		struct playout_params_t playout_params = params->playout_params;
+		uint64_t seed_state = params->playout_params.seed + pair_index;
+		playout_params.seed = rng_splitmix64(&seed_state);
+
+		game_reset(game);
+		enum game_result_t first = strategy_play_out(game, params->candidate, params->baseline, &playout_params, history);
+
+		game_reset(game);
+		enum game_result_t second = strategy_play_out(game, params->baseline, params->candidate, &playout_params, history);
+		if (second != RESULT_DRAW) {
+			second = (second == RESULT_WIN) ? RESULT_LOSS : RESULT_WIN;
+		}
+
+		match_finish_pair(ctx, pair_index, first, second);
+	}
+
+	trace_thread_flush();
+	history_free(history);
+	game_free(game);
+}
+
+void match_run(const struct match_params_t *params, struct match_results_t *results) {
+	struct match_ctx_t ctx = {
+		.params = params,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+	};
+	ctx.pair_points = malloc(params->max_pairs);
+	if (!ctx.pair_points) {
+		fprintf(stderr, "fatal: cannot allocate results of %u pairs.\n", params->max_pairs);
+		abort();
+	}
+	memset(ctx.pair_points, PAIR_PENDING, params->max_pairs);
+	match_evaluate(params, &ctx.results);
+	parallel_run(params->thread_count, match_thread, &ctx);
+	free(ctx.pair_points);
+	*results = ctx.results;
+}
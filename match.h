@@ -0,0 +1,74 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __MATCH_H__
+#define __MATCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "strategy.h"
+
+/* A match plays pairs of games between a candidate and a baseline strategy:
+ * both games of a pair start from the same (random) opening, each strategy
+ * moving first once. After every pair a sequential probability ratio test
+ * decides between H0 (the candidate is elo0 stronger) and H1 (it is elo1
+ * stronger) with error rates alpha and beta; the match stops as soon as
+ * either hypothesis is accepted or max_pairs have been played. Error rates
+ * of zero disable early stopping, so that exactly max_pairs are played. */
+struct match_params_t {
+	uint8_t n;
+	unsigned int thread_count;
+	unsigned int max_pairs;
+	struct playout_params_t playout_params;
+	const struct strategy_t *candidate;
+	const struct strategy_t *baseline;
+	double elo0, elo1;
+	double alpha, beta;
+	/* Print the running result to stderr every this many pairs, zero
+	 * disables progress reports */
+	unsigned int report_interval;
+};
+
+enum sprt_decision_t {
+	SPRT_UNDECIDED,
+	SPRT_ACCEPT_H0,
+	SPRT_ACCEPT_H1,
+};
+
+/* Counted from the view of the candidate. pentanomial[i] is the number of
+ * pairs in which the candidate scored i / 2 points. */
+struct match_results_t {
+	unsigned int pairs;
+	unsigned int wins, losses, draws;
+	unsigned int pentanomial[5];
+	double llr, llr_lower, llr_upper;
+	enum sprt_decision_t decision;
+	double elo, elo_lower, elo_upper;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+void match_evaluate(const struct match_params_t *params, struct match_results_t *results);
+const char *sprt_decision_to_string(enum sprt_decision_t decision);
+void match_run(const struct match_params_t *params, struct match_results_t *results);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
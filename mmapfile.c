@@ -0,0 +1,102 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mmapfile.h"
+
+struct mmapfile_t *mmapfile_open(const char *filename, bool writable) {
+	struct mmapfile_t *result = calloc(1, sizeof(struct mmapfile_t));
+	if (!result) {
+		return NULL;
+	}
+	result->fd = open(filename, writable ? O_RDWR : O_RDONLY);
+	if (result->fd == -1) {
+		perror(filename);
+		free(result);
+		return NULL;
+	}
+
+	struct stat statbuf;
+	if (fstat(result->fd, &statbuf)) {
+		perror(filename);
+		mmapfile_close(result);
+		return NULL;
+	}
+	result->length = statbuf.st_size;
+
+	if (result->length) {
+		/* Empty files can't be mapped, data stays NULL for them */
+		result->data = mmap(NULL, result->length, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, result->fd, 0);
+		if (result->data == MAP_FAILED) {
+			perror(filename);
+			result->data = NULL;
+			mmapfile_close(result);
+			return NULL;
+		}
+	}
+	return result;
+}
+
+/* Creates (or truncates) a file of the given length and maps it writable.
+ * The file is sparse, so untouched parts read as zero. */
+struct mmapfile_t *mmapfile_create(const char *filename, size_t length) {
+	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) {
+		perror(filename);
+		return NULL;
+	}
+	if (ftruncate(fd, length)) {
+		perror(filename);
+		close(fd);
+		return NULL;
+	}
+	close(fd);
+	return mmapfile_open(filename, true);
+}
+
+/* Writes modified pages of a writable mapping back to the file and waits for
+ * completion. */
+bool mmapfile_sync(struct mmapfile_t *mmapfile) {
+	if (mmapfile->data && msync(mmapfile->data, mmapfile->length, MS_SYNC)) {
+		perror("msync");
+		return false;
+	}
+	return true;
+}
+
+void mmapfile_close(struct mmapfile_t *mmapfile) {
+	if (!mmapfile) {
+		return;
+	}
+	if (mmapfile->data) {
+		munmap(mmapfile->data, mmapfile->length);
+	}
+	if (mmapfile->fd != -1) {
+		close(mmapfile->fd);
+	}
+	free(mmapfile);
+}
@@ -0,0 +1,42 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __MMAPFILE_H__
+#define __MMAPFILE_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+
+struct mmapfile_t {
+	int fd;
+	void *data;
+	size_t length;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+struct mmapfile_t *mmapfile_open(const char *filename, bool writable);
+struct mmapfile_t *mmapfile_create(const char *filename, size_t length);
+bool mmapfile_sync(struct mmapfile_t *mmapfile);
+void mmapfile_close(struct mmapfile_t *mmapfile);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,144 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include "notation.h"
+
+/* Positions are written with one character per tile: the height of an empty
+ * tile (0 for trench, 1 for neutral and 2 for climb height) or T and C for a
+ * trench or climb piece. */
+static const char tile_characters[TILE_STATE_COUNT] = {
+	[EMPTY_TRENCH] = '0',
+	[EMPTY_NEUTRAL] = '1',
+	[EMPTY_CLIMB] = '2',
+	[PIECE_TRENCH] = 'T',
+	[PIECE_CLIMB] = 'C',
+};
+
+const char *side_to_string(enum side_t side) {
+	return (side == TRENCH) ? "trench" : "climb";
+}
+
+bool side_from_string(const char *string, enum side_t *side) {
+	if (!strcmp(string, "trench")) {
+		*side = TRENCH;
+	} else if (!strcmp(string, "climb")) {
+		*side = CLIMB;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+void position_to_string(char *buffer, const struct game_t *game) {
+	for (int i = 0; i < NUMBER_TILES(game->n); i++) {
+		buffer[i] = tile_characters[game->board->tiles[i]];
+	}
+	buffer[NUMBER_TILES(game->n)] = 0;
+}
+
+/* Parses the tiles of a position for a board of size n */
+bool position_from_string(const char *string, uint8_t n, uint8_t *tiles) {
+	if (strlen(string) != NUMBER_TILES(n)) {
+		return false;
+	}
+	for (int i = 0; i < NUMBER_TILES(n); i++) {
+		const char *tile = memchr(tile_characters, string[i], TILE_STATE_COUNT);
+		if (!tile || !string[i]) {
+			return false;
+		}
+		tiles[i] = tile - tile_characters;
+	}
+	return true;
+}
+
+static int move_to_string(char *buffer, unsigned int buffer_size, const struct move_t *move) {
+	switch (move->type) {
+		case BUILD:
+			return snprintf(buffer, buffer_size, "B%u-%u", move->src_tile, move->dst_tile);
+
+		case MOVE:
+			return snprintf(buffer, buffer_size, "M%u-%u", move->src_tile, move->dst_tile);
+
+		case CAPTURE:
+			return snprintf(buffer, buffer_size, "C%u", move->dst_tile);
+	}
+	return snprintf(buffer, buffer_size, "?");
+}
+
+static bool move_from_string(const char *string, struct move_t *move) {
+	unsigned int src, dst;
+	int consumed = 0;
+	if ((string[0] == 'B') || (string[0] == 'M')) {
+		if ((sscanf(string + 1, "%u-%u%n", &src, &dst, &consumed) != 2) || string[1 + consumed]) {
+			return false;
+		}
+		*move = (struct move_t) {
+			.type = (string[0] == 'B') ? BUILD : MOVE,
+			.src_tile = src,
+			.dst_tile = dst,
+		};
+		return true;
+	} else if (string[0] == 'C') {
+		if ((sscanf(string + 1, "%u%n", &dst, &consumed) != 1) || string[1 + consumed]) {
+			return false;
+		}
+		*move = (struct move_t) {
+			.type = CAPTURE,
+			.dst_tile = dst,
+		};
+		return true;
+	}
+	return false;
+}
+
+/* Actions are written as two comma-separated moves, e.g. "B5-20,M1-6" for a
+ * build from tile 5 to tile 20 followed by moving a piece from tile 1 to tile
+ * 6 or "C12,M1-6" for a capture on tile 12 followed by a movement. */
+void action_to_string(char *buffer, unsigned int buffer_size, const struct action_t *action) {
+	int len = move_to_string(buffer, buffer_size, &action->moves[0]);
+	if ((len < 0) || (len >= buffer_size)) {
+		return;
+	}
+	len += snprintf(buffer + len, buffer_size - len, ",");
+	if (len >= buffer_size) {
+		return;
+	}
+	move_to_string(buffer + len, buffer_size - len, &action->moves[1]);
+}
+
+/* Parses the notation written by action_to_string. Only the syntax is
+ * checked, not whether the action is legal. */
+bool action_from_string(const char *string, struct action_t *action) {
+	char buffer[ACTION_STRING_MAXLEN];
+	if (strlen(string) >= sizeof(buffer)) {
+		return false;
+	}
+	strcpy(buffer, string);
+	char *second = strchr(buffer, ',');
+	if (!second) {
+		return false;
+	}
+	*second++ = 0;
+	return move_from_string(buffer, &action->moves[0]) && move_from_string(second, &action->moves[1]);
+}
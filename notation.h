@@ -0,0 +1,44 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __NOTATION_H__
+#define __NOTATION_H__
+
+#include <stdbool.h>
+#include "game.h"
+
+/* Enough for "B123-123,B123-123" plus terminator */
+#define ACTION_STRING_MAXLEN		24
+
+/* One character per tile plus terminator */
+#define POSITION_STRING_MAXLEN(n)	(NUMBER_TILES(n) + 1)
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+const char *side_to_string(enum side_t side);
+bool side_from_string(const char *string, enum side_t *side);
+void position_to_string(char *buffer, const struct game_t *game);
+bool position_from_string(const char *string, uint8_t n, uint8_t *tiles);
+void action_to_string(char *buffer, unsigned int buffer_size, const struct action_t *action);
+bool action_from_string(const char *string, struct action_t *action);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
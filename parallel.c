@@ -0,0 +1,74 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "parallel.h"
+
+struct parallel_thread_t {
+	pthread_t thread;
+	unsigned int thread_id;
+	void (*thread_fnc)(unsigned int thread_id, void *ctx);
+	void *ctx;
+};
+
+unsigned int parallel_cpu_count(void) {
+	long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (cpu_count > 0) ? cpu_count : 1;
+}
+
+static void *parallel_thread(void *vthread) {
+	struct parallel_thread_t *thread = (struct parallel_thread_t*)vthread;
+	thread->thread_fnc(thread->thread_id, thread->ctx);
+	return NULL;
+}
+
+/* Runs thread_fnc in thread_count threads and waits for all of them to
+ * finish. Work distribution is up to the caller, typically by having every
+ * thread fetch work items through an atomic counter in ctx. */
+void parallel_run(unsigned int thread_count, void (*thread_fnc)(unsigned int thread_id, void *ctx), void *ctx) {
+	if (thread_count <= 1) {
+		thread_fnc(0, ctx);
+		return;
+	}
+
+	struct parallel_thread_t *threads = calloc(thread_count, sizeof(struct parallel_thread_t));
+	if (!threads) {
+		fprintf(stderr, "fatal: cannot allocate thread pool.\n");
+		abort();
+	}
+	for (unsigned int i = 0; i < thread_count; i++) {
+		threads[i].thread_id = i;
+		threads[i].thread_fnc = thread_fnc;
+		threads[i].ctx = ctx;
+		if (pthread_create(&threads[i].thread, NULL, parallel_thread, &threads[i])) {
+			fprintf(stderr, "fatal: cannot create thread %u.\n", i);
+			abort();
+		}
+	}
+	for (unsigned int i = 0; i < thread_count; i++) {
+		pthread_join(threads[i].thread, NULL);
+	}
+	free(threads);
+}
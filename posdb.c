@@ -0,0 +1,490 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "posdb.h"
+#include "gamerecord.h"
+#include "parallel.h"
+#include "strategy.h"
+#include "monotime.h"
+
+/* Building the database happens in two phases: first, all threads replay
+ * their share of games and collect one sample per position into a local
+ * buffer. Whenever the buffer is full it is sorted, aggregated and spilled to
+ * disk as a run. Then, all runs are merged into one sorted, aggregated file
+ * which is finally inserted into the open-addressing table. Because the table
+ * index consists of the topmost hash bits, inserting in sorted order fills
+ * the table front-to-back, so the table does not need to fit into RAM
+ * either. */
+
+struct posdb_run_t {
+	char *filename;
+	FILE *f;
+	struct posdb_entry_t current;
+};
+
+struct posdb_build_ctx_t {
+	const struct posdb_build_params_t *params;
+	struct gamerecord_t *records;
+	unsigned int record_count;
+	atomic_uint next_record;
+	uint8_t n;
+	size_t entries_per_thread;
+
+	pthread_mutex_t lock;
+	struct posdb_run_t *runs;
+	unsigned int run_count;
+	unsigned long long sample_count;
+	atomic_bool failed;
+};
+
+struct posdb_thread_ctx_t {
+	struct posdb_build_ctx_t *build;
+	struct posdb_entry_t *buffer;
+	size_t used;
+	int winner;
+};
+
+static uint64_t posdb_nonzero_hash(uint64_t hash) {
+	return hash ? hash : 1;
+}
+
+static int posdb_entry_cmp(const void *v_entry1, const void *v_entry2) {
+	const struct posdb_entry_t *entry1 = (const struct posdb_entry_t*)v_entry1;
+	const struct posdb_entry_t *entry2 = (const struct posdb_entry_t*)v_entry2;
+	if (entry1->hash < entry2->hash) {
+		return -1;
+	} else if (entry1->hash == entry2->hash) {
+		return 0;
+	} else {
+		return 1;
+	}
+}
+
+static void posdb_entry_accumulate(struct posdb_entry_t *target, const struct posdb_entry_t *source) {
+	target->visits += source->visits;
+	target->wins[0] += source->wins[0];
+	target->wins[1] += source->wins[1];
+	target->draws += source->draws;
+}
+
+static size_t posdb_aggregate_sorted(struct posdb_entry_t *entries, size_t count) {
+	if (count == 0) {
+		return 0;
+	}
+	size_t out = 0;
+	for (size_t i = 1; i < count; i++) {
+		if (entries[i].hash == entries[out].hash) {
+			posdb_entry_accumulate(&entries[out], &entries[i]);
+		} else {
+			entries[++out] = entries[i];
+		}
+	}
+	return out + 1;
+}
+
+static void posdb_spill_run(struct posdb_thread_ctx_t *thread) {
+	struct posdb_build_ctx_t *build = thread->build;
+	if (thread->used == 0) {
+		return;
+	}
+	qsort(thread->buffer, thread->used, sizeof(struct posdb_entry_t), posdb_entry_cmp);
+	size_t count = posdb_aggregate_sorted(thread->buffer, thread->used);
+
+	pthread_mutex_lock(&build->lock);
+	struct posdb_run_t *runs = realloc(build->runs, sizeof(struct posdb_run_t) * (build->run_count + 1));
+	if (!runs) {
+		pthread_mutex_unlock(&build->lock);
+		fprintf(stderr, "posdb: cannot allocate run list.\n");
+		build->failed = true;
+		thread->used = 0;
+		return;
+	}
+	build->runs = runs;
+	unsigned int run_index = build->run_count++;
+	build->sample_count += thread->used;
+	char filename[256];
+	snprintf(filename, sizeof(filename), "%s/posdb_run_%d_%u.tmp", build->params->tmpdir, getpid(), run_index);
+	build->runs[run_index] = (struct posdb_run_t) {
+		.filename = strdup(filename),
+	};
+	pthread_mutex_unlock(&build->lock);
+
+	FILE *f = fopen(filename, "wb");
+	if (!f || (fwrite(thread->buffer, sizeof(struct posdb_entry_t), count, f) != count)) {
+		perror(filename);
+		build->failed = true;
+	}
+	if (f) {
+		fclose(f);
+	}
+	thread->used = 0;
+}
+
+static void posdb_collect_position(struct game_t *game, unsigned int ply, const struct action_t *action, void *vctx) {
+	struct posdb_thread_ctx_t *thread = (struct posdb_thread_ctx_t*)vctx;
+	if (thread->used == thread->build->entries_per_thread) {
+		posdb_spill_run(thread);
+	}
+	struct posdb_entry_t *entry = &thread->buffer[thread->used++];
+	*entry = (struct posdb_entry_t) {
+		.hash = posdb_nonzero_hash(game->hash),
+		.visits = 1,
+	};
+	if (thread->winner == -1) {
+		entry->draws = 1;
+	} else {
+		entry->wins[thread->winner] = 1;
+	}
+}
+
+static void posdb_collect_thread(unsigned int thread_id, void *vctx) {
+	struct posdb_build_ctx_t *build = (struct posdb_build_ctx_t*)vctx;
+	struct posdb_thread_ctx_t thread = {
+		.build = build,
+		.buffer = malloc(sizeof(struct posdb_entry_t) * build->entries_per_thread),
+	};
+	if (!thread.buffer) {
+		fprintf(stderr, "posdb: cannot allocate run buffer in thread %u.\n", thread_id);
+		build->failed = true;
+		return;
+	}
+
+	struct game_t *game = NULL;
+	while (true) {
+		unsigned int record_index = atomic_fetch_add(&build->next_record, 1);
+		if (record_index >= build->record_count) {
+			break;
+		}
+		const struct gamerecord_t *record = &build->records[record_index];
+		if (!game || (game->n != record->header->n)) {
+			if (game) {
+				game_free(game);
+			}
+			game = game_init(record->header->n);
+			if (!game) {
+				fprintf(stderr, "posdb: cannot allocate game in thread %u.\n", thread_id);
+				build->failed = true;
+				break;
+			}
+		}
+
+		const enum side_t first_side = record->header->first_side;
+		const enum side_t second_side = (first_side == TRENCH) ? CLIMB : TRENCH;
+		if (record->header->result == RESULT_WIN) {
+			thread.winner = first_side;
+		} else if (record->header->result == RESULT_LOSS) {
+			thread.winner = second_side;
+		} else {
+			thread.winner = -1;
+		}
+		gamerecord_replay(record, game, posdb_collect_position, &thread);
+	}
+	posdb_spill_run(&thread);
+
+	if (game) {
+		game_free(game);
+	}
+	free(thread.buffer);
+}
+
+static bool posdb_run_advance(struct posdb_run_t *run) {
+	if (fread(&run->current, sizeof(struct posdb_entry_t), 1, run->f) != 1) {
+		fclose(run->f);
+		run->f = NULL;
+		return false;
+	}
+	return true;
+}
+
+/* Merges all runs into one sorted file; returns the number of distinct
+ * positions or -1 on error. */
+static long long posdb_merge_runs(struct posdb_build_ctx_t *build, const char *merged_filename) {
+	FILE *out = fopen(merged_filename, "wb");
+	if (!out) {
+		perror(merged_filename);
+		return -1;
+	}
+
+	/* Binary min-heap of run indices, ordered by their current hash */
+	unsigned int *heap = malloc(sizeof(unsigned int) * (build->run_count + 1));
+	if (!heap) {
+		fprintf(stderr, "posdb: cannot allocate merge heap.\n");
+		fclose(out);
+		return -1;
+	}
+	unsigned int heap_size = 0;
+	for (unsigned int i = 0; i < build->run_count; i++) {
+		struct posdb_run_t *run = &build->runs[i];
+		run->f = fopen(run->filename, "rb");
+		if (!run->f) {
+			perror(run->filename);
+			fclose(out);
+			free(heap);
+			return -1;
+		}
+		setvbuf(run->f, NULL, _IOFBF, 1024 * 1024);
+		if (posdb_run_advance(run)) {
+			unsigned int pos = heap_size++;
+			while ((pos > 0) && (build->runs[heap[(pos - 1) / 2]].current.hash > run->current.hash)) {
+				heap[pos] = heap[(pos - 1) / 2];
+				pos = (pos - 1) / 2;
+			}
+			heap[pos] = i;
+		}
+	}
+
+	long long distinct = 0;
+	struct posdb_entry_t pending = { 0 };
+	bool have_pending = false;
+	while (heap_size) {
+		struct posdb_run_t *run = &build->runs[heap[0]];
+		if (have_pending && (pending.hash == run->current.hash)) {
+			posdb_entry_accumulate(&pending, &run->current);
+		} else {
+			if (have_pending) {
+				fwrite(&pending, sizeof(pending), 1, out);
+				distinct++;
+			}
+			pending = run->current;
+			have_pending = true;
+		}
+
+		/* Advance the top run and sift down */
+		unsigned int top = heap[0];
+		if (!posdb_run_advance(run)) {
+			top = heap[--heap_size];
+		}
+		unsigned int pos = 0;
+		while (true) {
+			unsigned int child = (2 * pos) + 1;
+			if (child >= heap_size) {
+				break;
+			}
+			if ((child + 1 < heap_size) && (build->runs[heap[child + 1]].current.hash < build->runs[heap[child]].current.hash)) {
+				child++;
+			}
+			if (build->runs[heap[child]].current.hash >= build->runs[top].current.hash) {
+				break;
+			}
+			heap[pos] = heap[child];
+			pos = child;
+		}
+		if (heap_size) {
+			heap[pos] = top;
+		}
+	}
+	if (have_pending) {
+		fwrite(&pending, sizeof(pending), 1, out);
+		distinct++;
+	}
+	free(heap);
+	if (fclose(out)) {
+		perror(merged_filename);
+		return -1;
+	}
+	return distinct;
+}
+
+static bool posdb_write_table(const char *merged_filename, const char *output_filename, uint8_t n, unsigned long long distinct, unsigned long long game_count) {
+	/* Keep the load factor at or below 50% */
+	unsigned int table_bits = POSDB_MIN_TABLE_BITS;
+	while ((1ULL << table_bits) < 2 * distinct) {
+		table_bits++;
+	}
+	if (table_bits > POSDB_MAX_TABLE_BITS) {
+		fprintf(stderr, "%s: %llu positions do not fit into a position database.\n", output_filename, distinct);
+		return false;
+	}
+	const size_t table_entries = 1ULL << table_bits;
+	struct mmapfile_t *db = mmapfile_create(output_filename, sizeof(struct posdb_header_t) + (sizeof(struct posdb_entry_t) * table_entries));
+	if (!db) {
+		return false;
+	}
+	struct posdb_header_t *header = (struct posdb_header_t*)db->data;
+	struct posdb_entry_t *entries = (struct posdb_entry_t*)(header + 1);
+	*header = (struct posdb_header_t) {
+		.magic = POSDB_MAGIC,
+		.version = POSDB_VERSION,
+		.table_bits = table_bits,
+		.n = n,
+		.entry_count = distinct,
+		.game_count = game_count,
+	};
+
+	FILE *f = fopen(merged_filename, "rb");
+	if (!f) {
+		perror(merged_filename);
+		mmapfile_close(db);
+		return false;
+	}
+	setvbuf(f, NULL, _IOFBF, 1024 * 1024);
+	const uint64_t mask = table_entries - 1;
+	struct posdb_entry_t entry;
+	while (fread(&entry, sizeof(entry), 1, f) == 1) {
+		uint64_t index = entry.hash >> (64 - table_bits);
+		while (entries[index].hash) {
+			index = (index + 1) & mask;
+		}
+		entries[index] = entry;
+	}
+	fclose(f);
+	mmapfile_close(db);
+	return true;
+}
+
+bool posdb_build(const struct posdb_build_params_t *params) {
+	struct posdb_build_ctx_t build = {
+		.params = params,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+	};
+	const unsigned int thread_count = params->thread_count ? params->thread_count : 1;
+	build.entries_per_thread = params->memory_bytes / thread_count / sizeof(struct posdb_entry_t);
+	if (build.entries_per_thread < 1024) {
+		build.entries_per_thread = 1024;
+	}
+
+	/* Index all records of all input files first so threads can pick them
+	 * by number */
+	struct gamerecord_reader_t **readers = calloc(params->record_file_count, sizeof(struct gamerecord_reader_t*));
+	unsigned int record_capacity = 0;
+	bool success = false;
+	if (!readers) {
+		return false;
+	}
+	for (unsigned int i = 0; i < params->record_file_count; i++) {
+		readers[i] = gamerecord_reader_open(params->record_filenames[i]);
+		if (!readers[i]) {
+			goto cleanup;
+		}
+		struct gamerecord_t record;
+		while (gamerecord_next(readers[i], &record)) {
+			if (build.record_count == 0) {
+				build.n = record.header->n;
+			} else if (record.header->n != build.n) {
+				fprintf(stderr, "%s: game of Iso-Path(%u) among games of Iso-Path(%u).\n", params->record_filenames[i], record.header->n, build.n);
+				goto cleanup;
+			}
+			if (build.record_count == record_capacity) {
+				record_capacity = record_capacity ? (2 * record_capacity) : 4096;
+				struct gamerecord_t *records = realloc(build.records, sizeof(struct gamerecord_t) * record_capacity);
+				if (!records) {
+					fprintf(stderr, "posdb: cannot allocate record index.\n");
+					goto cleanup;
+				}
+				build.records = records;
+			}
+			build.records[build.record_count++] = record;
+		}
+	}
+
+	double t0 = monotime_secs();
+	parallel_run(thread_count, posdb_collect_thread, &build);
+	if (build.failed) {
+		goto cleanup;
+	}
+	double t1 = monotime_secs();
+	fprintf(stderr, "posdb: collected %llu positions of %u games into %u runs in %.1f secs\n", build.sample_count, build.record_count, build.run_count, t1 - t0);
+
+	char merged_filename[256];
+	snprintf(merged_filename, sizeof(merged_filename), "%s/posdb_merged_%d.tmp", params->tmpdir, getpid());
+	long long distinct = posdb_merge_runs(&build, merged_filename);
+	if (distinct >= 0) {
+		double t2 = monotime_secs();
+		fprintf(stderr, "posdb: merged %lld distinct positions in %.1f secs\n", distinct, t2 - t1);
+		success = posdb_write_table(merged_filename, params->output_filename, build.n, distinct, build.record_count);
+		fprintf(stderr, "posdb: wrote table in %.1f secs\n", monotime_secs() - t2);
+	}
+	unlink(merged_filename);
+
+cleanup:
+	for (unsigned int i = 0; i < build.run_count; i++) {
+		if (build.runs[i].f) {
+			fclose(build.runs[i].f);
+		}
+		unlink(build.runs[i].filename);
+		free(build.runs[i].filename);
+	}
+	free(build.runs);
+	free(build.records);
+	for (unsigned int i = 0; i < params->record_file_count; i++) {
+		gamerecord_reader_close(readers[i]);
+	}
+	free(readers);
+	return success;
+}
+
+struct posdb_t *posdb_open(const char *filename) {
+	struct posdb_t *db = calloc(1, sizeof(struct posdb_t));
+	if (!db) {
+		return NULL;
+	}
+	db->file = mmapfile_open(filename, false);
+	if (!db->file) {
+		free(db);
+		return NULL;
+	}
+	db->header = (const struct posdb_header_t*)db->file->data;
+	if ((db->file->length < sizeof(struct posdb_header_t)) || (db->header->magic != POSDB_MAGIC) || (db->header->version != POSDB_VERSION)
+			|| (db->header->table_bits < POSDB_MIN_TABLE_BITS) || (db->header->table_bits > POSDB_MAX_TABLE_BITS)
+			|| (db->file->length != sizeof(struct posdb_header_t) + (sizeof(struct posdb_entry_t) << db->header->table_bits))) {
+		fprintf(stderr, "%s: not a valid position database.\n", filename);
+		posdb_close(db);
+		return NULL;
+	}
+	db->entries = (const struct posdb_entry_t*)(db->header + 1);
+	db->mask = (1ULL << db->header->table_bits) - 1;
+	return db;
+}
+
+const struct posdb_entry_t *posdb_lookup(const struct posdb_t *db, uint64_t hash) {
+	hash = posdb_nonzero_hash(hash);
+	uint64_t index = hash >> (64 - db->header->table_bits);
+	while (db->entries[index].hash) {
+		if (db->entries[index].hash == hash) {
+			return &db->entries[index];
+		}
+		index = (index + 1) & db->mask;
+	}
+	return NULL;
+}
+
+/* Positions of a different board size are never found */
+const struct posdb_entry_t *posdb_query(const struct posdb_t *db, const struct game_t *game) {
+	if (game->n != db->header->n) {
+		return NULL;
+	}
+	return posdb_lookup(db, game->hash);
+}
+
+void posdb_close(struct posdb_t *db) {
+	if (!db) {
+		return;
+	}
+	mmapfile_close(db->file);
+	free(db);
+}
@@ -0,0 +1,81 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __POSDB_H__
+#define __POSDB_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game.h"
+#include "mmapfile.h"
+
+#define POSDB_MAGIC				0x42445049		/* "IPDB" */
+#define POSDB_VERSION			2
+
+/* Tables hold a power of two of entries; anything outside this range is not
+ * a table posdb_build could have written */
+#define POSDB_MIN_TABLE_BITS	10
+#define POSDB_MAX_TABLE_BITS	48
+
+struct posdb_header_t {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t table_bits;
+	uint32_t n;
+	uint64_t entry_count;
+	uint64_t game_count;
+};
+
+/* Wins are indexed by enum side_t. A hash of zero marks an empty slot, hashes
+ * that are actually zero are stored as one. */
+struct posdb_entry_t {
+	uint64_t hash;
+	uint32_t visits;
+	uint32_t wins[2];
+	uint32_t draws;
+};
+
+struct posdb_t {
+	struct mmapfile_t *file;
+	const struct posdb_header_t *header;
+	const struct posdb_entry_t *entries;
+	uint64_t mask;
+};
+
+struct posdb_build_params_t {
+	const char **record_filenames;
+	unsigned int record_file_count;
+	const char *output_filename;
+	const char *tmpdir;
+	size_t memory_bytes;
+	unsigned int thread_count;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+bool posdb_build(const struct posdb_build_params_t *params);
+struct posdb_t *posdb_open(const char *filename);
+const struct posdb_entry_t *posdb_lookup(const struct posdb_t *db, uint64_t hash);
+const struct posdb_entry_t *posdb_query(const struct posdb_t *db, const struct game_t *game);
+void posdb_close(struct posdb_t *db);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
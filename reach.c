@@ -0,0 +1,555 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <sys/resource.h>
+#include "reach.h"
+#include "game.h"
+#include "mmapfile.h"
+#include "parallel.h"
+#include "monotime.h"
+
+/* Breadth-first enumeration of all positions reachable from the starting
+ * position. Every layer is kept on disk as a sorted file of packed positions,
+ * as is the set of all positions visited so far. Expanding a layer produces
+ * sorted runs (one whenever a thread's memory share is exhausted) which are
+ * then merged, deduplicated and stripped of already visited positions in a
+ * single streaming pass. Memory consumption is therefore bounded by the
+ * configured amount no matter how large the layers get. With a checkpoint
+ * file, layers are kept next to it and an interrupted enumeration resumes
+ * with the last completed layer. */
+
+#define REACH_CHUNK_SIZE		256
+#define REACH_CHECKPOINT_MAGIC		0x43525049		/* "IPRC" */
+#define REACH_CHECKPOINT_VERSION	1
+
+/* Points to the last completely written layer. Layer files carry their depth
+ * in the file name, so replacing the checkpoint atomically is enough to
+ * advance a whole layer. */
+struct reach_checkpoint_t {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t n;
+	uint32_t depth;
+	uint64_t frontier_count;
+	uint64_t total_count;
+};
+
+struct reach_ctx_t {
+	const struct reach_params_t *params;
+	const struct packed_position_t *frontier;
+	size_t frontier_count;
+	atomic_size_t next_index;
+	size_t keys_per_thread;
+
+	pthread_mutex_t lock;
+	char **run_filenames;
+	unsigned int run_count;
+	unsigned long long terminal_count;
+	atomic_bool failed;
+};
+
+struct reach_thread_ctx_t {
+	struct reach_ctx_t *reach;
+	struct packed_position_t *buffer;
+	size_t used;
+};
+
+struct keystream_t {
+	FILE *f;
+	struct packed_position_t current;
+	bool valid;
+};
+
+static int packed_position_cmp(const struct packed_position_t *pos1, const struct packed_position_t *pos2) {
+	if (pos1->words[1] != pos2->words[1]) {
+		return (pos1->words[1] < pos2->words[1]) ? -1 : 1;
+	}
+	if (pos1->words[0] != pos2->words[0]) {
+		return (pos1->words[0] < pos2->words[0]) ? -1 : 1;
+	}
+	return 0;
+}
+
+static int packed_position_qsort_cmp(const void *v_pos1, const void *v_pos2) {
+	return packed_position_cmp((const struct packed_position_t*)v_pos1, (const struct packed_position_t*)v_pos2);
+}
+
+static void reach_tmpfile(char *filename, size_t size, const struct reach_params_t *params, const char *name) {
+	snprintf(filename, size, "%s/reach_%d_%s.tmp", params->tmpdir, getpid(), name);
+}
+
+static void reach_spill_run(struct reach_thread_ctx_t *thread) {
+	struct reach_ctx_t *reach = thread->reach;
+	if (thread->used == 0) {
+		return;
+	}
+	qsort(thread->buffer, thread->used, sizeof(struct packed_position_t), packed_position_qsort_cmp);
+	size_t count = 1;
+	for (size_t i = 1; i < thread->used; i++) {
+		if (packed_position_cmp(&thread->buffer[i], &thread->buffer[count - 1])) {
+			thread->buffer[count++] = thread->buffer[i];
+		}
+	}
+
+	char filename[256];
+	pthread_mutex_lock(&reach->lock);
+	char run_name[32];
+	snprintf(run_name, sizeof(run_name), "run%u", reach->run_count);
+	reach_tmpfile(filename, sizeof(filename), reach->params, run_name);
+	reach->run_filenames = realloc(reach->run_filenames, sizeof(char*) * (reach->run_count + 1));
+	reach->run_filenames[reach->run_count++] = strdup(filename);
+	pthread_mutex_unlock(&reach->lock);
+
+	FILE *f = fopen(filename, "wb");
+	if (!f || (fwrite(thread->buffer, sizeof(struct packed_position_t), count, f) != count)) {
+		perror(filename);
+		reach->failed = true;
+	}
+	if (f) {
+		fclose(f);
+	}
+	thread->used = 0;
+}
+
+static bool reach_successor_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct reach_thread_ctx_t *thread = (struct reach_thread_ctx_t*)vctx;
+	if (thread->used == thread->reach->keys_per_thread) {
+		reach_spill_run(thread);
+	}
+	const enum side_t next_side = (game->side_turn == TRENCH) ? CLIMB : TRENCH;
+	game_pack_position(game, next_side, &thread->buffer[thread->used++]);
+	return true;
+}
+
+static void reach_expand_thread(unsigned int thread_id, void *vctx) {
+	struct reach_ctx_t *reach = (struct reach_ctx_t*)vctx;
+	struct reach_thread_ctx_t thread = {
+		.reach = reach,
+		.buffer = malloc(sizeof(struct packed_position_t) * reach->keys_per_thread),
+	};
+	struct game_t *game = game_init(reach->params->n);
+	if (!thread.buffer || !game) {
+		fprintf(stderr, "reach: cannot allocate expansion buffer in thread %u.\n", thread_id);
+		reach->failed = true;
+		free(thread.buffer);
+		if (game) {
+			game_free(game);
+		}
+		return;
+	}
+
+	unsigned long long terminal = 0;
+	while (true) {
+		size_t start = atomic_fetch_add(&reach->next_index, REACH_CHUNK_SIZE);
+		if (start >= reach->frontier_count) {
+			break;
+		}
+		size_t end = start + REACH_CHUNK_SIZE;
+		if (end > reach->frontier_count) {
+			end = reach->frontier_count;
+		}
+		for (size_t i = start; i < end; i++) {
+			game_unpack_position(game, &reach->frontier[i]);
+			if (game_won_by(game, TRENCH) || game_won_by(game, CLIMB)) {
+				/* Game over, no successors */
+				terminal++;
+				continue;
+			}
+			enumerate_valid_actions(game, reach_successor_callback, &thread);
+		}
+	}
+	reach_spill_run(&thread);
+
+	pthread_mutex_lock(&reach->lock);
+	reach->terminal_count += terminal;
+	pthread_mutex_unlock(&reach->lock);
+	game_free(game);
+	free(thread.buffer);
+}
+
+static bool keystream_advance(struct keystream_t *stream) {
+	stream->valid = stream->f && (fread(&stream->current, sizeof(struct packed_position_t), 1, stream->f) == 1);
+	return stream->valid;
+}
+
+static bool keystream_open(struct keystream_t *stream, const char *filename) {
+	stream->f = fopen(filename, "rb");
+	if (!stream->f) {
+		perror(filename);
+		return false;
+	}
+	setvbuf(stream->f, NULL, _IOFBF, 1024 * 1024);
+	keystream_advance(stream);
+	return true;
+}
+
+static void keystream_close(struct keystream_t *stream) {
+	if (stream->f) {
+		fclose(stream->f);
+		stream->f = NULL;
+	}
+}
+
+/* Merges all sorted input streams into the output file, writing every
+ * position only once and dropping every position contained in the exclude
+ * stream (if given). Returns the number of positions written or -1. */
+static long long reach_merge(struct keystream_t *inputs, unsigned int input_count, struct keystream_t *exclude, const char *output_filename) {
+	FILE *out = fopen(output_filename, "wb");
+	if (!out) {
+		perror(output_filename);
+		return -1;
+	}
+	setvbuf(out, NULL, _IOFBF, 1024 * 1024);
+
+	/* Binary min-heap of input indices, ordered by their current key */
+	unsigned int *heap = malloc(sizeof(unsigned int) * (input_count + 1));
+	unsigned int heap_size = 0;
+	for (unsigned int i = 0; i < input_count; i++) {
+		if (!inputs[i].valid) {
+			continue;
+		}
+		unsigned int pos = heap_size++;
+		while ((pos > 0) && (packed_position_cmp(&inputs[heap[(pos - 1) / 2]].current, &inputs[i].current) > 0)) {
+			heap[pos] = heap[(pos - 1) / 2];
+			pos = (pos - 1) / 2;
+		}
+		heap[pos] = i;
+	}
+
+	long long written = 0;
+	struct packed_position_t last;
+	bool have_last = false;
+	while (heap_size) {
+		struct packed_position_t key = inputs[heap[0]].current;
+
+		/* Advance the smallest input and restore the heap property */
+		unsigned int top = heap[0];
+		if (!keystream_advance(&inputs[top])) {
+			top = heap[--heap_size];
+		}
+		unsigned int pos = 0;
+		while (true) {
+			unsigned int child = (2 * pos) + 1;
+			if (child >= heap_size) {
+				break;
+			}
+			if ((child + 1 < heap_size) && (packed_position_cmp(&inputs[heap[child + 1]].current, &inputs[heap[child]].current) < 0)) {
+				child++;
+			}
+			if (packed_position_cmp(&inputs[heap[child]].current, &inputs[top].current) >= 0) {
+				break;
+			}
+			heap[pos] = heap[child];
+			pos = child;
+		}
+		if (heap_size) {
+			heap[pos] = top;
+		}
+
+		if (have_last && !packed_position_cmp(&key, &last)) {
+			continue;
+		}
+		last = key;
+		have_last = true;
+
+		if (exclude) {
+			while (exclude->valid && (packed_position_cmp(&exclude->current, &key) < 0)) {
+				keystream_advance(exclude);
+			}
+			if (exclude->valid && !packed_position_cmp(&exclude->current, &key)) {
+				continue;
+			}
+		}
+		if (fwrite(&key, sizeof(key), 1, out) != 1) {
+			perror(output_filename);
+			free(heap);
+			fclose(out);
+			return -1;
+		}
+		written++;
+	}
+	free(heap);
+	if (fclose(out)) {
+		perror(output_filename);
+		return -1;
+	}
+	return written;
+}
+
+static long reach_maxrss_kib(void) {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+static void reach_layer_filename(char *filename, size_t size, const struct reach_params_t *params, const char *name, unsigned int depth) {
+	if (params->checkpoint_filename) {
+		snprintf(filename, size, "%s.%s.%u", params->checkpoint_filename, name, depth);
+	} else {
+		snprintf(filename, size, "%s/reach_%d_%s_%u.tmp", params->tmpdir, getpid(), name, depth);
+	}
+}
+
+/* Layers have to be on disk before a checkpoint refers to them, otherwise a
+ * crash could leave a checkpoint pointing at layers that were never written. */
+static bool reach_sync_file(const char *filename) {
+	int fd = open(filename, O_RDONLY);
+	if (fd == -1) {
+		perror(filename);
+		return false;
+	}
+	bool success = !fsync(fd);
+	if (!success) {
+		perror(filename);
+	}
+	close(fd);
+	return success;
+}
+
+static bool reach_write_checkpoint(const struct reach_params_t *params, const struct reach_checkpoint_t *checkpoint) {
+	char tmp_filename[256];
+	snprintf(tmp_filename, sizeof(tmp_filename), "%s.new", params->checkpoint_filename);
+	FILE *f = fopen(tmp_filename, "wb");
+	if (!f) {
+		perror(tmp_filename);
+		return false;
+	}
+	bool success = (fwrite(checkpoint, sizeof(*checkpoint), 1, f) == 1);
+	success = !fflush(f) && !fsync(fileno(f)) && success;
+	success = !fclose(f) && success;
+	if (!success || rename(tmp_filename, params->checkpoint_filename)) {
+		perror(params->checkpoint_filename);
+		unlink(tmp_filename);
+		return false;
+	}
+
+	/* The rename itself has to be durable before the previous layer is
+	 * removed */
+	char dir_filename[256];
+	snprintf(dir_filename, sizeof(dir_filename), "%s", params->checkpoint_filename);
+	return reach_sync_file(dirname(dir_filename));
+}
+
+/* Returns true if a checkpoint for the same board exists and has been read. */
+static bool reach_read_checkpoint(const struct reach_params_t *params, struct reach_checkpoint_t *checkpoint) {
+	FILE *f = fopen(params->checkpoint_filename, "rb");
+	if (!f) {
+		return false;
+	}
+	bool success = (fread(checkpoint, sizeof(*checkpoint), 1, f) == 1);
+	fclose(f);
+	if (!success || (checkpoint->magic != REACH_CHECKPOINT_MAGIC) || (checkpoint->version != REACH_CHECKPOINT_VERSION)) {
+		fprintf(stderr, "%s: not a reach checkpoint, starting over.\n", params->checkpoint_filename);
+		return false;
+	}
+	if (checkpoint->n != params->n) {
+		fprintf(stderr, "%s: checkpoint is for Iso-Path(%u), starting over.\n", params->checkpoint_filename, checkpoint->n);
+		return false;
+	}
+	char filename[256];
+	const char *names[] = { "visited", "frontier" };
+	for (int i = 0; i < 2; i++) {
+		reach_layer_filename(filename, sizeof(filename), params, names[i], checkpoint->depth);
+		if (access(filename, R_OK)) {
+			fprintf(stderr, "%s: layer %s is missing, starting over.\n", params->checkpoint_filename, filename);
+			return false;
+		}
+	}
+	return true;
+}
+
+static void reach_report_layer(const struct reach_params_t *params, unsigned int depth, uint64_t count) {
+	if (params->layer_counts && (depth < params->layer_counts_size)) {
+		params->layer_counts[depth] = count;
+	}
+}
+
+static bool reach_write_positions(const char *filename, const struct packed_position_t *positions, size_t count) {
+	FILE *f = fopen(filename, "wb");
+	if (!f) {
+		perror(filename);
+		return false;
+	}
+	bool success = (fwrite(positions, sizeof(struct packed_position_t), count, f) == count);
+	if (fclose(f) || !success) {
+		perror(filename);
+		return false;
+	}
+	return true;
+}
+
+bool reach_enumerate(const struct reach_params_t *params) {
+	if (params->n > PACKED_POSITION_MAX_N) {
+		fprintf(stderr, "reach: packed positions only support boards up to Iso-Path(%d).\n", PACKED_POSITION_MAX_N);
+		return false;
+	}
+	const unsigned int thread_count = params->thread_count ? params->thread_count : 1;
+	char visited_filename[256], frontier_filename[256], next_filename[256], merged_filename[256];
+
+	/* Layer zero consists only of the starting position, unless a previous
+	 * run left a checkpoint to continue from */
+	struct reach_checkpoint_t checkpoint;
+	if (params->checkpoint_filename && reach_read_checkpoint(params, &checkpoint)) {
+		fprintf(stderr, "reach: resuming at depth %u with %" PRIu64 " frontier positions.\n", checkpoint.depth, checkpoint.frontier_count);
+	} else {
+		checkpoint = (struct reach_checkpoint_t) {
+			.magic = REACH_CHECKPOINT_MAGIC,
+			.version = REACH_CHECKPOINT_VERSION,
+			.n = params->n,
+			.frontier_count = 1,
+			.total_count = 1,
+		};
+		struct game_t *game = game_init(params->n);
+		struct packed_position_t start;
+		game_pack_position(game, game->side_turn, &start);
+		game_free(game);
+		reach_layer_filename(frontier_filename, sizeof(frontier_filename), params, "frontier", 0);
+		reach_layer_filename(visited_filename, sizeof(visited_filename), params, "visited", 0);
+		if (!reach_write_positions(frontier_filename, &start, 1) || !reach_write_positions(visited_filename, &start, 1)) {
+			unlink(frontier_filename);
+			unlink(visited_filename);
+			return false;
+		}
+		if (params->checkpoint_filename && (!reach_sync_file(frontier_filename) || !reach_sync_file(visited_filename) || !reach_write_checkpoint(params, &checkpoint))) {
+			unlink(frontier_filename);
+			unlink(visited_filename);
+			return false;
+		}
+	}
+
+	reach_report_layer(params, checkpoint.depth, checkpoint.frontier_count);
+
+	bool success = true;
+	const double t_start = monotime_secs();
+	printf("%5s %15s %15s %15s %12s %6s %12s\n", "depth", "positions", "terminal", "total", "expand/sec", "runs", "maxrss MiB");
+	while ((checkpoint.depth < params->max_depth) && (checkpoint.frontier_count > 0)) {
+		const unsigned int depth = checkpoint.depth;
+		reach_layer_filename(visited_filename, sizeof(visited_filename), params, "visited", depth);
+		reach_layer_filename(frontier_filename, sizeof(frontier_filename), params, "frontier", depth);
+		reach_layer_filename(next_filename, sizeof(next_filename), params, "frontier", depth + 1);
+		reach_layer_filename(merged_filename, sizeof(merged_filename), params, "visited", depth + 1);
+
+		const double t0 = monotime_secs();
+		struct mmapfile_t *frontier = mmapfile_open(frontier_filename, false);
+		if (!frontier) {
+			success = false;
+			break;
+		}
+		struct reach_ctx_t reach = {
+			.params = params,
+			.frontier = (const struct packed_position_t*)frontier->data,
+			.frontier_count = checkpoint.frontier_count,
+			.keys_per_thread = params->memory_bytes / thread_count / sizeof(struct packed_position_t),
+			.lock = PTHREAD_MUTEX_INITIALIZER,
+		};
+		if (reach.keys_per_thread < 1024) {
+			reach.keys_per_thread = 1024;
+		}
+		parallel_run(thread_count, reach_expand_thread, &reach);
+		mmapfile_close(frontier);
+
+		long long next_count = -1;
+		if (!reach.failed) {
+			struct keystream_t *runs = calloc(reach.run_count, sizeof(struct keystream_t));
+			struct keystream_t visited = { 0 };
+			bool streams_ok = keystream_open(&visited, visited_filename);
+			for (unsigned int i = 0; streams_ok && (i < reach.run_count); i++) {
+				streams_ok = keystream_open(&runs[i], reach.run_filenames[i]);
+			}
+			if (streams_ok) {
+				next_count = reach_merge(runs, reach.run_count, &visited, next_filename);
+			}
+			for (unsigned int i = 0; i < reach.run_count; i++) {
+				keystream_close(&runs[i]);
+			}
+			keystream_close(&visited);
+			free(runs);
+		}
+		for (unsigned int i = 0; i < reach.run_count; i++) {
+			unlink(reach.run_filenames[i]);
+			free(reach.run_filenames[i]);
+		}
+		free(reach.run_filenames);
+		if (next_count < 0) {
+			success = false;
+			break;
+		}
+
+		/* New positions become part of the visited set */
+		struct keystream_t inputs[2] = { 0 };
+		if (!keystream_open(&inputs[0], visited_filename) || !keystream_open(&inputs[1], next_filename) || (reach_merge(inputs, 2, NULL, merged_filename) < 0)) {
+			keystream_close(&inputs[0]);
+			keystream_close(&inputs[1]);
+			success = false;
+			break;
+		}
+		keystream_close(&inputs[0]);
+		keystream_close(&inputs[1]);
+
+		const double t = monotime_secs() - t0;
+		printf("%5u %15" PRIu64 " %15llu %15" PRIu64 " %12.0f %6u %12.1f\n", depth, checkpoint.frontier_count, reach.terminal_count, checkpoint.total_count, (t > 0) ? checkpoint.frontier_count / t : 0, reach.run_count, reach_maxrss_kib() / 1024.);
+		fflush(stdout);
+
+		/* The new layer is complete on disk before the checkpoint refers to
+		 * it; only then the previous layer is removed */
+		struct reach_checkpoint_t next_checkpoint = checkpoint;
+		next_checkpoint.depth = depth + 1;
+		next_checkpoint.total_count += next_count;
+		next_checkpoint.frontier_count = next_count;
+		if (params->checkpoint_filename && (!reach_sync_file(next_filename) || !reach_sync_file(merged_filename) || !reach_write_checkpoint(params, &next_checkpoint))) {
+			success = false;
+			break;
+		}
+		checkpoint = next_checkpoint;
+		reach_report_layer(params, checkpoint.depth, checkpoint.frontier_count);
+		unlink(visited_filename);
+		unlink(frontier_filename);
+	}
+	if (success && checkpoint.frontier_count) {
+		printf("%5u %15" PRIu64 " %15s %15" PRIu64 " %12s %6s %12.1f\n", checkpoint.depth, checkpoint.frontier_count, "-", checkpoint.total_count, "-", "-", reach_maxrss_kib() / 1024.);
+	}
+	fprintf(stderr, "reach: %" PRIu64 " distinct positions in %.1f secs\n", checkpoint.total_count, monotime_secs() - t_start);
+
+	/* The layer the checkpoint refers to is kept together with it so that a
+	 * failed run can resume and one that stopped at the depth limit can go
+	 * deeper. A partially written next layer is always removed. */
+	const bool keep = params->checkpoint_filename && (!success || checkpoint.frontier_count);
+	for (unsigned int depth = keep ? checkpoint.depth + 1 : checkpoint.depth; depth <= checkpoint.depth + 1; depth++) {
+		reach_layer_filename(visited_filename, sizeof(visited_filename), params, "visited", depth);
+		reach_layer_filename(frontier_filename, sizeof(frontier_filename), params, "frontier", depth);
+		unlink(visited_filename);
+		unlink(frontier_filename);
+	}
+	if (!keep && params->checkpoint_filename) {
+		unlink(params->checkpoint_filename);
+	}
+	return success;
+}
@@ -0,0 +1,48 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __REACH_H__
+#define __REACH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct reach_params_t {
+	uint8_t n;
+	unsigned int max_depth;
+	size_t memory_bytes;
+	unsigned int thread_count;
+	const char *tmpdir;
+	const char *checkpoint_filename;
+
+	/* If given, receives the number of positions first reached at each depth
+	 * below layer_counts_size */
+	uint64_t *layer_counts;
+	unsigned int layer_counts_size;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+bool reach_enumerate(const struct reach_params_t *params);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,210 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "search.h"
+#include "stats.h"
+#include "monotime.h"
+
+/* Fixed-depth negamax with alpha-beta pruning. The search works entirely on
+ * the game that is passed in: actions are applied by the enumeration and
+ * reverted once the callback returns, so recursion happens from within the
+ * enumeration callbacks and no board is ever copied. A depth of one is the
+ * greedy one-ply search. With a transposition table, results of interior
+ * nodes are stored and reused; win scores are kept relative to the node
+ * since they depend on the distance from the root. The clock and the stop
+ * flag are only looked at every SEARCH_CHECK_INTERVAL nodes. */
+
+/* Win scores are SEARCH_SCORE_WIN minus the ply they occur at */
+#define SEARCH_MAX_PLY			1000
+
+#define SEARCH_CHECK_INTERVAL	1024
+
+struct search_ctx_t {
+	const struct search_params_t *params;
+	double deadline;
+	uint64_t nodes;
+	unsigned int ply;
+	bool aborted;
+};
+
+struct search_node_t {
+	struct search_ctx_t *search;
+	unsigned int depth;
+	float alpha, beta;
+	float best_score;
+	bool have_action;
+	struct action_t best_action;
+};
+
+static float search_node(struct search_ctx_t *search, struct game_t *game, unsigned int depth, float alpha, float beta, struct search_node_t *node);
+
+static bool search_out_of_time(const struct search_ctx_t *search) {
+	if (search->params->stop && atomic_load_explicit(search->params->stop, memory_order_relaxed)) {
+		return true;
+	}
+	return search->params->time_budget && (monotime_secs() >= search->deadline);
+}
+
+/* Scores the position right after the side to move has applied an action,
+ * from the view of that side. */
+static float search_after_action(struct search_ctx_t *search, struct game_t *game, unsigned int depth, float alpha, float beta) {
+	search->nodes++;
+	STATS_INC(STATS_SEARCH_NODES);
+	if (search->params->node_budget && (search->nodes >= search->params->node_budget)) {
+		search->aborted = true;
+	} else if (((search->nodes % SEARCH_CHECK_INTERVAL) == 0) && search_out_of_time(search)) {
+		search->aborted = true;
+	}
+	if (game_won_by(game, game->side_turn)) {
+		/* Prefer quicker wins */
+		return SEARCH_SCORE_WIN - search->ply;
+	}
+	if ((depth == 0) || search->aborted) {
+		return strategy_evaluate_after_action(game, search->params->strategy);
+	}
+
+	search->ply++;
+	game_pass_turn(game);
+	struct search_node_t node;
+	float score = -search_node(search, game, depth, -beta, -alpha, &node);
+	game_pass_turn(game);
+	search->ply--;
+	if (!node.have_action) {
+		/* Opponent cannot act at all */
+		return strategy_evaluate(game, search->params->strategy);
+	}
+	return score;
+}
+
+static bool search_node_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct search_node_t *node = (struct search_node_t*)vctx;
+	struct search_ctx_t *search = node->search;
+	STATS_PHASE_ENTER(STATS_PHASE_SEARCH);
+	float score = search_after_action(search, game, node->depth - 1, node->alpha, node->beta);
+	bool continue_search = false;
+
+	/* Score of an aborted subtree is not reliable, keep what we have */
+	if (!search->aborted || !node->have_action) {
+		if (!node->have_action || (score > node->best_score)) {
+			node->have_action = true;
+			node->best_score = score;
+			node->best_action = *action;
+		}
+		if (score > node->alpha) {
+			node->alpha = score;
+		}
+		continue_search = (node->alpha < node->beta) && !search->aborted;
+	}
+	STATS_PHASE_LEAVE();
+	return continue_search;
+}
+
+static float search_score_to_table(float score, unsigned int ply) {
+	if (score >= SEARCH_SCORE_WIN - SEARCH_MAX_PLY) {
+		return score + ply;
+	} else if (score <= -SEARCH_SCORE_WIN + SEARCH_MAX_PLY) {
+		return score - ply;
+	}
+	return score;
+}
+
+static float search_score_from_table(float score, unsigned int ply) {
+	if (score >= SEARCH_SCORE_WIN - SEARCH_MAX_PLY) {
+		return score - ply;
+	} else if (score <= -SEARCH_SCORE_WIN + SEARCH_MAX_PLY) {
+		return score + ply;
+	}
+	return score;
+}
+
+static float search_node(struct search_ctx_t *search, struct game_t *game, unsigned int depth, float alpha, float beta, struct search_node_t *node) {
+	*node = (struct search_node_t) {
+		.search = search,
+		.depth = depth,
+		.alpha = alpha,
+		.beta = beta,
+		.best_score = -SEARCH_SCORE_INFINITY,
+	};
+
+	/* The root always needs its best action, so it is never cut off */
+	struct ttable_t *ttable = search->params->ttable;
+	if (ttable && search->ply) {
+		struct ttable_hit_t hit;
+		if (ttable_probe(ttable, game->hash, &hit) && (hit.depth >= depth)) {
+			float score = search_score_from_table(hit.score, search->ply);
+			if ((hit.bound == TTABLE_EXACT) || ((hit.bound == TTABLE_LOWER) && (score >= beta)) || ((hit.bound == TTABLE_UPPER) && (score <= alpha))) {
+				node->have_action = true;
+				node->best_score = score;
+				return score;
+			}
+		}
+	}
+
+	strategy_enumerate_actions(game, search->params->strategy, search_node_callback, node);
+	if (ttable && node->have_action && !search->aborted) {
+		enum ttable_bound_t bound = (node->best_score <= alpha) ? TTABLE_UPPER : (node->best_score >= beta) ? TTABLE_LOWER : TTABLE_EXACT;
+		ttable_store(ttable, game->hash, depth, bound, search_score_to_table(node->best_score, search->ply));
+	}
+	return node->best_score;
+}
+
+bool search_best_action(struct game_t *game, const struct search_params_t *params, struct search_result_t *result) {
+	struct search_ctx_t search = {
+		.params = params,
+		.deadline = monotime_secs() + params->time_budget,
+	};
+	*result = (struct search_result_t) { 0 };
+	STATS_PHASE_ENTER(STATS_PHASE_SEARCH);
+	unsigned int max_depth = params->depth ? params->depth : 1;
+	unsigned int depth = max_depth;
+	if (params->iterative) {
+		max_depth = params->depth ? params->depth : SEARCH_MAX_PLY;
+		depth = 1;
+	}
+
+	for (; depth <= max_depth; depth++) {
+		struct search_node_t root;
+		search_node(&search, game, depth, -SEARCH_SCORE_INFINITY, SEARCH_SCORE_INFINITY, &root);
+
+		/* An interrupted iteration only counts if there is nothing better */
+		if (!search.aborted || !result->have_action) {
+			result->have_action = root.have_action;
+			result->best_action = root.best_action;
+			result->score = root.best_score;
+			result->depth = depth;
+		}
+		if (search.aborted || !root.have_action || search_out_of_time(&search)) {
+			break;
+		}
+		if (root.best_score >= SEARCH_SCORE_WIN - SEARCH_MAX_PLY) {
+			/* A forced win does not get better by looking deeper */
+			break;
+		}
+	}
+	result->aborted = search.aborted;
+	result->nodes = search.nodes;
+	STATS_PHASE_LEAVE();
+	return result->have_action;
+}
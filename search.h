@@ -0,0 +1,63 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __SEARCH_H__
+#define __SEARCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "game.h"
+#include "strategy.h"
+#include "ttable.h"
+
+#define SEARCH_SCORE_WIN		1e6f
+#define SEARCH_SCORE_INFINITY	1e9f
+
+/* An iterative search deepens up to depth plies (zero meaning no limit) and
+ * returns the result of the deepest iteration that completed within the
+ * node and time (in seconds) budgets, which span all iterations. Setting
+ * *stop from another thread cancels the search cooperatively. */
+struct search_params_t {
+	const struct strategy_t *strategy;
+	unsigned int depth;
+	bool iterative;
+	uint64_t node_budget;
+	double time_budget;
+	atomic_bool *stop;
+	struct ttable_t *ttable;
+};
+
+struct search_result_t {
+	bool have_action;
+	bool aborted;
+	struct action_t best_action;
+	float score;
+	uint64_t nodes;
+	unsigned int depth;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+bool search_best_action(struct game_t *game, const struct search_params_t *params, struct search_result_t *result);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,116 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "selfplay.h"
+#include "parallel.h"
+#include "history.h"
+#include "trace.h"
+#include "rng.h"
+#include "latency.h"
+
+struct selfplay_ctx_t {
+	const struct selfplay_params_t *params;
+	atomic_uint next_game;
+	atomic_uint wins, losses, draws;
+	atomic_ullong plies;
+	atomic_ullong prune_nodes, prune_builds_kept, prune_builds_total;
+	pthread_mutex_t latency_lock;
+};
+
+static void selfplay_thread(unsigned int thread_id, void *vctx) {
+	struct selfplay_ctx_t *ctx = (struct selfplay_ctx_t*)vctx;
+	const struct selfplay_params_t *params = ctx->params;
+	struct game_t *game = game_init(params->n);
+	struct history_t *history = history_init(params->playout_params.max_plies + 1);
+	struct latency_t *latency = params->latency ? latency_init() : NULL;
+	if (!game || !history || (params->latency && !latency)) {
+		fprintf(stderr, "fatal: cannot allocate self-play game in thread %u.\n", thread_id);
+		abort();
+	}
+
+	while (true) {
+		unsigned int game_index = atomic_fetch_add(&ctx->next_game, 1);
+		if (game_index >= params->game_count) {
+			break;
+		}
+
+		/* Every game gets its own, reproducible random opening */
+		struct playout_params_t playout_params = params->playout_params;
+		uint64_t seed_state = params->playout_params.seed + game_index;
+		playout_params.seed = rng_splitmix64(&seed_state);
+		playout_params.latency = latency;
+
+		game_reset(game);
+		const enum side_t first_side = game->side_turn;
+		enum game_result_t result = strategy_play_out(game, params->strategies[0], params->strategies[1], &playout_params, history);
+		switch (result) {
+			case RESULT_WIN: atomic_fetch_add(&ctx->wins, 1); break;
+			case RESULT_LOSS: atomic_fetch_add(&ctx->losses, 1); break;
+			case RESULT_DRAW: atomic_fetch_add(&ctx->draws, 1); break;
+		}
+		atomic_fetch_add(&ctx->plies, history->length - 1);
+
+		if (params->record_writer) {
+			if (!gamerecord_append(params->record_writer, params->n, first_side, params->strategies[0], params->strategies[1], history, result)) {
+				fprintf(stderr, "fatal: failed to write game record.\n");
+				abort();
+			}
+		}
+	}
+
+	atomic_fetch_add(&ctx->prune_nodes, game->prune_stats.nodes);
+	atomic_fetch_add(&ctx->prune_builds_kept, game->prune_stats.builds_kept);
+	atomic_fetch_add(&ctx->prune_builds_total, game->prune_stats.builds_total);
+	if (latency) {
+		pthread_mutex_lock(&ctx->latency_lock);
+		latency_merge(params->latency, latency);
+		pthread_mutex_unlock(&ctx->latency_lock);
+		latency_free(latency);
+	}
+	trace_thread_flush();
+	history_free(history);
+	game_free(game);
+}
+
+void selfplay_run(const struct selfplay_params_t *params, struct selfplay_results_t *results) {
+	struct selfplay_ctx_t ctx = {
+		.params = params,
+		.latency_lock = PTHREAD_MUTEX_INITIALIZER,
+	};
+	parallel_run(params->thread_count, selfplay_thread, &ctx);
+	*results = (struct selfplay_results_t) {
+		.wins = ctx.wins,
+		.losses = ctx.losses,
+		.draws = ctx.draws,
+		.plies = ctx.plies,
+		.prune_stats = {
+			.nodes = ctx.prune_nodes,
+			.builds_kept = ctx.prune_builds_kept,
+			.builds_total = ctx.prune_builds_total,
+		},
+	};
+}
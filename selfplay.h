@@ -0,0 +1,54 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __SELFPLAY_H__
+#define __SELFPLAY_H__
+
+#include <stdint.h>
+#include "strategy.h"
+#include "gamerecord.h"
+
+struct selfplay_params_t {
+	uint8_t n;
+	unsigned int game_count;
+	unsigned int thread_count;
+	struct playout_params_t playout_params;
+	const struct strategy_t *strategies[2];
+	struct gamerecord_writer_t *record_writer;
+	/* When set, per-decision latencies of all threads are merged into it */
+	struct latency_t *latency;
+};
+
+/* Counted from the view of the side that moves first */
+struct selfplay_results_t {
+	unsigned int wins;
+	unsigned int losses;
+	unsigned int draws;
+	unsigned long long plies;
+	struct prune_stats_t prune_stats;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+void selfplay_run(const struct selfplay_params_t *params, struct selfplay_results_t *results);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
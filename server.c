@@ -0,0 +1,467 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "server.h"
+#include "game.h"
+#include "search.h"
+#include "parallel.h"
+#include "monotime.h"
+
+/* One I/O thread accepts clients and reads their requests, worker threads
+ * analyze them. Every worker keeps its own game (and with it the topology
+ * and distance tables) for the whole lifetime of the server, and all of them
+ * share the lock-free transposition table. Requests that arrive together
+ * are queued in one go and workers take up to SERVER_BATCH_SIZE of them per
+ * visit to the queue. */
+
+#define SERVER_BATCH_SIZE			8
+#define SERVER_READ_REQUESTS		64
+#define SERVER_POLL_INTERVAL_MS		100
+#define SERVER_LISTEN_BACKLOG		64
+#define SERVER_SEND_TIMEOUT_MS		1000
+
+_Static_assert(sizeof(struct server_request_t) == 152, "request record has padding");
+_Static_assert(sizeof(struct server_response_t) == 32, "response record has padding");
+_Static_assert(SERVER_TILE_BYTES >= NUMBER_TILES(PACKED_ACTION_MAX_N), "request cannot hold the largest board");
+
+/* A client is freed once it has disconnected and the last of its pending
+ * requests was answered; both fields are guarded by the server lock. A
+ * client that does not take its responses within SERVER_SEND_TIMEOUT_MS is
+ * dropped; that flag is guarded by the write lock. */
+struct server_client_t {
+	int fd;
+	pthread_mutex_t write_lock;
+	bool dropped;
+	unsigned int pending;
+	bool closed;
+	unsigned int fill;
+	uint8_t buffer[SERVER_READ_REQUESTS * sizeof(struct server_request_t)];
+};
+
+struct server_job_t {
+	struct server_job_t *next;
+	struct server_client_t *client;
+	struct server_request_t request;
+	double queued_at;
+};
+
+struct server_ctx_t {
+	const struct server_params_t *params;
+	int listen_fd;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct server_job_t *head, *tail;
+	bool shutdown;
+	uint64_t answered;
+	uint64_t batches;
+	uint64_t clients;
+};
+
+static bool server_write_full(int fd, const void *vbuf, size_t length) {
+	const uint8_t *buf = (const uint8_t*)vbuf;
+	while (length) {
+		ssize_t bytes = send(fd, buf, length, MSG_NOSIGNAL);
+		if ((bytes == -1) && (errno == EINTR)) {
+			continue;
+		}
+		if (bytes <= 0) {
+			return false;
+		}
+		buf += bytes;
+		length -= bytes;
+	}
+	return true;
+}
+
+/* A worker must never hang on a client that does not read, so sends time
+ * out. Since a partial response cannot be taken back, the client is then
+ * disconnected; the I/O thread notices that like any other disconnect. */
+static void server_client_respond(struct server_client_t *client, const struct server_response_t *response) {
+	pthread_mutex_lock(&client->write_lock);
+	if (!client->dropped && !server_write_full(client->fd, response, sizeof(*response))) {
+		client->dropped = true;
+		shutdown(client->fd, SHUT_RDWR);
+	}
+	pthread_mutex_unlock(&client->write_lock);
+}
+
+static bool server_client_dropped(struct server_client_t *client) {
+	pthread_mutex_lock(&client->write_lock);
+	bool dropped = client->dropped;
+	pthread_mutex_unlock(&client->write_lock);
+	return dropped;
+}
+
+static struct server_client_t *server_client_new(int fd) {
+	struct server_client_t *client = calloc(1, sizeof(struct server_client_t));
+	if (!client) {
+		fprintf(stderr, "fatal: cannot allocate server client.\n");
+		abort();
+	}
+	client->fd = fd;
+	pthread_mutex_init(&client->write_lock, NULL);
+	return client;
+}
+
+static void server_client_free(struct server_client_t *client) {
+	close(client->fd);
+	pthread_mutex_destroy(&client->write_lock);
+	free(client);
+}
+
+/* Called with the server lock held */
+static void server_client_release(struct server_client_t *client) {
+	client->pending--;
+	if (client->closed && !client->pending) {
+		server_client_free(client);
+	}
+}
+
+static bool server_request_valid(const struct server_ctx_t *server, const struct server_request_t *request) {
+	if ((request->command != SERVER_EVALUATE) && (request->command != SERVER_SEARCH)) {
+		return false;
+	}
+	if ((request->side != TRENCH) && (request->side != CLIMB)) {
+		return false;
+	}
+	for (int i = 0; i < NUMBER_TILES(server->params->n); i++) {
+		if (request->tiles[i] >= TILE_STATE_COUNT) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void server_analyze(struct server_ctx_t *server, struct game_t *game, const struct server_request_t *request, struct server_response_t *response) {
+	*response = (struct server_response_t) {
+		.request_id = request->request_id,
+		.status = SERVER_OK,
+	};
+	if (!server_request_valid(server, request)) {
+		response->status = SERVER_INVALID_REQUEST;
+		return;
+	}
+	game_set_position(game, request->tiles, request->side);
+
+	if (request->command == SERVER_EVALUATE) {
+		response->score = strategy_evaluate(game, server->params->strategy);
+		return;
+	}
+
+	struct search_params_t params = {
+		.strategy = server->params->strategy,
+		.depth = request->depth,
+		.iterative = true,
+		.node_budget = request->node_budget,
+		.time_budget = request->time_ms / 1000.,
+		.stop = server->params->stop,
+		.ttable = server->params->ttable,
+	};
+	if (!request->depth && !request->node_budget && !request->time_ms) {
+		params.depth = server->params->search_depth;
+		params.node_budget = server->params->node_budget;
+	}
+	struct search_result_t result;
+	if (!search_best_action(game, &params, &result)) {
+		response->status = SERVER_NO_ACTION;
+	} else {
+		response->best_action = game_pack_action(&result.best_action);
+		response->score = result.score;
+	}
+	response->depth = result.depth;
+	response->nodes = result.nodes;
+}
+
+static void server_worker(struct server_ctx_t *server) {
+	struct game_t *game = game_init(server->params->n);
+	if (!game) {
+		fprintf(stderr, "fatal: cannot create server game.\n");
+		abort();
+	}
+
+	pthread_mutex_lock(&server->lock);
+	while (true) {
+		while (!server->head && !server->shutdown) {
+			pthread_cond_wait(&server->cond, &server->lock);
+		}
+		if (server->shutdown) {
+			break;
+		}
+		struct server_job_t *batch = server->head;
+		struct server_job_t *last = batch;
+		for (int i = 1; (i < SERVER_BATCH_SIZE) && last->next; i++) {
+			last = last->next;
+		}
+		server->head = last->next;
+		if (!server->head) {
+			server->tail = NULL;
+		}
+		last->next = NULL;
+		server->batches++;
+		pthread_mutex_unlock(&server->lock);
+
+		while (batch) {
+			struct server_job_t *job = batch;
+			batch = job->next;
+
+			/* A client that went away just misses its answer */
+			const bool answer = !server_client_dropped(job->client);
+			if (answer) {
+				struct server_response_t response;
+				double t0 = monotime_secs();
+				server_analyze(server, game, &job->request, &response);
+				double t1 = monotime_secs();
+				response.time_us = (t1 - t0) * 1e6;
+				response.queue_us = (t0 - job->queued_at) * 1e6;
+				server_client_respond(job->client, &response);
+			}
+
+			pthread_mutex_lock(&server->lock);
+			server->answered += answer;
+			server_client_release(job->client);
+			pthread_mutex_unlock(&server->lock);
+			free(job);
+		}
+		pthread_mutex_lock(&server->lock);
+	}
+	pthread_mutex_unlock(&server->lock);
+	game_free(game);
+}
+
+/* Reads whatever the client sent and queues all complete requests at once.
+ * Returns false when the client has disconnected. */
+static bool server_receive(struct server_ctx_t *server, struct server_client_t *client) {
+	ssize_t bytes = read(client->fd, client->buffer + client->fill, sizeof(client->buffer) - client->fill);
+	if ((bytes == -1) && (errno == EINTR)) {
+		return true;
+	}
+	if (bytes <= 0) {
+		return false;
+	}
+	client->fill += bytes;
+
+	const unsigned int request_count = client->fill / sizeof(struct server_request_t);
+	if (!request_count) {
+		return true;
+	}
+	struct server_job_t *head = NULL, *tail = NULL;
+	const double now = monotime_secs();
+	for (unsigned int i = 0; i < request_count; i++) {
+		struct server_job_t *job = malloc(sizeof(struct server_job_t));
+		if (!job) {
+			fprintf(stderr, "fatal: cannot allocate server job.\n");
+			abort();
+		}
+		job->next = NULL;
+		job->client = client;
+		job->queued_at = now;
+		memcpy(&job->request, client->buffer + (i * sizeof(struct server_request_t)), sizeof(struct server_request_t));
+		if (tail) {
+			tail->next = job;
+		} else {
+			head = job;
+		}
+		tail = job;
+	}
+	client->fill -= request_count * sizeof(struct server_request_t);
+	memmove(client->buffer, client->buffer + (request_count * sizeof(struct server_request_t)), client->fill);
+
+	pthread_mutex_lock(&server->lock);
+	client->pending += request_count;
+	if (server->tail) {
+		server->tail->next = head;
+	} else {
+		server->head = head;
+	}
+	server->tail = tail;
+	pthread_cond_broadcast(&server->cond);
+	pthread_mutex_unlock(&server->lock);
+	return true;
+}
+
+static void server_io(struct server_ctx_t *server) {
+	struct server_client_t **clients = NULL;
+	struct pollfd *pollfds = calloc(1, sizeof(struct pollfd));
+	unsigned int client_count = 0;
+	if (!pollfds) {
+		fprintf(stderr, "fatal: cannot allocate poll set.\n");
+		abort();
+	}
+
+	while (!atomic_load(server->params->stop)) {
+		pollfds[0] = (struct pollfd) { .fd = server->listen_fd, .events = POLLIN };
+		for (unsigned int i = 0; i < client_count; i++) {
+			pollfds[i + 1] = (struct pollfd) { .fd = clients[i]->fd, .events = POLLIN };
+		}
+		int ready = poll(pollfds, client_count + 1, SERVER_POLL_INTERVAL_MS);
+		if (ready == -1) {
+			if (errno != EINTR) {
+				perror("poll");
+				break;
+			}
+			continue;
+		}
+
+		/* Serve existing clients first, accepting changes the arrays */
+		for (unsigned int i = client_count; i > 0; i--) {
+			if (!pollfds[i].revents) {
+				continue;
+			}
+			struct server_client_t *client = clients[i - 1];
+			if (!server_receive(server, client)) {
+				shutdown(client->fd, SHUT_RD);
+				clients[i - 1] = clients[--client_count];
+				pthread_mutex_lock(&server->lock);
+				client->closed = true;
+				if (!client->pending) {
+					server_client_free(client);
+				}
+				pthread_mutex_unlock(&server->lock);
+			}
+		}
+
+		if (pollfds[0].revents & POLLIN) {
+			int fd = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+			if (fd == -1) {
+				if (errno != EINTR) {
+					perror("accept");
+				}
+				continue;
+			}
+			const struct timeval send_timeout = {
+				.tv_sec = SERVER_SEND_TIMEOUT_MS / 1000,
+				.tv_usec = (SERVER_SEND_TIMEOUT_MS % 1000) * 1000,
+			};
+			if (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout)) == -1) {
+				perror("setsockopt");
+				close(fd);
+				continue;
+			}
+			clients = realloc(clients, sizeof(struct server_client_t*) * (client_count + 1));
+			pollfds = realloc(pollfds, sizeof(struct pollfd) * (client_count + 2));
+			if (!clients || !pollfds) {
+				fprintf(stderr, "fatal: cannot allocate server clients.\n");
+				abort();
+			}
+			clients[client_count++] = server_client_new(fd);
+			server->clients++;
+		}
+	}
+
+	/* Clients still connected go away with their last pending request */
+	pthread_mutex_lock(&server->lock);
+	server->shutdown = true;
+	for (unsigned int i = 0; i < client_count; i++) {
+		clients[i]->closed = true;
+		if (!clients[i]->pending) {
+			server_client_free(clients[i]);
+		}
+	}
+	pthread_cond_broadcast(&server->cond);
+	pthread_mutex_unlock(&server->lock);
+	free(clients);
+	free(pollfds);
+}
+
+static void server_thread(unsigned int thread_id, void *vctx) {
+	struct server_ctx_t *server = (struct server_ctx_t*)vctx;
+	if (thread_id == 0) {
+		server_io(server);
+	} else {
+		server_worker(server);
+	}
+}
+
+static int server_listen(const char *socket_path) {
+	struct sockaddr_un addr = {
+		.sun_family = AF_UNIX,
+	};
+	if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path too long: %s\n", socket_path);
+		return -1;
+	}
+	strcpy(addr.sun_path, socket_path);
+
+	/* A socket left behind by an earlier server is replaced, anything else
+	 * is not touched */
+	struct stat statbuf;
+	if ((stat(socket_path, &statbuf) == 0) && S_ISSOCK(statbuf.st_mode)) {
+		unlink(socket_path);
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd == -1) {
+		perror("socket");
+		return -1;
+	}
+	if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+		perror(socket_path);
+		close(fd);
+		return -1;
+	}
+	if (listen(fd, SERVER_LISTEN_BACKLOG) == -1) {
+		perror("listen");
+		close(fd);
+		unlink(socket_path);
+		return -1;
+	}
+	return fd;
+}
+
+bool server_run(const struct server_params_t *params) {
+	struct server_ctx_t server = {
+		.params = params,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.cond = PTHREAD_COND_INITIALIZER,
+	};
+	server.listen_fd = server_listen(params->socket_path);
+	if (server.listen_fd == -1) {
+		return false;
+	}
+	fprintf(stderr, "Server listening on %s with %u workers\n", params->socket_path, params->thread_count);
+
+	parallel_run(params->thread_count + 1, server_thread, &server);
+
+	/* Requests still queued are dropped, which frees the remaining clients */
+	while (server.head) {
+		struct server_job_t *job = server.head;
+		server.head = job->next;
+		server_client_release(job->client);
+		free(job);
+	}
+	close(server.listen_fd);
+	unlink(params->socket_path);
+	fprintf(stderr, "Server answered %" PRIu64 " requests in %" PRIu64 " batches from %" PRIu64 " clients\n", server.answered, server.batches, server.clients);
+	return true;
+}
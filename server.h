@@ -0,0 +1,96 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "strategy.h"
+#include "ttable.h"
+
+/* Requests and responses are fixed-size records in native byte order that
+ * clients write to and read from a Unix stream socket. Clients may send any
+ * number of requests without waiting; responses are sent as soon as each
+ * analysis finishes and therefore not necessarily in request order, they
+ * carry the request_id of the request they answer. */
+#define SERVER_TILE_BYTES		132
+
+enum server_command_t {
+	SERVER_EVALUATE = 0,
+	SERVER_SEARCH = 1,
+};
+
+enum server_status_t {
+	SERVER_OK = 0,
+	SERVER_INVALID_REQUEST = 1,
+	SERVER_NO_ACTION = 2,
+};
+
+/* The position is the first NUMBER_TILES(n) bytes of tiles, one tile state
+ * per byte. A search without any limits uses the server's defaults. */
+struct server_request_t {
+	uint32_t request_id;
+	uint8_t command;
+	uint8_t side;
+	uint16_t depth;
+	uint64_t node_budget;
+	uint32_t time_ms;
+	uint8_t tiles[SERVER_TILE_BYTES];
+};
+
+/* Scores are from the view of the side to move; best_action is a packed
+ * action and only set by searches. queue_us is the time the request waited
+ * for a worker. */
+struct server_response_t {
+	uint32_t request_id;
+	uint8_t status;
+	uint8_t reserved;
+	uint16_t depth;
+	uint32_t best_action;
+	float score;
+	uint64_t nodes;
+	uint32_t time_us;
+	uint32_t queue_us;
+};
+
+struct server_params_t {
+	const char *socket_path;
+	uint8_t n;
+	unsigned int thread_count;
+	const struct strategy_t *strategy;
+	struct ttable_t *ttable;
+
+	/* Limits of a search request that does not give any */
+	unsigned int search_depth;
+	uint64_t node_budget;
+
+	/* The server runs until this gets set */
+	atomic_bool *stop;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+bool server_run(const struct server_params_t *params);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
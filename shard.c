@@ -0,0 +1,580 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <inttypes.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "shard.h"
+#include "notation.h"
+
+/* Sharded solving: the coordinator expands the game tree up to the split
+ * depth in memory, every leaf at that depth becomes a work unit which one of
+ * the worker processes solves with its own node table. Workers are forked
+ * from the coordinator and talk to it over a socketpair each, so nothing but
+ * a unit index goes in and a fixed-size result comes back. Unit results are
+ * combined by the usual AND/OR rules inside the split tree; units whose value
+ * no longer matters because an ancestor is already decided are skipped.
+ * Should a worker die, its unit is handed out again (up to a fixed number of
+ * attempts) and a fresh worker takes its place. Repetitions are only detected
+ * within a unit, not across the split tree above it. */
+
+#define SHARD_NIL				UINT32_MAX
+#define SHARD_MAX_ATTEMPTS		3
+
+struct shard_node_t {
+	uint32_t parent;
+	uint32_t packed_action;
+	uint32_t pending;
+	uint32_t unknown;
+	bool or_node;
+	bool terminal;
+	bool resolved;
+	enum solve_outcome_t outcome;
+};
+
+struct shard_unit_t {
+	uint32_t node;
+	struct packed_position_t position;
+	unsigned int attempts;
+};
+
+struct shard_request_t {
+	uint32_t unit;
+};
+
+struct shard_response_t {
+	uint32_t unit;
+	uint32_t outcome;
+	uint64_t expansions;
+	uint32_t peak_nodes;
+	uint32_t reserved;
+};
+
+struct shard_worker_t {
+	pid_t pid;
+	int fd;
+	uint32_t unit;
+};
+
+struct shard_ctx_t {
+	const struct shard_params_t *params;
+	struct game_t *game;
+	enum side_t attacker;
+
+	uint32_t node_count, node_capacity;
+	struct shard_node_t *nodes;
+	uint32_t unit_count, unit_capacity;
+	struct shard_unit_t *units;
+
+	/* Ring buffer of unit indices waiting to be dispatched */
+	uint32_t *queue;
+	uint32_t queue_head, queue_length;
+
+	struct shard_worker_t *workers;
+	struct shard_result_t *result;
+};
+
+struct shard_build_ctx_t {
+	struct shard_ctx_t *shard;
+	uint32_t parent;
+	unsigned int depth;
+};
+
+static uint32_t shard_add_node(struct shard_ctx_t *shard, uint32_t parent, uint32_t packed_action, bool or_node) {
+	if (shard->node_count == shard->node_capacity) {
+		shard->node_capacity = shard->node_capacity ? (2 * shard->node_capacity) : 256;
+		shard->nodes = realloc(shard->nodes, sizeof(struct shard_node_t) * shard->node_capacity);
+		if (!shard->nodes) {
+			fprintf(stderr, "Failed to grow split tree to %u nodes.\n", shard->node_capacity);
+			abort();
+		}
+	}
+	shard->nodes[shard->node_count] = (struct shard_node_t) {
+		.parent = parent,
+		.packed_action = packed_action,
+		.or_node = or_node,
+		.outcome = SOLVE_UNKNOWN,
+	};
+	if (parent != SHARD_NIL) {
+		shard->nodes[parent].pending++;
+	}
+	return shard->node_count++;
+}
+
+static void shard_add_unit(struct shard_ctx_t *shard, uint32_t node, const struct game_t *game, enum side_t side_turn) {
+	if (shard->unit_count == shard->unit_capacity) {
+		shard->unit_capacity = shard->unit_capacity ? (2 * shard->unit_capacity) : 256;
+		shard->units = realloc(shard->units, sizeof(struct shard_unit_t) * shard->unit_capacity);
+		if (!shard->units) {
+			fprintf(stderr, "Failed to grow work unit list to %u units.\n", shard->unit_capacity);
+			abort();
+		}
+	}
+	struct shard_unit_t *unit = &shard->units[shard->unit_count++];
+	*unit = (struct shard_unit_t) {
+		.node = node,
+	};
+	game_pack_position(game, side_turn, &unit->position);
+}
+
+static void shard_build(struct shard_ctx_t *shard, struct game_t *game, uint32_t index, unsigned int depth);
+
+static bool shard_build_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct shard_build_ctx_t *build = (struct shard_build_ctx_t*)vctx;
+	struct shard_ctx_t *shard = build->shard;
+	const enum side_t mover = game->side_turn;
+	uint32_t child = shard_add_node(shard, build->parent, game_pack_action(action), mover != shard->attacker);
+	if (game_won_by(game, mover)) {
+		shard->nodes[child].terminal = true;
+		shard->nodes[child].outcome = (mover == shard->attacker) ? SOLVE_PROVEN : SOLVE_DISPROVEN;
+	} else if (build->depth + 1 == shard->params->split_depth) {
+		shard_add_unit(shard, child, game, !mover);
+	} else {
+		game_pass_turn(game);
+		shard_build(shard, game, child, build->depth + 1);
+		game_pass_turn(game);
+	}
+	return true;
+}
+
+static void shard_build(struct shard_ctx_t *shard, struct game_t *game, uint32_t index, unsigned int depth) {
+	struct shard_build_ctx_t build = {
+		.shard = shard,
+		.parent = index,
+		.depth = depth,
+	};
+	enumerate_valid_actions(game, shard_build_callback, &build);
+	if (shard->nodes[index].pending == 0) {
+		/* No legal action, the game is stuck */
+		shard->nodes[index].terminal = true;
+		shard->nodes[index].outcome = SOLVE_DISPROVEN;
+	}
+}
+
+/* Passes the outcome of a just resolved node up the split tree. */
+static void shard_notify_parent(struct shard_ctx_t *shard, uint32_t index) {
+	const struct shard_node_t *node = &shard->nodes[index];
+	if (node->parent == SHARD_NIL) {
+		return;
+	}
+	struct shard_node_t *parent = &shard->nodes[node->parent];
+	if (parent->resolved) {
+		return;
+	}
+	if ((parent->or_node && (node->outcome == SOLVE_PROVEN)) || (!parent->or_node && (node->outcome == SOLVE_DISPROVEN))) {
+		parent->resolved = true;
+		parent->outcome = node->outcome;
+		shard_notify_parent(shard, node->parent);
+		return;
+	}
+	if (node->outcome == SOLVE_UNKNOWN) {
+		parent->unknown++;
+	}
+	if (--parent->pending == 0) {
+		parent->resolved = true;
+		parent->outcome = parent->unknown ? SOLVE_UNKNOWN : parent->or_node ? SOLVE_DISPROVEN : SOLVE_PROVEN;
+		shard_notify_parent(shard, node->parent);
+	}
+}
+
+static void shard_resolve(struct shard_ctx_t *shard, uint32_t index, enum solve_outcome_t outcome) {
+	if (shard->nodes[index].resolved) {
+		return;
+	}
+	shard->nodes[index].resolved = true;
+	shard->nodes[index].outcome = outcome;
+	shard_notify_parent(shard, index);
+}
+
+static bool shard_unit_needed(const struct shard_ctx_t *shard, uint32_t unit_index) {
+	for (uint32_t index = shard->units[unit_index].node; index != SHARD_NIL; index = shard->nodes[index].parent) {
+		if (shard->nodes[index].resolved) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void shard_enqueue(struct shard_ctx_t *shard, uint32_t unit_index) {
+	shard->queue[(shard->queue_head + shard->queue_length) % shard->unit_count] = unit_index;
+	shard->queue_length++;
+}
+
+static uint32_t shard_next_unit(struct shard_ctx_t *shard) {
+	while (shard->queue_length) {
+		uint32_t unit_index = shard->queue[shard->queue_head];
+		shard->queue_head = (shard->queue_head + 1) % shard->unit_count;
+		shard->queue_length--;
+		if (shard_unit_needed(shard, unit_index)) {
+			return unit_index;
+		}
+		shard->result->units_skipped++;
+	}
+	return SHARD_NIL;
+}
+
+static bool shard_read_full(int fd, void *vbuf, size_t length) {
+	uint8_t *buf = (uint8_t*)vbuf;
+	while (length) {
+		ssize_t bytes = read(fd, buf, length);
+		if ((bytes == -1) && (errno == EINTR)) {
+			continue;
+		}
+		if (bytes <= 0) {
+			return false;
+		}
+		buf += bytes;
+		length -= bytes;
+	}
+	return true;
+}
+
+static bool shard_write_full(int fd, const void *vbuf, size_t length) {
+	const uint8_t *buf = (const uint8_t*)vbuf;
+	while (length) {
+		ssize_t bytes = write(fd, buf, length);
+		if ((bytes == -1) && (errno == EINTR)) {
+			continue;
+		}
+		if (bytes <= 0) {
+			return false;
+		}
+		buf += bytes;
+		length -= bytes;
+	}
+	return true;
+}
+
+/* Unit checkpoints are named after the unit's position rather than its index,
+ * which depends on the split depth and the root. */
+static void shard_unit_checkpoint_filename(const struct shard_ctx_t *shard, const struct shard_unit_t *unit, char *filename, size_t size) {
+	snprintf(filename, size, "%s.unit.%016" PRIx64 "%016" PRIx64, shard->params->solve_params.checkpoint_filename, unit->position.words[1], unit->position.words[0]);
+}
+
+static void shard_worker(struct shard_ctx_t *shard, int fd) {
+	struct solve_params_t params = shard->params->solve_params;
+	params.memory_bytes /= shard->params->worker_count;
+	params.progress_interval = 0;
+	char checkpoint_filename[256];
+
+	struct shard_request_t request;
+	while (shard_read_full(fd, &request, sizeof(request))) {
+		const struct shard_unit_t *unit = &shard->units[request.unit];
+		game_unpack_position(shard->game, &unit->position);
+		if (shard->params->solve_params.checkpoint_filename) {
+			shard_unit_checkpoint_filename(shard, unit, checkpoint_filename, sizeof(checkpoint_filename));
+			params.checkpoint_filename = checkpoint_filename;
+		}
+
+		struct shard_response_t response = {
+			.unit = request.unit,
+			.outcome = SOLVE_UNKNOWN,
+		};
+		struct solve_result_t solve_result;
+		if (solve_position(shard->game, shard->attacker, &params, &solve_result)) {
+			response.outcome = solve_result.outcome;
+			response.expansions = solve_result.expansions;
+			response.peak_nodes = solve_result.peak_nodes;
+		}
+
+		/* Only a unit that ran out of budget has anything left to resume */
+		if (params.checkpoint_filename && (response.outcome != SOLVE_UNKNOWN)) {
+			unlink(params.checkpoint_filename);
+		}
+		if (!shard_write_full(fd, &response, sizeof(response))) {
+			break;
+		}
+	}
+	close(fd);
+}
+
+static bool shard_spawn_worker(struct shard_ctx_t *shard, unsigned int worker_id) {
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds)) {
+		perror("socketpair");
+		return false;
+	}
+	fflush(stdout);
+	fflush(stderr);
+	pid_t pid = fork();
+	if (pid == -1) {
+		perror("fork");
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+	if (pid == 0) {
+		/* Siblings must only ever see their own socket closed */
+		close(fds[0]);
+		for (unsigned int i = 0; i < shard->params->worker_count; i++) {
+			if (shard->workers[i].fd != -1) {
+				close(shard->workers[i].fd);
+			}
+		}
+		shard_worker(shard, fds[1]);
+		_exit(EXIT_SUCCESS);
+	}
+	close(fds[1]);
+	shard->workers[worker_id] = (struct shard_worker_t) {
+		.pid = pid,
+		.fd = fds[0],
+		.unit = SHARD_NIL,
+	};
+	return true;
+}
+
+static void shard_reap_worker(struct shard_worker_t *worker, int signal_number) {
+	if (worker->fd != -1) {
+		close(worker->fd);
+		worker->fd = -1;
+	}
+	if (worker->pid > 0) {
+		if (signal_number) {
+			kill(worker->pid, signal_number);
+		}
+		waitpid(worker->pid, NULL, 0);
+		worker->pid = 0;
+	}
+}
+
+static void shard_unit_path(const struct shard_ctx_t *shard, uint32_t unit_index, char *buf, size_t bufsize) {
+	uint32_t path[64];
+	unsigned int length = 0;
+	for (uint32_t index = shard->units[unit_index].node; (index != 0) && (length < 64); index = shard->nodes[index].parent) {
+		path[length++] = index;
+	}
+	size_t used = 0;
+	buf[0] = 0;
+	while (length-- && (used < bufsize)) {
+		struct action_t action;
+		char action_str[ACTION_STRING_MAXLEN];
+		game_unpack_action(shard->nodes[path[length]].packed_action, &action);
+		action_to_string(action_str, sizeof(action_str), &action);
+		used += snprintf(buf + used, bufsize - used, "%s%s", used ? " " : "", action_str);
+	}
+}
+
+static void shard_unit_finished(struct shard_ctx_t *shard, const struct shard_response_t *response) {
+	struct shard_result_t *result = shard->result;
+	result->units_solved++;
+	result->expansions += response->expansions;
+	if (response->peak_nodes > result->peak_nodes) {
+		result->peak_nodes = response->peak_nodes;
+	}
+	shard_resolve(shard, shard->units[response->unit].node, response->outcome);
+
+	char path_str[128];
+	shard_unit_path(shard, response->unit, path_str, sizeof(path_str));
+	printf("unit %5u/%u  %-40s %-14s %12" PRIu64 " expansions %10u nodes\n", response->unit + 1, shard->unit_count, path_str, solve_outcome_to_string(response->outcome), response->expansions, response->peak_nodes);
+	fflush(stdout);
+}
+
+static void shard_worker_failed(struct shard_ctx_t *shard, unsigned int worker_id) {
+	struct shard_worker_t *worker = &shard->workers[worker_id];
+	const uint32_t unit_index = worker->unit;
+	shard_reap_worker(worker, SIGKILL);
+
+	struct shard_unit_t *unit = &shard->units[unit_index];
+	unit->attempts++;
+	if (unit->attempts < SHARD_MAX_ATTEMPTS) {
+		fprintf(stderr, "shard: worker %u failed on unit %u, dispatching it again.\n", worker_id, unit_index + 1);
+		shard->result->redispatches++;
+		shard_enqueue(shard, unit_index);
+	} else {
+		fprintf(stderr, "shard: unit %u failed %u times, giving up on it.\n", unit_index + 1, unit->attempts);
+		shard->result->units_failed++;
+		shard_resolve(shard, unit->node, SOLVE_UNKNOWN);
+	}
+	shard_spawn_worker(shard, worker_id);
+}
+
+static void shard_dispatch(struct shard_ctx_t *shard) {
+	const unsigned int worker_count = shard->params->worker_count;
+	struct pollfd *pollfds = calloc(worker_count, sizeof(struct pollfd));
+	unsigned int *poll_workers = calloc(worker_count, sizeof(unsigned int));
+	if (!pollfds || !poll_workers) {
+		perror("calloc");
+		abort();
+	}
+
+	while (!shard->nodes[0].resolved) {
+		/* Hand out units to all idle workers */
+		for (unsigned int i = 0; i < worker_count; i++) {
+			struct shard_worker_t *worker = &shard->workers[i];
+			if ((worker->fd == -1) || (worker->unit != SHARD_NIL)) {
+				continue;
+			}
+			uint32_t unit_index = shard_next_unit(shard);
+			if (unit_index == SHARD_NIL) {
+				break;
+			}
+			struct shard_request_t request = {
+				.unit = unit_index,
+			};
+			worker->unit = unit_index;
+			if (!shard_write_full(worker->fd, &request, sizeof(request))) {
+				shard_worker_failed(shard, i);
+			}
+		}
+
+		unsigned int busy_count = 0;
+		for (unsigned int i = 0; i < worker_count; i++) {
+			if ((shard->workers[i].fd != -1) && (shard->workers[i].unit != SHARD_NIL)) {
+				pollfds[busy_count] = (struct pollfd) {
+					.fd = shard->workers[i].fd,
+					.events = POLLIN,
+				};
+				poll_workers[busy_count] = i;
+				busy_count++;
+			}
+		}
+		if (busy_count == 0) {
+			/* Nothing running and nothing left to dispatch */
+			break;
+		}
+		if (poll(pollfds, busy_count, -1) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("poll");
+			break;
+		}
+		for (unsigned int i = 0; i < busy_count; i++) {
+			if (!pollfds[i].revents) {
+				continue;
+			}
+			struct shard_worker_t *worker = &shard->workers[poll_workers[i]];
+			struct shard_response_t response;
+			if (!shard_read_full(worker->fd, &response, sizeof(response)) || (response.unit != worker->unit)) {
+				shard_worker_failed(shard, poll_workers[i]);
+				continue;
+			}
+			worker->unit = SHARD_NIL;
+			shard_unit_finished(shard, &response);
+		}
+	}
+	free(poll_workers);
+	free(pollfds);
+}
+
+bool shard_solve(struct game_t *game, const struct shard_params_t *params, struct shard_result_t *result) {
+	if (game->n > PACKED_POSITION_MAX_N) {
+		fprintf(stderr, "Solving is limited to boards of n <= %d.\n", PACKED_POSITION_MAX_N);
+		return false;
+	}
+	if (params->worker_count < 1) {
+		fprintf(stderr, "Sharded solving needs at least one worker.\n");
+		return false;
+	}
+	*result = (struct shard_result_t) {
+		.outcome = SOLVE_UNKNOWN,
+	};
+	struct shard_ctx_t shard = {
+		.params = params,
+		.game = game,
+		.attacker = game->side_turn,
+		.result = result,
+	};
+
+	struct packed_position_t root_position;
+	game_pack_position(game, game->side_turn, &root_position);
+	shard_add_node(&shard, SHARD_NIL, 0, true);
+	if (game_won_by(game, game->side_turn) || game_won_by(game, !game->side_turn)) {
+		shard.nodes[0].terminal = true;
+		shard.nodes[0].outcome = game_won_by(game, game->side_turn) ? SOLVE_PROVEN : SOLVE_DISPROVEN;
+	} else if (params->split_depth == 0) {
+		shard_add_unit(&shard, 0, game, game->side_turn);
+	} else {
+		shard_build(&shard, game, 0, 0);
+	}
+	for (uint32_t i = 0; i < shard.node_count; i++) {
+		if (shard.nodes[i].terminal) {
+			shard_resolve(&shard, i, shard.nodes[i].outcome);
+		}
+	}
+	result->unit_count = shard.unit_count;
+	fprintf(stderr, "shard: split tree of depth %u has %u nodes and %u work units for %u workers.\n", params->split_depth, shard.node_count, shard.unit_count, params->worker_count);
+
+	if (shard.unit_count) {
+		shard.queue = calloc(shard.unit_count, sizeof(uint32_t));
+		shard.workers = calloc(params->worker_count, sizeof(struct shard_worker_t));
+		if (!shard.queue || !shard.workers) {
+			perror("calloc");
+			abort();
+		}
+		for (uint32_t i = 0; i < shard.unit_count; i++) {
+			shard_enqueue(&shard, i);
+		}
+		for (unsigned int i = 0; i < params->worker_count; i++) {
+			shard.workers[i].fd = -1;
+		}
+
+		/* Dead workers must show up as failed reads, not kill us */
+		struct sigaction old_action, ignore_action = {
+			.sa_handler = SIG_IGN,
+		};
+		sigaction(SIGPIPE, &ignore_action, &old_action);
+		bool spawned = true;
+		for (unsigned int i = 0; spawned && (i < params->worker_count); i++) {
+			spawned = shard_spawn_worker(&shard, i);
+		}
+		if (spawned) {
+			shard_dispatch(&shard);
+		}
+
+		/* Workers still busy are working on units that no longer matter */
+		for (unsigned int i = 0; i < params->worker_count; i++) {
+			const bool busy = (shard.workers[i].fd != -1) && (shard.workers[i].unit != SHARD_NIL);
+			result->units_skipped += busy;
+			shard_reap_worker(&shard.workers[i], busy ? SIGTERM : 0);
+		}
+		sigaction(SIGPIPE, &old_action, NULL);
+		result->units_skipped += shard.queue_length;
+	}
+	game_unpack_position(game, &root_position);
+
+	if (shard.nodes[0].resolved) {
+		result->outcome = shard.nodes[0].outcome;
+	}
+	if (result->outcome == SOLVE_PROVEN) {
+		for (uint32_t i = 1; i < shard.node_count; i++) {
+			if ((shard.nodes[i].parent == 0) && shard.nodes[i].resolved && (shard.nodes[i].outcome == SOLVE_PROVEN)) {
+				result->have_action = true;
+				game_unpack_action(shard.nodes[i].packed_action, &result->winning_action);
+				break;
+			}
+		}
+	}
+
+	free(shard.workers);
+	free(shard.queue);
+	free(shard.units);
+	free(shard.nodes);
+	return true;
+}
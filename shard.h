@@ -0,0 +1,54 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __SHARD_H__
+#define __SHARD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game.h"
+#include "solve.h"
+
+struct shard_params_t {
+	unsigned int split_depth;
+	unsigned int worker_count;
+	struct solve_params_t solve_params;
+};
+
+struct shard_result_t {
+	enum solve_outcome_t outcome;
+	bool have_action;
+	struct action_t winning_action;
+	unsigned int unit_count;
+	unsigned int units_solved;
+	unsigned int units_skipped;
+	unsigned int units_failed;
+	unsigned int redispatches;
+	uint64_t expansions;
+	uint32_t peak_nodes;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+bool shard_solve(struct game_t *game, const struct shard_params_t *params, struct shard_result_t *result);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,571 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include "solve.h"
+#include "mmapfile.h"
+#include "hugemem.h"
+#include "monotime.h"
+
+/* Proof-number search that proves or disproves a forced win for the attacking
+ * side, which usually is the side to move. The tree lives in a fixed-size
+ * node table that is allocated once; children of a node form a singly linked
+ * sibling list so that nodes can be handed back to a free list individually.
+ * As soon as a node is solved its value no longer depends on its subtree,
+ * which is then returned to the free list. Positions are not stored in the
+ * nodes: every iteration replays the actions from the root to the
+ * most-proving node. A position that repeats one on the current path is a
+ * draw and therefore disproven, as is a position in which the side to move
+ * has no legal action. When the table is exhausted nonetheless, every subtree
+ * that hangs off the current most-proving path is collapsed into its (kept)
+ * proof and disproof numbers and gets re-expanded on demand.
+ *
+ * With a checkpoint file, the node table is a shared mapping of that file,
+ * so a killed process loses nothing that the page cache has seen; the file is
+ * additionally synced to disk periodically. On resume the tree is repaired:
+ * an interrupted expansion is discarded, all interior proof and disproof
+ * numbers are recomputed and the free list is rebuilt from unreachable
+ * nodes. */
+
+#define SOLVE_INFINITY		UINT32_MAX
+#define SOLVE_NIL			UINT32_MAX
+#define SOLVE_CHECK_INTERVAL	1024
+#define SOLVE_CHECKPOINT_MAGIC		0x56535049		/* "IPSV" */
+#define SOLVE_CHECKPOINT_VERSION	1
+
+struct solve_node_t {
+	uint32_t proof, disproof;
+	uint32_t packed_action;
+	uint32_t first_child;
+	uint32_t next_sibling;
+};
+
+/* Everything needed to continue a search is kept in this header and the node
+ * table that directly follows it, either on the heap or in a shared mapping of
+ * the checkpoint file. */
+struct solve_state_t {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t n;
+	uint32_t attacker;
+	struct packed_position_t root_position;
+	uint32_t capacity;
+	uint32_t free_list;
+	uint32_t unused;
+	uint32_t used_count;
+	uint32_t peak_count;
+	uint32_t collapse_count;
+	uint32_t expanding;
+	uint32_t reserved;
+	uint64_t expansions;
+	double elapsed;
+};
+
+struct solve_ctx_t {
+	struct solve_state_t *state;
+	struct solve_node_t *nodes;
+	struct mmapfile_t *checkpoint;
+	struct hugemem_t memory;
+	double t_accounted;
+	bool root_or;
+
+	unsigned int path_length;
+	unsigned int path_capacity;
+	uint32_t *path;
+	uint64_t *path_hashes;
+};
+
+struct solve_expand_ctx_t {
+	struct solve_ctx_t *solve;
+	uint32_t parent;
+	uint32_t last_child;
+	bool or_node;
+	bool out_of_nodes;
+};
+
+static inline uint32_t solve_add(uint32_t a, uint32_t b) {
+	return (a >= SOLVE_INFINITY - b) ? SOLVE_INFINITY : a + b;
+}
+
+static inline bool solve_node_solved(const struct solve_node_t *node) {
+	return (node->proof == 0) || (node->disproof == 0);
+}
+
+static void solve_number_to_string(char *buf, size_t bufsize, uint32_t value) {
+	if (value == SOLVE_INFINITY) {
+		snprintf(buf, bufsize, "inf");
+	} else {
+		snprintf(buf, bufsize, "%u", value);
+	}
+}
+
+static uint32_t solve_alloc_node(struct solve_ctx_t *solve) {
+	uint32_t index;
+	if (solve->state->free_list != SOLVE_NIL) {
+		index = solve->state->free_list;
+		solve->state->free_list = solve->nodes[index].next_sibling;
+	} else if (solve->state->unused < solve->state->capacity) {
+		index = solve->state->unused++;
+	} else {
+		return SOLVE_NIL;
+	}
+	solve->state->used_count++;
+	if (solve->state->used_count > solve->state->peak_count) {
+		solve->state->peak_count = solve->state->used_count;
+	}
+	return index;
+}
+
+/* Returns all descendants of a node to the free list, the node itself is
+ * kept. */
+static void solve_free_subtree(struct solve_ctx_t *solve, uint32_t index) {
+	uint32_t child = solve->nodes[index].first_child;
+	while (child != SOLVE_NIL) {
+		uint32_t next = solve->nodes[child].next_sibling;
+		solve_free_subtree(solve, child);
+		solve->nodes[child].next_sibling = solve->state->free_list;
+		solve->state->free_list = child;
+		solve->state->used_count--;
+		child = next;
+	}
+	solve->nodes[index].first_child = SOLVE_NIL;
+}
+
+/* Frees all subtrees that do not contain the current path. */
+static void solve_collapse(struct solve_ctx_t *solve) {
+	for (unsigned int depth = 0; depth + 1 < solve->path_length; depth++) {
+		for (uint32_t child = solve->nodes[solve->path[depth]].first_child; child != SOLVE_NIL; child = solve->nodes[child].next_sibling) {
+			if (child != solve->path[depth + 1]) {
+				solve_free_subtree(solve, child);
+			}
+		}
+	}
+	solve->state->collapse_count++;
+}
+
+static void solve_path_push(struct solve_ctx_t *solve, uint32_t index, uint64_t hash) {
+	if (solve->path_length == solve->path_capacity) {
+		solve->path_capacity = solve->path_capacity ? (2 * solve->path_capacity) : 64;
+		solve->path = realloc(solve->path, sizeof(uint32_t) * solve->path_capacity);
+		solve->path_hashes = realloc(solve->path_hashes, sizeof(uint64_t) * solve->path_capacity);
+		if (!solve->path || !solve->path_hashes) {
+			fprintf(stderr, "Failed to grow solver path to %u entries.\n", solve->path_capacity);
+			abort();
+		}
+	}
+	solve->path[solve->path_length] = index;
+	solve->path_hashes[solve->path_length] = hash;
+	solve->path_length++;
+}
+
+static bool solve_path_contains(const struct solve_ctx_t *solve, uint64_t hash) {
+	for (unsigned int i = 0; i < solve->path_length; i++) {
+		if (solve->path_hashes[i] == hash) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Returns the game from the end of the current path to the root. Unless the
+ * path was deeper than the undo stack, that is done by unmaking its actions
+ * instead of unpacking the root position. */
+static void solve_rewind(const struct solve_ctx_t *solve, struct game_t *game) {
+	if (solve->path_length && (game->undo_depth + 1 == solve->path_length)) {
+		while (game->undo_depth) {
+			game_unmake_action(game);
+		}
+	} else {
+		game_unpack_position(game, &solve->state->root_position);
+	}
+}
+
+/* Recomputes proof and disproof number of an interior node. Returns true if
+ * either of them changed. */
+static bool solve_update_node(struct solve_ctx_t *solve, uint32_t index, bool or_node) {
+	struct solve_node_t *node = &solve->nodes[index];
+	uint32_t proof = or_node ? SOLVE_INFINITY : 0;
+	uint32_t disproof = or_node ? 0 : SOLVE_INFINITY;
+	for (uint32_t child = node->first_child; child != SOLVE_NIL; child = solve->nodes[child].next_sibling) {
+		const struct solve_node_t *child_node = &solve->nodes[child];
+		if (or_node) {
+			if (child_node->proof < proof) {
+				proof = child_node->proof;
+			}
+			disproof = solve_add(disproof, child_node->disproof);
+		} else {
+			proof = solve_add(proof, child_node->proof);
+			if (child_node->disproof < disproof) {
+				disproof = child_node->disproof;
+			}
+		}
+	}
+	bool changed = (node->proof != proof) || (node->disproof != disproof);
+	node->proof = proof;
+	node->disproof = disproof;
+	return changed;
+}
+
+static uint32_t solve_most_proving_child(const struct solve_ctx_t *solve, uint32_t index, bool or_node) {
+	uint32_t best = SOLVE_NIL;
+	uint32_t best_value = SOLVE_INFINITY;
+	for (uint32_t child = solve->nodes[index].first_child; child != SOLVE_NIL; child = solve->nodes[child].next_sibling) {
+		uint32_t value = or_node ? solve->nodes[child].proof : solve->nodes[child].disproof;
+		if ((best == SOLVE_NIL) || (value < best_value)) {
+			best = child;
+			best_value = value;
+		}
+	}
+	return best;
+}
+
+static bool solve_expand_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct solve_expand_ctx_t *ctx = (struct solve_expand_ctx_t*)vctx;
+	struct solve_ctx_t *solve = ctx->solve;
+
+	uint32_t index = solve_alloc_node(solve);
+	if (index == SOLVE_NIL) {
+		ctx->out_of_nodes = true;
+		return false;
+	}
+	struct solve_node_t *node = &solve->nodes[index];
+	*node = (struct solve_node_t) {
+		.proof = 1,
+		.disproof = 1,
+		.packed_action = game_pack_action(action),
+		.first_child = SOLVE_NIL,
+		.next_sibling = SOLVE_NIL,
+	};
+	if (ctx->last_child == SOLVE_NIL) {
+		solve->nodes[ctx->parent].first_child = index;
+	} else {
+		solve->nodes[ctx->last_child].next_sibling = index;
+	}
+	ctx->last_child = index;
+
+	const enum side_t mover = game->side_turn;
+	bool disproven;
+	if (game_won_by(game, mover)) {
+		disproven = (mover != solve->state->attacker);
+	} else {
+		game_pass_turn(game);
+		bool repeated = solve_path_contains(solve, game->hash);
+		game_pass_turn(game);
+		if (!repeated) {
+			return true;
+		}
+		disproven = true;
+	}
+	node->proof = disproven ? SOLVE_INFINITY : 0;
+	node->disproof = disproven ? 0 : SOLVE_INFINITY;
+
+	/* A proven child proves an OR node, a disproven child disproves an AND
+	 * node; the remaining actions need not be looked at. */
+	return ctx->or_node ? disproven : !disproven;
+}
+
+static void solve_print_progress(const struct solve_ctx_t *solve, uint64_t run_expansions, double run_time) {
+	char proof_str[16], disproof_str[16];
+	solve_number_to_string(proof_str, sizeof(proof_str), solve->nodes[0].proof);
+	solve_number_to_string(disproof_str, sizeof(disproof_str), solve->nodes[0].disproof);
+	printf("%8.1f secs %12" PRIu64 " expansions %10u nodes (%5.1f%%) %4u collapses %9.0f exp/sec  root pn %s dn %s\n", solve->state->elapsed, solve->state->expansions, solve->state->used_count, 100.0 * solve->state->used_count / solve->state->capacity, solve->state->collapse_count, (run_time > 0) ? run_expansions / run_time : 0, proof_str, disproof_str);
+	fflush(stdout);
+}
+
+static uint32_t solve_mark_reachable(struct solve_ctx_t *solve, uint32_t index, unsigned int depth, uint8_t *reachable) {
+	uint32_t count = 1;
+	reachable[index] = 1;
+	for (uint32_t child = solve->nodes[index].first_child; child != SOLVE_NIL; child = solve->nodes[child].next_sibling) {
+		count += solve_mark_reachable(solve, child, depth + 1, reachable);
+	}
+	if (solve->nodes[index].first_child != SOLVE_NIL) {
+		solve_update_node(solve, index, ((depth % 2) == 0) == solve->root_or);
+	}
+	return count;
+}
+
+/* Brings a tree that may have been interrupted at any point back into a
+ * consistent state. */
+static void solve_repair(struct solve_ctx_t *solve) {
+	if (solve->state->expanding != SOLVE_NIL) {
+		solve->nodes[solve->state->expanding].first_child = SOLVE_NIL;
+		solve->state->expanding = SOLVE_NIL;
+	}
+	uint8_t *reachable = calloc(solve->state->unused, 1);
+	if (!reachable) {
+		perror("calloc");
+		abort();
+	}
+	solve->state->used_count = solve_mark_reachable(solve, 0, 0, reachable);
+	solve->state->free_list = SOLVE_NIL;
+	for (uint32_t i = solve->state->unused; i > 0; i--) {
+		if (!reachable[i - 1]) {
+			solve->nodes[i - 1].next_sibling = solve->state->free_list;
+			solve->state->free_list = i - 1;
+		}
+	}
+	free(reachable);
+}
+
+static bool solve_same_root(const struct solve_state_t *state, const struct game_t *game, enum side_t attacker) {
+	struct packed_position_t root_position;
+	game_pack_position(game, game->side_turn, &root_position);
+	return (state->attacker == attacker) && !memcmp(&state->root_position, &root_position, sizeof(root_position));
+}
+
+/* A checkpoint is only resumed if it is for the position and attacker asked
+ * for, otherwise it would answer a different question. */
+static bool solve_resume(struct solve_ctx_t *solve, struct game_t *game, enum side_t attacker, const char *filename) {
+	if (access(filename, F_OK)) {
+		return false;
+	}
+	solve->checkpoint = mmapfile_open(filename, true);
+	if (!solve->checkpoint) {
+		return false;
+	}
+	struct solve_state_t *state = (struct solve_state_t*)solve->checkpoint->data;
+	if ((solve->checkpoint->length < sizeof(struct solve_state_t)) || (state->magic != SOLVE_CHECKPOINT_MAGIC) || (state->version != SOLVE_CHECKPOINT_VERSION) || (solve->checkpoint->length < sizeof(struct solve_state_t) + (sizeof(struct solve_node_t) * state->capacity))) {
+		fprintf(stderr, "%s: not a solver checkpoint, starting over.\n", filename);
+	} else if (state->n != game->n) {
+		fprintf(stderr, "%s: checkpoint is for Iso-Path(%u), starting over.\n", filename, state->n);
+	} else if (!solve_same_root(state, game, attacker)) {
+		fprintf(stderr, "%s: checkpoint is for a different position or attacker, starting over.\n", filename);
+	} else {
+		solve->state = state;
+		solve->nodes = (struct solve_node_t*)(state + 1);
+		solve->root_or = (game->side_turn == state->attacker);
+		solve_repair(solve);
+		fprintf(stderr, "%s: resuming after %" PRIu64 " expansions and %.1f secs, %u nodes in use.\n", filename, state->expansions, state->elapsed, state->used_count);
+		return true;
+	}
+	mmapfile_close(solve->checkpoint);
+	solve->checkpoint = NULL;
+	return false;
+}
+
+static bool solve_init_state(struct solve_ctx_t *solve, struct game_t *game, enum side_t attacker, const struct solve_params_t *params) {
+	size_t capacity = params->memory_bytes / sizeof(struct solve_node_t);
+	if (capacity >= SOLVE_NIL) {
+		capacity = SOLVE_NIL - 1;
+	}
+	if (capacity < 1) {
+		fprintf(stderr, "Not enough memory for the solver node table.\n");
+		return false;
+	}
+	const size_t length = sizeof(struct solve_state_t) + (sizeof(struct solve_node_t) * capacity);
+	if (params->checkpoint_filename) {
+		solve->checkpoint = mmapfile_create(params->checkpoint_filename, length);
+		if (!solve->checkpoint) {
+			return false;
+		}
+		solve->state = (struct solve_state_t*)solve->checkpoint->data;
+	} else {
+		if (!hugemem_alloc(&solve->memory, length, 0)) {
+			return false;
+		}
+		solve->state = (struct solve_state_t*)solve->memory.data;
+	}
+	solve->nodes = (struct solve_node_t*)(solve->state + 1);
+	*solve->state = (struct solve_state_t) {
+		.magic = SOLVE_CHECKPOINT_MAGIC,
+		.version = SOLVE_CHECKPOINT_VERSION,
+		.n = game->n,
+		.attacker = attacker,
+		.capacity = capacity,
+		.free_list = SOLVE_NIL,
+		.expanding = SOLVE_NIL,
+	};
+	game_pack_position(game, game->side_turn, &solve->state->root_position);
+	solve->root_or = (game->side_turn == attacker);
+
+	uint32_t root = solve_alloc_node(solve);
+	solve->nodes[root] = (struct solve_node_t) {
+		.proof = 1,
+		.disproof = 1,
+		.first_child = SOLVE_NIL,
+		.next_sibling = SOLVE_NIL,
+	};
+	if (game_won_by(game, solve->state->attacker)) {
+		solve->nodes[root].proof = 0;
+		solve->nodes[root].disproof = SOLVE_INFINITY;
+	} else if (game_won_by(game, !solve->state->attacker)) {
+		solve->nodes[root].proof = SOLVE_INFINITY;
+		solve->nodes[root].disproof = 0;
+	}
+	return true;
+}
+
+/* Adds the time since the last call to the accumulated solving time. */
+static void solve_account_time(struct solve_ctx_t *solve, double t) {
+	solve->state->elapsed += t - solve->t_accounted;
+	solve->t_accounted = t;
+}
+
+const char *solve_outcome_to_string(enum solve_outcome_t outcome) {
+	switch (outcome) {
+		case SOLVE_PROVEN:		return "proven win";
+		case SOLVE_DISPROVEN:	return "no forced win";
+		case SOLVE_UNKNOWN:		return "unknown";
+	}
+	return "?";
+}
+
+bool solve_position(struct game_t *game, enum side_t attacker, const struct solve_params_t *params, struct solve_result_t *result) {
+	if (game->n > PACKED_POSITION_MAX_N) {
+		fprintf(stderr, "Solving is limited to boards of n <= %d.\n", PACKED_POSITION_MAX_N);
+		return false;
+	}
+	struct solve_ctx_t solve = { 0 };
+	if (!(params->checkpoint_filename && solve_resume(&solve, game, attacker, params->checkpoint_filename)) && !solve_init_state(&solve, game, attacker, params)) {
+		return false;
+	}
+	const uint32_t root = 0;
+
+	uint64_t run_expansions = 0;
+	bool out_of_nodes = false;
+	bool collapsed = false;
+	const double t0 = monotime_secs();
+	solve.t_accounted = t0;
+	double next_progress = t0 + params->progress_interval;
+	double next_sync = t0 + params->checkpoint_interval;
+	while (!solve_node_solved(&solve.nodes[root])) {
+		if (params->expansion_budget && (run_expansions >= params->expansion_budget)) {
+			break;
+		}
+		if ((run_expansions % SOLVE_CHECK_INTERVAL) == 0) {
+			const double t = monotime_secs();
+			solve_account_time(&solve, t);
+			if (params->progress_interval && (t >= next_progress)) {
+				solve_print_progress(&solve, run_expansions, t - t0);
+				next_progress = t + params->progress_interval;
+			}
+			if (solve.checkpoint && params->checkpoint_interval && (t >= next_sync)) {
+				mmapfile_sync(solve.checkpoint);
+				next_sync = t + params->checkpoint_interval;
+			}
+		}
+
+		/* Descend to the most-proving node, replaying its actions */
+		solve_rewind(&solve, game);
+		solve.path_length = 0;
+		solve_path_push(&solve, root, game->hash);
+		uint32_t index = root;
+		while (solve.nodes[index].first_child != SOLVE_NIL) {
+			index = solve_most_proving_child(&solve, index, game->side_turn == solve.state->attacker);
+			struct action_t action;
+			game_unpack_action(solve.nodes[index].packed_action, &action);
+			if (game->undo_depth < GAME_UNDO_CAPACITY) {
+				game_make_action(game, &action);
+			} else {
+				game_perform_action(game, &action);
+			}
+			solve_path_push(&solve, index, game->hash);
+		}
+
+		struct solve_expand_ctx_t expand_ctx = {
+			.solve = &solve,
+			.parent = index,
+			.last_child = SOLVE_NIL,
+			.or_node = (game->side_turn == solve.state->attacker),
+			.out_of_nodes = false,
+		};
+		solve.state->expanding = index;
+		enumerate_valid_actions(game, solve_expand_callback, &expand_ctx);
+		if (expand_ctx.out_of_nodes) {
+			solve_free_subtree(&solve, index);
+			solve.state->expanding = SOLVE_NIL;
+			if (collapsed) {
+				/* Not even the path on its own fits */
+				out_of_nodes = true;
+				break;
+			}
+			solve_collapse(&solve);
+			collapsed = true;
+			continue;
+		}
+		collapsed = false;
+		run_expansions++;
+		solve.state->expansions++;
+		if (expand_ctx.last_child == SOLVE_NIL) {
+			/* No legal action, the game is stuck */
+			solve.nodes[index].proof = SOLVE_INFINITY;
+			solve.nodes[index].disproof = 0;
+		} else {
+			solve_update_node(&solve, index, expand_ctx.or_node);
+		}
+		solve.state->expanding = SOLVE_NIL;
+
+		/* Propagate to the root. The side to move alternates along the path.
+		 * Solved subtrees are garbage collected on the way, except for the
+		 * root's children which tell the winning action. */
+		for (int depth = solve.path_length - 1; depth >= 0; depth--) {
+			index = solve.path[depth];
+			if ((depth != (int)solve.path_length - 1) && !solve_update_node(&solve, index, ((depth % 2) == 0) == solve.root_or)) {
+				break;
+			}
+			if ((depth > 0) && solve_node_solved(&solve.nodes[index])) {
+				solve_free_subtree(&solve, index);
+			}
+		}
+	}
+	game_unpack_position(game, &solve.state->root_position);
+	const double t_end = monotime_secs();
+	const double run_time = t_end - t0;
+	solve_account_time(&solve, t_end);
+	if (params->progress_interval) {
+		solve_print_progress(&solve, run_expansions, run_time);
+	}
+	if (out_of_nodes) {
+		fprintf(stderr, "Solver node table of %u nodes exhausted.\n", solve.state->capacity);
+	}
+
+	*result = (struct solve_result_t) {
+		.outcome = (solve.nodes[root].proof == 0) ? SOLVE_PROVEN : (solve.nodes[root].disproof == 0) ? SOLVE_DISPROVEN : SOLVE_UNKNOWN,
+		.proof = solve.nodes[root].proof,
+		.disproof = solve.nodes[root].disproof,
+		.expansions = solve.state->expansions,
+		.peak_nodes = solve.state->peak_count,
+	};
+	if ((result->outcome == SOLVE_PROVEN) && solve.root_or) {
+		for (uint32_t child = solve.nodes[root].first_child; child != SOLVE_NIL; child = solve.nodes[child].next_sibling) {
+			if (solve.nodes[child].proof == 0) {
+				result->have_action = true;
+				game_unpack_action(solve.nodes[child].packed_action, &result->winning_action);
+				break;
+			}
+		}
+	}
+
+	free(solve.path);
+	free(solve.path_hashes);
+	if (solve.checkpoint) {
+		mmapfile_sync(solve.checkpoint);
+		mmapfile_close(solve.checkpoint);
+	} else {
+		hugemem_free(&solve.memory);
+	}
+	return true;
+}
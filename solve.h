@@ -0,0 +1,59 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __SOLVE_H__
+#define __SOLVE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "game.h"
+
+enum solve_outcome_t {
+	SOLVE_PROVEN,
+	SOLVE_DISPROVEN,
+	SOLVE_UNKNOWN,
+};
+
+struct solve_params_t {
+	size_t memory_bytes;
+	uint64_t expansion_budget;
+	double progress_interval;
+	const char *checkpoint_filename;
+	double checkpoint_interval;
+};
+
+struct solve_result_t {
+	enum solve_outcome_t outcome;
+	bool have_action;
+	struct action_t winning_action;
+	uint32_t proof, disproof;
+	uint64_t expansions;
+	uint32_t peak_nodes;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+const char *solve_outcome_to_string(enum solve_outcome_t outcome);
+bool solve_position(struct game_t *game, enum side_t attacker, const struct solve_params_t *params, struct solve_result_t *result);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
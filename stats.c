@@ -0,0 +1,225 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include "stats.h"
+
+/* Thread blocks are never freed: a block is handed over to the next thread
+ * once its thread has exited, so what it counted stays in the totals. */
+
+#define STATS_REPORTER_TICK_NS		(50 * 1000 * 1000)
+
+struct stats_reporter_t {
+	pthread_t thread;
+	FILE *f;
+	bool close_file;
+	double interval;
+	uint64_t start_ns;
+	atomic_bool stop;
+	bool running;
+};
+
+static const char *counter_names[STATS_COUNTER_COUNT] = {
+	[STATS_ACTIONS_BUILD_MOVE] = "actions_build_move",
+	[STATS_ACTIONS_CAPTURE_MOVE] = "actions_capture_move",
+	[STATS_ACTIONS_CAPTURE_BUILD] = "actions_capture_build",
+	[STATS_EVALUATIONS] = "evaluations",
+	[STATS_WIN_CHECKS] = "win_checks",
+	[STATS_TTABLE_PROBES] = "ttable_probes",
+	[STATS_TTABLE_HITS] = "ttable_hits",
+	[STATS_ALLOCATIONS] = "allocations",
+	[STATS_SEARCH_NODES] = "search_nodes",
+	[STATS_TURNS] = "turns",
+};
+
+static const char *phase_names[STATS_PHASE_COUNT] = {
+	[STATS_PHASE_OTHER] = "other",
+	[STATS_PHASE_GENERATE] = "generate",
+	[STATS_PHASE_EVALUATE] = "evaluate",
+	[STATS_PHASE_SEARCH] = "search",
+};
+
+_Thread_local struct stats_thread_t *stats_thread;
+static _Atomic(struct stats_thread_t*) stats_threads;
+static pthread_key_t stats_key;
+static pthread_once_t stats_key_once = PTHREAD_ONCE_INIT;
+static atomic_bool stats_report_requested;
+static struct stats_reporter_t stats_reporter;
+
+bool stats_enabled(void) {
+#ifdef ENABLE_STATS
+	return true;
+#else
+	return false;
+#endif
+}
+
+static void stats_thread_exit(void *vthread) {
+	struct stats_thread_t *thread = (struct stats_thread_t*)vthread;
+	atomic_store(&thread->in_use, false);
+}
+
+static void stats_create_key(void) {
+	pthread_key_create(&stats_key, stats_thread_exit);
+}
+
+struct stats_thread_t *stats_thread_register(void) {
+	pthread_once(&stats_key_once, stats_create_key);
+	struct stats_thread_t *thread;
+	for (thread = atomic_load(&stats_threads); thread; thread = thread->next) {
+		bool expected = false;
+		if (atomic_compare_exchange_strong(&thread->in_use, &expected, true)) {
+			break;
+		}
+	}
+	if (!thread) {
+		thread = calloc(1, sizeof(struct stats_thread_t));
+		if (!thread) {
+			fprintf(stderr, "fatal: cannot allocate performance counters.\n");
+			abort();
+		}
+		atomic_store(&thread->in_use, true);
+		thread->next = atomic_load(&stats_threads);
+		while (!atomic_compare_exchange_weak(&stats_threads, &thread->next, thread));
+	}
+	thread->phase = STATS_PHASE_OTHER;
+	thread->phase_start = monotime_ns();
+	pthread_setspecific(stats_key, thread);
+	stats_thread = thread;
+	return thread;
+}
+
+/* Sums up all thread blocks. Counts of running threads are read while they
+ * change, so the snapshot is not taken at one instant but every value is
+ * exact at some point during collection. */
+void stats_collect(struct stats_snapshot_t *snapshot) {
+	memset(snapshot, 0, sizeof(struct stats_snapshot_t));
+	for (struct stats_thread_t *thread = atomic_load(&stats_threads); thread; thread = thread->next) {
+		for (int i = 0; i < STATS_COUNTER_COUNT; i++) {
+			snapshot->counters[i] += atomic_load_explicit(&thread->counters[i], memory_order_relaxed);
+		}
+		for (int i = 0; i < STATS_PHASE_COUNT; i++) {
+			snapshot->phase_ns[i] += atomic_load_explicit(&thread->phase_ns[i], memory_order_relaxed);
+		}
+		snapshot->thread_count += atomic_load(&thread->in_use);
+	}
+}
+
+/* One JSON object per line */
+void stats_write_json(FILE *f, const struct stats_snapshot_t *snapshot, double elapsed) {
+	fprintf(f, "{\"elapsed\": %.3f, \"threads\": %u, \"counters\": {", elapsed, snapshot->thread_count);
+	for (int i = 0; i < STATS_COUNTER_COUNT; i++) {
+		fprintf(f, "%s\"%s\": %" PRIu64, i ? ", " : "", counter_names[i], snapshot->counters[i]);
+	}
+	fprintf(f, "}, \"phase_ns\": {");
+	for (int i = 0; i < STATS_PHASE_COUNT; i++) {
+		fprintf(f, "%s\"%s\": %" PRIu64, i ? ", " : "", phase_names[i], snapshot->phase_ns[i]);
+	}
+	fprintf(f, "}}\n");
+	fflush(f);
+}
+
+static void stats_report(struct stats_reporter_t *reporter) {
+	struct stats_snapshot_t snapshot;
+	stats_collect(&snapshot);
+	stats_write_json(reporter->f, &snapshot, (monotime_ns() - reporter->start_ns) * 1e-9);
+}
+
+static void stats_sigusr1_handler(int signal_number) {
+	atomic_store(&stats_report_requested, true);
+}
+
+static void *stats_reporter_thread(void *vreporter) {
+	struct stats_reporter_t *reporter = (struct stats_reporter_t*)vreporter;
+	const uint64_t interval_ns = reporter->interval * 1e9;
+	uint64_t next_report = reporter->start_ns + interval_ns;
+	while (!atomic_load(&reporter->stop)) {
+		const struct timespec tick = {
+			.tv_nsec = STATS_REPORTER_TICK_NS,
+		};
+		nanosleep(&tick, NULL);
+		const uint64_t now = monotime_ns();
+		if (atomic_exchange(&stats_report_requested, false) || (interval_ns && (now >= next_report))) {
+			stats_report(reporter);
+			next_report = now + interval_ns;
+		}
+	}
+	return NULL;
+}
+
+/* Writes the counters every interval seconds (zero meaning only on
+ * SIGUSR1) and once more when stopped. Output goes to stderr if filename is
+ * NULL. */
+bool stats_start_reporter(const char *filename, double interval) {
+	if (!stats_enabled()) {
+		fprintf(stderr, "Performance counters are not compiled in, rebuild with \"make STATS=1\".\n");
+		return false;
+	}
+	struct stats_reporter_t *reporter = &stats_reporter;
+	*reporter = (struct stats_reporter_t) {
+		.f = stderr,
+		.interval = interval,
+		.start_ns = monotime_ns(),
+	};
+	if (filename) {
+		reporter->f = fopen(filename, "w");
+		if (!reporter->f) {
+			perror(filename);
+			return false;
+		}
+		reporter->close_file = true;
+	}
+	struct sigaction action = {
+		.sa_handler = stats_sigusr1_handler,
+		.sa_flags = SA_RESTART,
+	};
+	sigaction(SIGUSR1, &action, NULL);
+	if (pthread_create(&reporter->thread, NULL, stats_reporter_thread, reporter)) {
+		fprintf(stderr, "Cannot create statistics reporter thread.\n");
+		if (reporter->close_file) {
+			fclose(reporter->f);
+		}
+		return false;
+	}
+	reporter->running = true;
+	return true;
+}
+
+void stats_stop_reporter(void) {
+	struct stats_reporter_t *reporter = &stats_reporter;
+	if (!reporter->running) {
+		return;
+	}
+	atomic_store(&reporter->stop, true);
+	pthread_join(reporter->thread, NULL);
+	stats_report(reporter);
+	if (reporter->close_file) {
+		fclose(reporter->f);
+	}
+	reporter->running = false;
+}
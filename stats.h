@@ -0,0 +1,118 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "monotime.h"
+
+/* Performance counters for the hot paths. They only exist when building with
+ * "make STATS=1", which defines ENABLE_STATS; otherwise all STATS_* macros
+ * compile to nothing. Every thread counts into its own block without any
+ * synchronization beyond relaxed atomics, readers sum over all blocks. */
+
+enum stats_counter_t {
+	STATS_ACTIONS_BUILD_MOVE,
+	STATS_ACTIONS_CAPTURE_MOVE,
+	STATS_ACTIONS_CAPTURE_BUILD,
+	STATS_EVALUATIONS,
+	STATS_WIN_CHECKS,
+	STATS_TTABLE_PROBES,
+	STATS_TTABLE_HITS,
+	STATS_ALLOCATIONS,
+	STATS_SEARCH_NODES,
+	STATS_TURNS,
+	STATS_COUNTER_COUNT,
+};
+
+/* Time is charged to exactly one phase at a time; entering a phase pauses
+ * the enclosing one until the matching leave. */
+enum stats_phase_t {
+	STATS_PHASE_OTHER,
+	STATS_PHASE_GENERATE,
+	STATS_PHASE_EVALUATE,
+	STATS_PHASE_SEARCH,
+	STATS_PHASE_COUNT,
+};
+
+struct stats_thread_t {
+	struct stats_thread_t *next;
+	atomic_bool in_use;
+	atomic_uint_fast64_t counters[STATS_COUNTER_COUNT];
+	atomic_uint_fast64_t phase_ns[STATS_PHASE_COUNT];
+	enum stats_phase_t phase;
+	uint64_t phase_start;
+};
+
+struct stats_snapshot_t {
+	uint64_t counters[STATS_COUNTER_COUNT];
+	uint64_t phase_ns[STATS_PHASE_COUNT];
+	unsigned int thread_count;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+bool stats_enabled(void);
+struct stats_thread_t *stats_thread_register(void);
+void stats_collect(struct stats_snapshot_t *snapshot);
+void stats_write_json(FILE *f, const struct stats_snapshot_t *snapshot, double elapsed);
+bool stats_start_reporter(const char *filename, double interval);
+void stats_stop_reporter(void);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#ifdef ENABLE_STATS
+extern _Thread_local struct stats_thread_t *stats_thread;
+
+static inline struct stats_thread_t *stats_get_thread(void) {
+	return stats_thread ? stats_thread : stats_thread_register();
+}
+
+/* Single writer per block, so a relaxed load and store suffice */
+static inline void stats_add(atomic_uint_fast64_t *value, uint64_t increment) {
+	atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + increment, memory_order_relaxed);
+}
+
+static inline enum stats_phase_t stats_phase_switch(enum stats_phase_t phase) {
+	struct stats_thread_t *thread = stats_get_thread();
+	const uint64_t now = monotime_ns();
+	const enum stats_phase_t previous = thread->phase;
+	stats_add(&thread->phase_ns[previous], now - thread->phase_start);
+	thread->phase = phase;
+	thread->phase_start = now;
+	return previous;
+}
+
+#define STATS_ADD(counter, increment)	stats_add(&stats_get_thread()->counters[counter], (increment))
+#define STATS_INC(counter)				STATS_ADD(counter, 1)
+#define STATS_PHASE_ENTER(phase)		const enum stats_phase_t stats_previous_phase = stats_phase_switch(phase)
+#define STATS_PHASE_LEAVE()				stats_phase_switch(stats_previous_phase)
+#else
+#define STATS_ADD(counter, increment)	do { } while (0)
+#define STATS_INC(counter)				do { } while (0)
+#define STATS_PHASE_ENTER(phase)		do { } while (0)
+#define STATS_PHASE_LEAVE()				do { } while (0)
+#endif
+
+#endif
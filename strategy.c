@@ -23,7 +23,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <float.h>
 #include "strategy.h"
+#include "trace.h"
+#include "rng.h"
+#include "book.h"
+#include "search.h"
+#include "stats.h"
+#include "latency.h"
+#include "monotime.h"
 
 struct evaluated_action_t {
 	struct action_t action;
@@ -33,77 +41,201 @@ struct evaluated_action_t {
 struct action_callback_ctx_t {
 	const struct strategy_t *strategy;
 	unsigned int action_cnt;
+	unsigned int action_capacity;
 	struct evaluated_action_t *actions;
 };
 
-struct piece_distances_t {
-	int min_distance;
-	int sum_distance;
+struct quiescence_ctx_t {
+	const struct strategy_t *strategy;
+	unsigned int depth;
+	float alpha, beta;
+	float best_score;
 };
 
-static void game_evaluate_distances(struct piece_distances_t *distances, struct game_t *game, int target_row, enum side_t side) {
-	uint8_t player_piece = (side == TRENCH) ? PIECE_TRENCH : PIECE_CLIMB;
-	distances->sum_distance = 0;
-	distances->min_distance = 1000;
-	for (int i = 0; i < NUMBER_TILES(game->n); i++) {
-		if (game->board->tiles[i] == player_piece) {
-			int distance = target_row - game->canpos[i].row_number;
-			if (distance < 0) {
-				distance = -distance;
-			}
-			if (distance < distances->min_distance) {
-				distances->min_distance = distance;
-			}
-			distances->sum_distance += distance;
-		}
+struct random_action_ctx_t {
+	uint64_t *rng_state;
+	unsigned int action_cnt;
+	struct action_t action;
+};
+
+bool strategy_parse_distance_metric(const char *name, enum distance_metric_t *metric) {
+	if (!strcmp(name, "path")) {
+		*metric = DISTANCE_PATH;
+	} else if (!strcmp(name, "rows")) {
+		*metric = DISTANCE_ROWS;
+	} else if (!strcmp(name, "height")) {
+		*metric = DISTANCE_HEIGHT;
+	} else {
+		return false;
 	}
+	return true;
 }
 
-static float evaluate_board_side(struct game_t *game, const struct strategy_t *strategy, enum side_t side) {
-	float result = 0;
-	if (game_won_by(game, side)) {
-		result += strategy->winning_coefficient;
+bool strategy_parse_build_mode(const char *name, enum build_mode_t *mode) {
+	if (!strcmp(name, "all")) {
+		*mode = BUILDS_ALL;
+	} else if (!strcmp(name, "relevant")) {
+		*mode = BUILDS_RELEVANT;
+	} else {
+		return false;
 	}
+	return true;
+}
 
-	struct piece_distances_t distances;
-	int target_row = (side == TRENCH) ? 0 : ((game->n * 2) - 2);
-	game_evaluate_distances(&distances, game, target_row, side);
-	result -= strategy->min_distance_coefficient * distances.min_distance;
-	result -= strategy->sum_distance_coefficient * distances.sum_distance;
+/* Enumerates the actions the strategy considers */
+bool strategy_enumerate_actions(struct game_t *game, const struct strategy_t *strategy, bool (*enumeration_callback)(struct game_t *game, const struct action_t *action, void *vctx), void *vctx) {
+	STATS_PHASE_ENTER(STATS_PHASE_GENERATE);
+	bool completed;
+	if (strategy->build_mode == BUILDS_RELEVANT) {
+		completed = enumerate_relevant_actions(game, strategy->build_radius, enumeration_callback, vctx);
+	} else {
+		completed = enumerate_valid_actions(game, enumeration_callback, vctx);
+	}
+	STATS_PHASE_LEAVE();
+	return completed;
+}
 
-	/*
-	if (piece_threatened(game, side)) {
-		result += strategy->threat_coefficient;
+/* Evaluates the board from the view of the side whose turn it is */
+float strategy_evaluate(struct game_t *game, const struct strategy_t *strategy) {
+	STATS_PHASE_ENTER(STATS_PHASE_EVALUATE);
+	struct feature_vector_t features;
+	evaluation_extract_features(game, strategy->distance_metric, evaluation_feature_mask(&strategy->weights), &features);
+	float score = evaluation_dot(&strategy->weights, &features);
+	STATS_PHASE_LEAVE();
+	return score;
+}
+
+static float strategy_quiesce(struct game_t *game, const struct strategy_t *strategy, float alpha, float beta, unsigned int depth);
+
+static bool quiescence_callback(struct game_t *game, const struct move_t *move, void *vctx) {
+	struct quiescence_ctx_t *ctx = (struct quiescence_ctx_t*)vctx;
+	float score;
+	if (game_won_by(game, game->side_turn)) {
+		/* Captured the last enemy piece */
+		score = strategy_evaluate(game, ctx->strategy);
+	} else {
+		game_pass_turn(game);
+		score = -strategy_quiesce(game, ctx->strategy, -ctx->beta, -ctx->alpha, ctx->depth - 1);
+		game_pass_turn(game);
 	}
-	*/
-	return result;
+	if (score > ctx->best_score) {
+		ctx->best_score = score;
+	}
+	if (score > ctx->alpha) {
+		ctx->alpha = score;
+	}
+	return ctx->alpha < ctx->beta;
 }
 
-static float evaluate_board(struct game_t *game, const struct strategy_t *strategy) {
-	float our_goodness = evaluate_board_side(game, strategy, game->side_turn);
-	float enemy_goodness = evaluate_board_side(game, strategy, (game->side_turn == TRENCH) ? CLIMB : TRENCH);
-	return our_goodness - enemy_goodness;
+/* Capture-only negamax from the view of the side to move. Not capturing at
+ * all (standing pat) is always an option and bounds the score from below;
+ * the move that has to follow a capture is not considered. */
+static float strategy_quiesce(struct game_t *game, const struct strategy_t *strategy, float alpha, float beta, unsigned int depth) {
+	const float stand_pat = strategy_evaluate(game, strategy);
+	const enum side_t enemy = (game->side_turn == TRENCH) ? CLIMB : TRENCH;
+	if (!depth || (stand_pat >= beta) || !game_piece_threatened(game, enemy)) {
+		return stand_pat;
+	}
+	struct quiescence_ctx_t ctx = {
+		.strategy = strategy,
+		.depth = depth,
+		.alpha = (stand_pat > alpha) ? stand_pat : alpha,
+		.beta = beta,
+		.best_score = stand_pat,
+	};
+	enumerate_captures(game, quiescence_callback, &ctx);
+	return ctx.best_score;
+}
+
+/* Evaluates the board right after the side to move has applied an action,
+ * from the view of that side. With a quiescence depth, the capture sequences
+ * that the enemy could start are played out before evaluating. */
+float strategy_evaluate_after_action(struct game_t *game, const struct strategy_t *strategy) {
+	if (!strategy->quiescence_depth || game_won_by(game, game->side_turn)) {
+		return strategy_evaluate(game, strategy);
+	}
+	game_pass_turn(game);
+	float score = -strategy_quiesce(game, strategy, -FLT_MAX, FLT_MAX, strategy->quiescence_depth);
+	game_pass_turn(game);
+	return score;
 }
 
-static void enumeration_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+static bool enumeration_callback(struct game_t *game, const struct action_t *action, void *vctx) {
 	struct action_callback_ctx_t *ctx = (struct action_callback_ctx_t *)vctx;
-	ctx->actions = realloc(ctx->actions, sizeof(struct evaluated_action_t) * (ctx->action_cnt + 1));
+	if (ctx->action_cnt == ctx->action_capacity) {
+		ctx->action_capacity = ctx->action_capacity ? (2 * ctx->action_capacity) : 64;
+		ctx->actions = realloc(ctx->actions, sizeof(struct evaluated_action_t) * ctx->action_capacity);
+		if (!ctx->actions) {
+			fprintf(stderr, "fatal: cannot allocate %u evaluated actions.\n", ctx->action_capacity);
+			abort();
+		}
+		STATS_INC(STATS_ALLOCATIONS);
+	}
 	memcpy(&ctx->actions[ctx->action_cnt].action, action, sizeof(struct action_t));
-	ctx->actions[ctx->action_cnt].goodness = evaluate_board(game, ctx->strategy);
+	ctx->actions[ctx->action_cnt].goodness = strategy_evaluate_after_action(game, ctx->strategy);
 	ctx->action_cnt += 1;
+	return true;
+}
+
+static bool strategy_perform_book_move(struct game_t *game, const struct strategy_t *strategy, struct action_t *performed_action) {
+	struct action_t action;
+	if (!strategy->book || !book_lookup(strategy->book, game, &action)) {
+		return false;
+	}
+	enum side_t side = game->side_turn;
+	game_perform_action(game, &action);
+	trace_action(game, side, &action);
+	if (performed_action) {
+		*performed_action = action;
+	}
+	return true;
 }
 
-void strategy_perform_move(struct game_t *game, const struct strategy_t *strategy) {
+static bool strategy_perform_timed_move(struct game_t *game, const struct strategy_t *strategy, struct action_t *performed_action) {
+	if (!strategy->move_time && !strategy->move_nodes) {
+		return false;
+	}
+	const struct search_params_t params = {
+		.strategy = strategy,
+		.depth = strategy->search_depth,
+		.iterative = true,
+		.node_budget = strategy->move_nodes,
+		.time_budget = strategy->move_time,
+		.stop = strategy->stop,
+		.ttable = strategy->ttable,
+	};
+	struct search_result_t result;
+	if (!search_best_action(game, &params, &result)) {
+		return false;
+	}
+	enum side_t side = game->side_turn;
+	game_perform_action(game, &result.best_action);
+	trace_action(game, side, &result.best_action);
+	if (performed_action) {
+		*performed_action = result.best_action;
+	}
+	return true;
+}
+
+/* Returns false and leaves the game untouched when the side to move has no
+ * legal action. */
+bool strategy_perform_move(struct game_t *game, const struct strategy_t *strategy, struct action_t *performed_action) {
+	STATS_INC(STATS_TURNS);
+	if (strategy_perform_book_move(game, strategy, performed_action)) {
+		return true;
+	}
+	if (strategy_perform_timed_move(game, strategy, performed_action)) {
+		return true;
+	}
+
 	struct action_callback_ctx_t ctx = {
 		.strategy = strategy,
 		.action_cnt = 0,
 		.actions = NULL,
 	};
-	enumerate_valid_actions(game, enumeration_callback, &ctx);
-
+	strategy_enumerate_actions(game, strategy, enumeration_callback, &ctx);
 	if (ctx.action_cnt == 0) {
-		fprintf(stderr, "fatal: no valid actions enumeratable!\n");
-		abort();
+		return false;
 	}
 
 	float max_goodness = ctx.actions[0].goodness;
@@ -117,26 +249,113 @@ void strategy_perform_move(struct game_t *game, const struct strategy_t *strateg
 //		printf("option %d: %f\n", i, ctx.actions[i].goodness);
 	}
 //	dump_action(&ctx.actions[preferred_option]);
+	enum side_t side = game->side_turn;
 	game_perform_action(game, &ctx.actions[preferred_option].action);
-	board_dump(game->board);
-	printf("\n");
+	trace_action(game, side, &ctx.actions[preferred_option].action);
+	if (performed_action) {
+		*performed_action = ctx.actions[preferred_option].action;
+	}
 	free(ctx.actions);
+	return true;
+}
+
+static bool random_enumeration_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	/* Reservoir sampling with a reservoir size of one */
+	struct random_action_ctx_t *ctx = (struct random_action_ctx_t*)vctx;
+	ctx->action_cnt++;
+	if (rng_below(ctx->rng_state, ctx->action_cnt) == 0) {
+		ctx->action = *action;
+	}
+	return true;
+}
+
+/* Like strategy_perform_move, returns false if there is no legal action */
+bool strategy_perform_random_move(struct game_t *game, uint64_t *rng_state, struct action_t *performed_action) {
+	struct random_action_ctx_t ctx = {
+		.rng_state = rng_state,
+	};
+	enumerate_valid_actions(game, random_enumeration_callback, &ctx);
+	if (ctx.action_cnt == 0) {
+		return false;
+	}
+
+	enum side_t side = game->side_turn;
+	game_perform_action(game, &ctx.action);
+	trace_action(game, side, &ctx.action);
+	if (performed_action) {
+		*performed_action = ctx.action;
+	}
+	return true;
 }
 
-bool strategy_play_out(struct game_t *game, const struct strategy_t *our_strategy, const struct strategy_t *their_strategy) {
-	enum side_t us = game->side_turn;
-	enum side_t them = (us == TRENCH) ? CLIMB : TRENCH;
-	while (true) {
-		/* Our turn */
-		strategy_perform_move(game, our_strategy);
-		if (game_won_by(game, us)) {
+static bool playout_drawn(const struct playout_params_t *params, const struct history_t *history) {
+	if (params->max_plies && (history->length > params->max_plies)) {
+		return true;
+	}
+	if (params->repetition_count) {
+		uint64_t current_hash = history->entries[history->length - 1].hash;
+		if (history_occurrences(history, current_hash) >= params->repetition_count) {
 			return true;
 		}
+	}
+	return false;
+}
+
+static void playout_record(struct history_t *history, struct game_t *game, const struct action_t *action) {
+	if (!history_push(history, game->hash, action)) {
+		fprintf(stderr, "fatal: out of memory while recording game history.\n");
+		abort();
+	}
+}
+
+enum game_result_t strategy_play_out(struct game_t *game, const struct strategy_t *our_strategy, const struct strategy_t *their_strategy, const struct playout_params_t *params, struct history_t *history) {
+	const enum side_t us = game->side_turn;
+	const struct strategy_t *strategies[2] = { our_strategy, their_strategy };
+	uint64_t rng_state = params->seed;
+	struct history_t *own_history = NULL;
+	if (!history) {
+		own_history = history_init(params->max_plies + 1);
+		if (!own_history) {
+			fprintf(stderr, "fatal: cannot allocate play-out history.\n");
+			abort();
+		}
+		history = own_history;
+	}
+	history_clear(history);
+	playout_record(history, game, NULL);
+	trace_game_start(game);
 
-		/* Their turn */
-		strategy_perform_move(game, their_strategy);
-		if (game_won_by(game, them)) {
-			return false;
+	enum game_result_t result;
+	for (unsigned int ply = 0; ; ply++) {
+		const enum side_t mover = game->side_turn;
+		struct action_t action;
+		bool acted;
+		if (ply < params->random_plies) {
+			acted = strategy_perform_random_move(game, &rng_state, &action);
+		} else if (params->latency) {
+			const unsigned int action_count = game_count_actions(game, mover);
+			const uint64_t t0 = monotime_ns();
+			acted = strategy_perform_move(game, strategies[ply % 2], &action);
+			latency_record(params->latency, ply, action_count, monotime_ns() - t0);
+		} else {
+			acted = strategy_perform_move(game, strategies[ply % 2], &action);
+		}
+		if (!acted) {
+			/* The side to move is stuck; like the solver, count it as a draw */
+			result = RESULT_DRAW;
+			break;
+		}
+		playout_record(history, game, &action);
+		if (game_won_by(game, mover)) {
+			result = (mover == us) ? RESULT_WIN : RESULT_LOSS;
+			break;
+		}
+		if (playout_drawn(params, history)) {
+			result = RESULT_DRAW;
+			break;
 		}
 	}
+	trace_game_end(result);
+	history_free(own_history);
+	return result;
 }
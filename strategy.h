@@ -24,17 +24,80 @@
 #define __STRATEGY_H__
 
 #include "game.h"
+#include "history.h"
+#include "evaluation.h"
+#include <stdatomic.h>
+
+struct book_t;
+struct ttable_t;
+struct latency_t;
+
+enum build_mode_t {
+	BUILDS_ALL,
+	BUILDS_RELEVANT,
+};
 
 struct strategy_t {
-	float winning_coefficient;
-	float threat_coefficient;
-	float min_distance_coefficient;
-	float sum_distance_coefficient;
+	/* Weights of the linear evaluation, see evaluation.h */
+	struct feature_vector_t weights;
+	enum distance_metric_t distance_metric;
+
+	/* Which builds are considered, see enumerate_relevant_actions */
+	enum build_mode_t build_mode;
+	unsigned int build_radius;
+
+	/* Maximum number of captures resolved before evaluating, zero disables
+	 * the quiescence extension */
+	unsigned int quiescence_depth;
+
+	/* Time management: when a time (in seconds) or node budget per move is
+	 * given, moves are chosen by an iterative deepening search up to
+	 * search_depth plies (zero meaning no limit) instead of greedily. The
+	 * best action found so far is played once the budget is used up or
+	 * *stop (if not NULL) gets set. */
+	double move_time;
+	uint64_t move_nodes;
+	unsigned int search_depth;
+	atomic_bool *stop;
+
+	/* Transposition table for those searches, may be NULL. Its scores
+	 * depend on the weights, so strategies that evaluate differently must
+	 * not share one. */
+	struct ttable_t *ttable;
+
+	/* Opening book that is consulted before searching, may be NULL */
+	const struct book_t *book;
+};
+
+enum game_result_t {
+	RESULT_WIN,
+	RESULT_LOSS,
+	RESULT_DRAW,
+};
+
+/* Draw adjudication for self-play. A value of zero disables the respective
+ * limit. The first random_plies plies are played uniformly at random
+ * (seeded by seed) so that deterministic strategies produce distinct games.
+ * A side that has no legal action on its turn draws the game. */
+struct playout_params_t {
+	unsigned int max_plies;
+	unsigned int repetition_count;
+	unsigned int random_plies;
+	uint64_t seed;
+	/* When set, the wall-clock time of every strategy decision is recorded
+	 * here; only one thread may play out with a given latency_t. */
+	struct latency_t *latency;
 };
 
 /*************** AUTO GENERATED SECTION FOLLOWS ***************/
-void strategy_perform_move(struct game_t *game, const struct strategy_t *strategy);
-bool strategy_play_out(struct game_t *game, const struct strategy_t *our_strategy, const struct strategy_t *their_strategy);
+bool strategy_parse_distance_metric(const char *name, enum distance_metric_t *metric);
+bool strategy_parse_build_mode(const char *name, enum build_mode_t *mode);
+bool strategy_enumerate_actions(struct game_t *game, const struct strategy_t *strategy, bool (*enumeration_callback)(struct game_t *game, const struct action_t *action, void *vctx), void *vctx);
+float strategy_evaluate(struct game_t *game, const struct strategy_t *strategy);
+float strategy_evaluate_after_action(struct game_t *game, const struct strategy_t *strategy);
+bool strategy_perform_move(struct game_t *game, const struct strategy_t *strategy, struct action_t *performed_action);
+bool strategy_perform_random_move(struct game_t *game, uint64_t *rng_state, struct action_t *performed_action);
+enum game_result_t strategy_play_out(struct game_t *game, const struct strategy_t *our_strategy, const struct strategy_t *their_strategy, const struct playout_params_t *params, struct history_t *history);
 /***************  AUTO GENERATED SECTION ENDS   ***************/
 
 #endif
@@ -0,0 +1,142 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <strategy.h>
+#include <search.h>
+#include <book.h>
+
+static void test_book_round_trip(void) {
+	subtest_start();
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+
+	char filename[] = "/tmp/test_book_XXXXXX";
+	int fd = mkstemp(filename);
+	test_assert(fd != -1);
+	close(fd);
+
+	const struct book_build_params_t params = {
+		.n = 3,
+		.strategy = &strategy,
+		.book_depth = 2,
+		.width = 2,
+		.search_depth = 1,
+		.thread_count = 2,
+		.output_filename = filename,
+	};
+	test_assert(book_build(&params));
+	struct book_t *book = book_open(filename);
+	test_assert(book);
+	abort_subtest_if_assertion_failure("book could not be opened\n");
+
+	/* The start plus at most width + 1 distinct successors */
+	test_assert(book->header->n == 3);
+	test_assert(book->header->entry_count >= 2);
+	test_assert(book->header->entry_count <= 4);
+	for (unsigned int i = 1; i < book->header->entry_count; i++) {
+		test_assert(book->entries[i - 1].hash < book->entries[i].hash);
+	}
+
+	/* The book move at the start is what the search found */
+	struct game_t *game = game_init(3);
+	const struct search_params_t search_params = {
+		.strategy = &strategy,
+		.depth = 1,
+	};
+	struct search_result_t result;
+	test_assert(search_best_action(game, &search_params, &result));
+	struct action_t action;
+	test_assert(book_lookup(book, game, &action));
+	test_assert(game_pack_action(&action) == game_pack_action(&result.best_action));
+
+	/* The searched action is always expanded, but the level after is not */
+	game_make_action(game, &action);
+	test_assert(book_lookup(book, game, &action));
+	game_make_action(game, &action);
+	test_assert(!book_lookup(book, game, &action));
+	game_free(game);
+
+	/* A book is only valid for its board size */
+	game = game_init(4);
+	test_assert(!book_lookup(book, game, &action));
+	game_free(game);
+
+	book_close(book);
+	unlink(filename);
+	subtest_finished();
+}
+
+static void test_book_corrupt_action(void) {
+	subtest_start();
+	char filename[] = "/tmp/test_book_XXXXXX";
+	int fd = mkstemp(filename);
+	test_assert(fd != -1);
+	close(fd);
+
+	/* A book whose only entry for the start position moves from a tile off
+	 * the board, then one with two builds */
+	struct game_t *game = game_init(3);
+	const struct action_t bad_actions[] = {
+		{ .moves = { { .type = BUILD, .src_tile = 0, .dst_tile = 1 }, { .type = MOVE, .src_tile = 0x7f, .dst_tile = 0x7e } } },
+		{ .moves = { { .type = BUILD, .src_tile = 0, .dst_tile = 1 }, { .type = BUILD, .src_tile = 2, .dst_tile = 3 } } },
+	};
+	for (unsigned int i = 0; i < sizeof(bad_actions) / sizeof(bad_actions[0]); i++) {
+		const struct book_header_t header = {
+			.magic = BOOK_MAGIC,
+			.version = BOOK_VERSION,
+			.n = 3,
+			.entry_count = 1,
+		};
+		const struct book_entry_t entry = {
+			.hash = game->hash,
+			.action = game_pack_action(&bad_actions[i]),
+		};
+		FILE *f = fopen(filename, "wb");
+		test_assert(f);
+		abort_subtest_if_assertion_failure("book could not be written\n");
+		test_assert(fwrite(&header, sizeof(header), 1, f) == 1);
+		test_assert(fwrite(&entry, sizeof(entry), 1, f) == 1);
+		fclose(f);
+
+		struct book_t *book = book_open(filename);
+		test_assert(book);
+		abort_subtest_if_assertion_failure("book could not be opened\n");
+		struct action_t action;
+		test_assert(!book_lookup(book, game, &action));
+		book_close(book);
+	}
+	game_free(game);
+	unlink(filename);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_book_round_trip();
+	test_book_corrupt_action();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,83 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <string.h>
+#include <distance.h>
+
+static void test_goal_table(void) {
+	subtest_start();
+	for (uint8_t n = 2; n <= 5; n++) {
+		struct game_t *game = game_init(n);
+		for (int i = 0; i < NUMBER_TILES(n); i++) {
+			/* Without teleport shortcuts, steps equal the row difference */
+			test_assert(game->goal_distances[TRENCH][i] <= game->canpos[i].row_number);
+			test_assert(game->goal_distances[CLIMB][i] <= (2 * n) - 2 - game->canpos[i].row_number);
+			test_assert((game->goal_distances[TRENCH][i] == 0) == !!(game->canpos[i].loc_flags & CANONICAL_LOCFLAG_CLIMB_BASE));
+		}
+		game_free(game);
+	}
+	subtest_finished();
+}
+
+static void test_height_table(void) {
+	subtest_start();
+	struct game_t *game = game_init(4);
+	const unsigned int tile_count = NUMBER_TILES(4);
+	uint8_t distances[tile_count];
+
+	/* On a flat trench-level board, heights never get in the way */
+	uint8_t tiles[tile_count];
+	memset(tiles, EMPTY_TRENCH, tile_count);
+	game_set_position(game, tiles, TRENCH);
+	distance_height_table(game, TRENCH, distances, DISTANCE_MAX_BOUND);
+	test_assert(!memcmp(distances, game->goal_distances[TRENCH], tile_count));
+
+	/* Climbers need two builds per tile on top of every move */
+	distance_height_table(game, CLIMB, distances, DISTANCE_MAX_BOUND);
+	for (unsigned int i = 0; i < tile_count; i++) {
+		test_assert_int_eq(distances[i], 3 * game->goal_distances[CLIMB][i]);
+	}
+
+	/* Costs beyond the bound are capped */
+	distance_height_table(game, CLIMB, distances, 4);
+	for (unsigned int i = 0; i < tile_count; i++) {
+		test_assert(distances[i] <= 4);
+	}
+
+	/* From the starting position, occupied and neutral tiles cost extra */
+	game_reset(game);
+	distance_height_table(game, TRENCH, distances, DISTANCE_MAX_BOUND);
+	for (unsigned int i = 0; i < tile_count; i++) {
+		test_assert(distances[i] > game->goal_distances[TRENCH][i] || (distances[i] == 0));
+	}
+	game_free(game);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_goal_table();
+	test_height_table();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,155 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <engine.h>
+#include <notation.h>
+
+static bool count_leaf_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	(*(uint64_t*)vctx)++;
+	return true;
+}
+
+static bool leaf_parent_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	if (!game_won_by(game, game->side_turn)) {
+		game_pass_turn(game);
+		enumerate_valid_actions(game, count_leaf_callback, vctx);
+		game_pass_turn(game);
+	}
+	return true;
+}
+
+static bool roundtrip_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	bool *consistent = (bool*)vctx;
+	char action_str[ACTION_STRING_MAXLEN];
+	struct action_t parsed;
+	action_to_string(action_str, sizeof(action_str), action);
+	if (!action_from_string(action_str, &parsed) || (game_pack_action(&parsed) != game_pack_action(action))) {
+		*consistent = false;
+	}
+	return true;
+}
+
+static void test_notation_roundtrip(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	bool consistent = true;
+	enumerate_valid_actions(game, roundtrip_callback, &consistent);
+	test_assert(consistent);
+
+	struct action_t action;
+	test_assert(action_from_string("C12,B3-4", &action));
+	test_assert_int_eq(action.moves[0].type, CAPTURE);
+	test_assert_int_eq(action.moves[0].dst_tile, 12);
+	test_assert_int_eq(action.moves[1].type, BUILD);
+	test_assert(!action_from_string("B3-4", &action));
+	test_assert(!action_from_string("B3-4,M1", &action));
+	test_assert(!action_from_string("B3-4x,M1-2", &action));
+	test_assert(!action_from_string("X1-2,M1-2", &action));
+
+	char position_str[POSITION_STRING_MAXLEN(3)];
+	uint8_t tiles[NUMBER_TILES(3)];
+	position_to_string(position_str, game);
+	test_assert(position_from_string(position_str, 3, tiles));
+	test_assert(!memcmp(tiles, game->board->tiles, NUMBER_TILES(3)));
+	test_assert(!position_from_string(position_str, 4, tiles));
+	position_str[0] = 'x';
+	test_assert(!position_from_string(position_str, 3, tiles));
+	game_free(game);
+	subtest_finished();
+}
+
+static void test_perft(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	test_assert_int_eq(engine_perft(game, 0), 1);
+
+	/* Depth two counts the leaves of a full two ply enumeration */
+	uint64_t leaves = 0;
+	enumerate_valid_actions(game, leaf_parent_callback, &leaves);
+	test_assert(leaves > 0);
+	test_assert(engine_perft(game, 2) == leaves);
+
+	/* Enumeration leaves the position untouched */
+	uint64_t hash = game->hash;
+	engine_perft(game, 3);
+	test_assert(game->hash == hash);
+	game_free(game);
+	subtest_finished();
+}
+
+static void test_protocol(void) {
+	subtest_start();
+	const char *script =
+		"# comment\n"
+		"\n"
+		"show\n"
+		"apply B4-5,M0-5\n"
+		"apply B4-5,M0-5\n"
+		"perft 1\n"
+		"search depth 1\n"
+		"bogus\n"
+		"position 111 trench\n"
+		"new\n"
+		"quit\n"
+		"show\n";
+	char *output = NULL;
+	size_t output_size = 0;
+	FILE *in = fmemopen((void*)script, strlen(script), "r");
+	FILE *out = open_memstream(&output, &output_size);
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+	struct engine_params_t params = {
+		.n = 4,
+		.strategy = &strategy,
+		.search_depth = 1,
+	};
+	test_assert(engine_run(&params, in, out));
+	fclose(in);
+	fclose(out);
+
+	/* Every command is answered, nothing after quit */
+	unsigned int answers = 0;
+	for (const char *line = output; line && *line; line = strchr(line, '\n') + 1) {
+		answers += !strncmp(line, "ok\n", 3) || !strncmp(line, "error ", 6);
+	}
+	test_assert_int_eq(answers, 9);
+	test_assert(strstr(output, "position CCCC") == output);
+	test_assert(strstr(output, "error illegal action\n") != NULL);
+	test_assert(strstr(output, "error unknown command\n") != NULL);
+	test_assert(strstr(output, "error invalid position\n") != NULL);
+	test_assert(strstr(output, "\nbestaction ") != NULL);
+	free(output);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_notation_roundtrip();
+	test_perft();
+	test_protocol();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,178 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <evaluation.h>
+#include <rng.h>
+
+static bool write_file(const char *filename, const char *content) {
+	FILE *f = fopen(filename, "w");
+	if (!f) {
+		return false;
+	}
+	fputs(content, f);
+	fclose(f);
+	return true;
+}
+
+static void test_dot_product(void) {
+	subtest_start();
+	struct feature_vector_t weights, features;
+	float expected = 0;
+	for (int i = 0; i < FEATURE_COUNT; i++) {
+		weights.values[i] = i - 5;
+		features.values[i] = 2 * i + 1;
+		expected += weights.values[i] * features.values[i];
+	}
+	test_assert(evaluation_dot(&weights, &features) == expected);
+	subtest_finished();
+}
+
+static void test_extract_symmetric(void) {
+	subtest_start();
+	struct game_t *game = game_init(4);
+	struct feature_vector_t trench, climb;
+	evaluation_extract_features(game, DISTANCE_PATH, FEATURE_MASK_ALL, &trench);
+	game_pass_turn(game);
+	evaluation_extract_features(game, DISTANCE_PATH, FEATURE_MASK_ALL, &climb);
+	for (int i = 0; i < FEATURE_COUNT; i++) {
+		test_assert(trench.values[i] == -climb.values[i]);
+	}
+
+	/* The starting position is symmetric for both sides */
+	for (int i = 0; i < FEATURE_COUNT; i++) {
+		test_assert(trench.values[i] == 0);
+	}
+	game_free(game);
+	subtest_finished();
+}
+
+struct pick_ctx_t {
+	uint64_t rng_state;
+	unsigned int count;
+	struct action_t action;
+};
+
+static bool pick_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct pick_ctx_t *ctx = (struct pick_ctx_t*)vctx;
+	ctx->count++;
+	if (rng_below(&ctx->rng_state, ctx->count) == 0) {
+		ctx->action = *action;
+	}
+	return true;
+}
+
+static void test_feature_mask(void) {
+	subtest_start();
+	struct feature_vector_t weights;
+	evaluation_default_weights(&weights);
+	test_assert(evaluation_feature_mask(&weights) == (FEATURE_BIT(FEATURE_WON) | FEATURE_BIT(FEATURE_MIN_DISTANCE) | FEATURE_BIT(FEATURE_SUM_DISTANCE)));
+
+	/* Leaving out features never changes the evaluation, only the features
+	 * that do not contribute to it */
+	struct game_t *game = game_init(4);
+	struct pick_ctx_t ctx = {
+		.rng_state = 42,
+	};
+	for (int ply = 0; ply < 200; ply++) {
+		if (game_won_by(game, TRENCH) || game_won_by(game, CLIMB)) {
+			game_reset(game);
+		}
+		for (int metric = DISTANCE_PATH; metric <= DISTANCE_HEIGHT; metric++) {
+			struct feature_vector_t all, masked;
+			evaluation_extract_features(game, metric, FEATURE_MASK_ALL, &all);
+			evaluation_extract_features(game, metric, evaluation_feature_mask(&weights), &masked);
+			test_assert(evaluation_dot(&weights, &all) == evaluation_dot(&weights, &masked));
+			for (int i = FEATURE_MIN_DISTANCE; i < FEATURE_USED_COUNT; i++) {
+				if ((i != FEATURE_PIECES) && !(evaluation_feature_mask(&weights) & FEATURE_BIT(i))) {
+					test_assert(masked.values[i] == 0);
+				}
+			}
+		}
+		ctx.count = 0;
+		enumerate_valid_actions(game, pick_callback, &ctx);
+		game_perform_action(game, &ctx.action);
+	}
+	game_free(game);
+	subtest_finished();
+}
+
+static void test_load_weights(void) {
+	subtest_start();
+	char filename[] = "/tmp/test_evaluation_XXXXXX";
+	int fd = mkstemp(filename);
+	test_assert(fd != -1);
+	close(fd);
+
+	struct feature_vector_t weights;
+	test_assert(write_file(filename, "# Weights\nwon 500\n\n  min_distance -2.5   # comment\n"));
+	test_assert(evaluation_load_weights(filename, &weights));
+	test_assert(weights.values[FEATURE_WON] == 500);
+	test_assert(weights.values[FEATURE_MIN_DISTANCE] == -2.5);
+	test_assert(weights.values[FEATURE_SUM_DISTANCE] == 0);
+
+	test_assert(write_file(filename, "won 500\nfoo 3\n"));
+	test_assert(!evaluation_load_weights(filename, &weights));
+	test_assert(write_file(filename, "won 500 3\n"));
+	test_assert(!evaluation_load_weights(filename, &weights));
+	test_assert(write_file(filename, "won\n"));
+	test_assert(!evaluation_load_weights(filename, &weights));
+
+	unlink(filename);
+	subtest_finished();
+}
+
+static void test_save_weights(void) {
+	subtest_start();
+	char filename[] = "/tmp/test_evaluation_XXXXXX";
+	int fd = mkstemp(filename);
+	test_assert(fd != -1);
+	close(fd);
+
+	struct feature_vector_t weights, loaded;
+	evaluation_default_weights(&weights);
+	weights.values[FEATURE_MOBILITY] = 0.123456789;
+	test_assert(evaluation_save_weights(filename, &weights));
+	test_assert(evaluation_load_weights(filename, &loaded));
+	test_assert(memcmp(&weights, &loaded, sizeof(weights)) == 0);
+
+	enum feature_t feature;
+	test_assert(evaluation_lookup_feature("sum_distance", &feature));
+	test_assert(feature == FEATURE_SUM_DISTANCE);
+	test_assert(!evaluation_lookup_feature("foo", &feature));
+
+	unlink(filename);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_dot_product();
+	test_extract_symmetric();
+	test_feature_mask();
+	test_load_weights();
+	test_save_weights();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,435 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <stdlib.h>
+#include <string.h>
+#include <game.h>
+#include <rng.h>
+
+struct random_walk_ctx_t {
+	uint64_t rng_state;
+	unsigned int action_cnt;
+	unsigned int capture_cnt;
+	bool consistent;
+	struct action_t action;
+};
+
+/* Recounts attacks from scratch and compares against what the game maintains */
+static bool attacks_consistent(const struct game_t *game) {
+	unsigned int threatened[2] = { 0 };
+	for (int i = 0; i < NUMBER_TILES(game->n); i++) {
+		unsigned int attacks[2] = { 0 };
+		for (int j = 0; j < game->canpos[i].adjacent_count; j++) {
+			uint8_t adjacent = game->board->tiles[game->canpos[i].adjacent_tiles[j]];
+			attacks[TRENCH] += (adjacent == PIECE_TRENCH);
+			attacks[CLIMB] += (adjacent == PIECE_CLIMB);
+		}
+		if ((game->attack_counts[TRENCH][i] != attacks[TRENCH]) || (game->attack_counts[CLIMB][i] != attacks[CLIMB])) {
+			return false;
+		}
+		threatened[TRENCH] += (game->board->tiles[i] == PIECE_TRENCH) && (attacks[CLIMB] >= 2);
+		threatened[CLIMB] += (game->board->tiles[i] == PIECE_CLIMB) && (attacks[TRENCH] >= 2);
+	}
+	return (game->threatened_counts[TRENCH] == threatened[TRENCH]) && (game->threatened_counts[CLIMB] == threatened[CLIMB]);
+}
+
+static bool random_walk_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct random_walk_ctx_t *ctx = (struct random_walk_ctx_t*)vctx;
+	if (!attacks_consistent(game)) {
+		ctx->consistent = false;
+	}
+	ctx->action_cnt++;
+	if (rng_below(&ctx->rng_state, ctx->action_cnt) == 0) {
+		ctx->action = *action;
+	}
+	return true;
+}
+
+static void test_attack_counts(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	test_assert(attacks_consistent(game));
+	struct random_walk_ctx_t ctx = {
+		.rng_state = 1234,
+		.consistent = true,
+	};
+	for (int ply = 0; ply < 400; ply++) {
+		if (game_won_by(game, TRENCH) || game_won_by(game, CLIMB)) {
+			game_reset(game);
+		}
+		ctx.action_cnt = 0;
+		enumerate_valid_actions(game, random_walk_callback, &ctx);
+		test_assert(ctx.consistent);
+		test_assert(attacks_consistent(game));
+		test_assert(ctx.action_cnt > 0);
+		ctx.capture_cnt += (ctx.action.moves[0].type == CAPTURE) || (ctx.action.moves[1].type == CAPTURE);
+		game_perform_action(game, &ctx.action);
+		test_assert(attacks_consistent(game));
+	}
+
+	/* Make sure the walk actually exercised captures */
+	test_assert(ctx.capture_cnt > 0);
+	game_free(game);
+	subtest_finished();
+}
+
+static void test_make_unmake(void) {
+	subtest_start();
+	const unsigned int max_plies = 300;
+	struct game_t *game = game_init(3);
+	uint8_t (*tiles)[NUMBER_TILES(3)] = calloc(max_plies, NUMBER_TILES(3));
+	uint64_t *hashes = calloc(max_plies, sizeof(uint64_t));
+	struct random_walk_ctx_t ctx = {
+		.rng_state = 5678,
+		.consistent = true,
+	};
+
+	/* Walk until the game ends, then take everything back */
+	unsigned int plies;
+	for (plies = 0; plies < max_plies; plies++) {
+		if (game_won_by(game, TRENCH) || game_won_by(game, CLIMB)) {
+			break;
+		}
+		memcpy(tiles[plies], game->board->tiles, NUMBER_TILES(3));
+		hashes[plies] = game->hash;
+		ctx.action_cnt = 0;
+		enumerate_valid_actions(game, random_walk_callback, &ctx);
+		ctx.capture_cnt += (ctx.action.moves[0].type == CAPTURE) || (ctx.action.moves[1].type == CAPTURE);
+		game_make_action(game, &ctx.action);
+	}
+	test_assert(plies > 10);
+	test_assert_int_eq(game->undo_depth, plies);
+	while (plies--) {
+		game_unmake_action(game);
+		test_assert(game->hash == hashes[plies]);
+		test_assert(game->hash == game_compute_hash(game));
+		test_assert(!memcmp(game->board->tiles, tiles[plies], NUMBER_TILES(3)));
+		test_assert_int_eq(game->side_turn, (plies % 2) ? TRENCH : CLIMB);
+		test_assert(attacks_consistent(game));
+	}
+	test_assert_int_eq(game->undo_depth, 0);
+
+	/* Setting up a position forgets what could be undone */
+	ctx.action_cnt = 0;
+	enumerate_valid_actions(game, random_walk_callback, &ctx);
+	game_make_action(game, &ctx.action);
+	game_reset(game);
+	test_assert_int_eq(game->undo_depth, 0);
+	free(hashes);
+	free(tiles);
+	game_free(game);
+	subtest_finished();
+}
+
+static bool count_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	unsigned int *count = (unsigned int*)vctx;
+	(*count)++;
+	return true;
+}
+
+static void test_count_actions(void) {
+	subtest_start();
+	for (uint8_t n = 3; n <= 4; n++) {
+		struct game_t *game = game_init(n);
+		struct random_walk_ctx_t ctx = {
+			.rng_state = n,
+			.consistent = true,
+		};
+		for (int ply = 0; ply < 300; ply++) {
+			if (game_won_by(game, TRENCH) || game_won_by(game, CLIMB)) {
+				game_reset(game);
+			}
+			ctx.action_cnt = 0;
+			enumerate_valid_actions(game, random_walk_callback, &ctx);
+			test_assert_int_eq(game_count_actions(game, game->side_turn), ctx.action_cnt);
+
+			/* Also count for the side that is not to move */
+			unsigned int enemy_count = 0;
+			game_pass_turn(game);
+			enumerate_valid_actions(game, count_callback, &enemy_count);
+			game_pass_turn(game);
+			test_assert_int_eq(game_count_actions(game, (game->side_turn == TRENCH) ? CLIMB : TRENCH), enemy_count);
+
+			game_perform_action(game, &ctx.action);
+		}
+		game_free(game);
+	}
+	subtest_finished();
+}
+
+struct packed_actions_t {
+	unsigned int action_cnt;
+	unsigned int non_build_cnt;
+	uint32_t actions[65536];
+};
+
+static bool pack_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct packed_actions_t *ctx = (struct packed_actions_t*)vctx;
+	ctx->actions[ctx->action_cnt++] = game_pack_action(action);
+	ctx->non_build_cnt += (action->moves[0].type != BUILD) && (action->moves[1].type != BUILD);
+	return true;
+}
+
+static int compare_packed(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+}
+
+static void test_relevant_actions(void) {
+	subtest_start();
+	struct game_t *game = game_init(4);
+	struct packed_actions_t *full = malloc(sizeof(struct packed_actions_t));
+	struct packed_actions_t *pruned = malloc(sizeof(struct packed_actions_t));
+	struct random_walk_ctx_t walk = {
+		.rng_state = 99,
+		.consistent = true,
+	};
+	for (int ply = 0; ply < 100; ply++) {
+		if (game_won_by(game, TRENCH) || game_won_by(game, CLIMB)) {
+			game_reset(game);
+		}
+		test_assert(game_count_actions(game, game->side_turn) <= sizeof(full->actions) / sizeof(uint32_t));
+		full->action_cnt = full->non_build_cnt = 0;
+		enumerate_valid_actions(game, pack_callback, full);
+		qsort(full->actions, full->action_cnt, sizeof(uint32_t), compare_packed);
+
+		/* Pruned actions are a non-empty subset of all actions */
+		pruned->action_cnt = pruned->non_build_cnt = 0;
+		enumerate_relevant_actions(game, 1, pack_callback, pruned);
+		test_assert(pruned->action_cnt > 0);
+		test_assert(pruned->action_cnt <= full->action_cnt);
+		for (unsigned int i = 0; i < pruned->action_cnt; i++) {
+			test_assert(bsearch(&pruned->actions[i], full->actions, full->action_cnt, sizeof(uint32_t), compare_packed) != NULL);
+		}
+
+		/* Captures followed by moves are never pruned */
+		test_assert_int_eq(pruned->non_build_cnt, full->non_build_cnt);
+
+		/* When every tile is relevant, nothing is pruned */
+		struct prune_stats_t before = game->prune_stats;
+		pruned->action_cnt = pruned->non_build_cnt = 0;
+		enumerate_relevant_actions(game, 2 * game->n, pack_callback, pruned);
+		test_assert_int_eq(pruned->action_cnt, full->action_cnt);
+		test_assert(game->prune_stats.builds_kept - before.builds_kept == game->prune_stats.builds_total - before.builds_total);
+
+		walk.action_cnt = 0;
+		enumerate_valid_actions(game, random_walk_callback, &walk);
+		game_perform_action(game, &walk.action);
+	}
+	test_assert(game->prune_stats.nodes == 200);
+	test_assert(game->prune_stats.builds_kept < game->prune_stats.builds_total);
+	free(pruned);
+	free(full);
+	game_free(game);
+	subtest_finished();
+}
+
+static void test_piece_threatened(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	uint8_t tiles[NUMBER_TILES(3)];
+	memset(tiles, EMPTY_NEUTRAL, sizeof(tiles));
+
+	/* A trench piece in the center with two climb pieces next to it */
+	const unsigned int center = NUMBER_TILES(3) / 2;
+	tiles[center] = PIECE_TRENCH;
+	tiles[game->canpos[center].adjacent_tiles[0]] = PIECE_CLIMB;
+	game_set_position(game, tiles, CLIMB);
+	test_assert(!game_piece_threatened(game, TRENCH));
+	test_assert(!game_piece_threatened(game, CLIMB));
+
+	tiles[game->canpos[center].adjacent_tiles[1]] = PIECE_CLIMB;
+	game_set_position(game, tiles, CLIMB);
+	test_assert(game_piece_threatened(game, TRENCH));
+	test_assert(!game_piece_threatened(game, CLIMB));
+	test_assert_int_eq(game->threatened_counts[TRENCH], 1);
+	test_assert(attacks_consistent(game));
+
+	struct action_t capture = {
+		.moves = {
+			{ .type = CAPTURE, .dst_tile = center },
+			{ .type = BUILD, .src_tile = 0, .dst_tile = 1 },
+		},
+	};
+	test_assert(is_action_legal(game, &capture));
+	game_perform_action(game, &capture);
+	test_assert(!game_piece_threatened(game, TRENCH));
+	test_assert(attacks_consistent(game));
+	game_free(game);
+	subtest_finished();
+}
+
+static void test_pack_action(void) {
+	subtest_start();
+	const struct action_t action = {
+		.moves = {
+			{ .type = CAPTURE, .src_tile = 0, .dst_tile = 126 },
+			{ .type = MOVE, .src_tile = 127, .dst_tile = 5 },
+		},
+	};
+	struct action_t unpacked;
+	game_unpack_action(game_pack_action(&action), &unpacked);
+	test_assert_int_eq(unpacked.moves[0].type, CAPTURE);
+	test_assert_int_eq(unpacked.moves[0].dst_tile, 126);
+	test_assert_int_eq(unpacked.moves[1].type, MOVE);
+	test_assert_int_eq(unpacked.moves[1].src_tile, 127);
+	test_assert_int_eq(unpacked.moves[1].dst_tile, 5);
+	subtest_finished();
+}
+
+static void test_pack_position(void) {
+	subtest_start();
+	for (uint8_t n = 3; n <= 4; n++) {
+		struct game_t *game = game_init(n);
+		struct game_t *unpacked = game_init(n);
+		struct random_walk_ctx_t ctx = {
+			.rng_state = 99 + n,
+			.consistent = true,
+		};
+		for (int ply = 0; ply < 100; ply++) {
+			if (game_won_by(game, TRENCH) || game_won_by(game, CLIMB)) {
+				game_reset(game);
+			}
+			struct packed_position_t packed;
+			game_pack_position(game, game->side_turn, &packed);
+			game_unpack_position(unpacked, &packed);
+			test_assert(unpacked->side_turn == game->side_turn);
+			test_assert(unpacked->hash == game->hash);
+			test_assert(!memcmp(unpacked->board->tiles, game->board->tiles, NUMBER_TILES(n)));
+
+			ctx.action_cnt = 0;
+			enumerate_valid_actions(game, random_walk_callback, &ctx);
+			game_perform_action(game, &ctx.action);
+		}
+		game_free(unpacked);
+		game_free(game);
+	}
+	subtest_finished();
+}
+
+static void test_build_legality(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	const unsigned int piece = 9;
+	const unsigned int step = game->canpos[piece].adjacent_tiles[0];
+	unsigned int free_tiles[3];
+	unsigned int free_count = 0;
+	for (unsigned int i = 1; (i < NUMBER_TILES(3)) && (free_count < 3); i++) {
+		if ((i != piece) && (i != step)) {
+			free_tiles[free_count++] = i;
+		}
+	}
+
+	/* Trench can step from piece to step after any build elsewhere */
+	uint8_t tiles[NUMBER_TILES(3)];
+	memset(tiles, EMPTY_NEUTRAL, sizeof(tiles));
+	tiles[0] = PIECE_CLIMB;
+	tiles[piece] = PIECE_TRENCH;
+	tiles[step] = EMPTY_TRENCH;
+	tiles[free_tiles[0]] = EMPTY_CLIMB;
+	tiles[free_tiles[2]] = EMPTY_CLIMB;
+	game_set_position(game, tiles, TRENCH);
+	struct action_t action = {
+		.moves = {
+			{ .type = BUILD },
+			{ .type = MOVE, .src_tile = piece, .dst_tile = step },
+		},
+	};
+
+	/* Taking from a full tile is fine, the destination is what must not be
+	 * full */
+	action.moves[0].src_tile = free_tiles[0];
+	action.moves[0].dst_tile = free_tiles[1];
+	test_assert(is_action_legal(game, &action));
+	test_assert(game_action_valid(game, &action));
+
+	action.moves[0].src_tile = free_tiles[1];
+	action.moves[0].dst_tile = free_tiles[2];
+	test_assert(!is_action_legal(game, &action));
+	test_assert(!game_action_valid(game, &action));
+
+	/* Building onto the tile the build takes from */
+	action.moves[0].src_tile = free_tiles[1];
+	action.moves[0].dst_tile = free_tiles[1];
+	test_assert(!is_action_legal(game, &action));
+	test_assert(!game_action_valid(game, &action));
+	game_free(game);
+	subtest_finished();
+}
+
+struct checked_legality_ctx_t {
+	uint32_t actions[4096];
+	unsigned int count;
+};
+
+static bool checked_legality_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct checked_legality_ctx_t *ctx = (struct checked_legality_ctx_t*)vctx;
+	ctx->actions[ctx->count++] = game_pack_action(action);
+	return ctx->count < 4096;
+}
+
+static void test_checked_legality(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+
+	/* Everything the enumeration emits passes */
+	static struct checked_legality_ctx_t ctx;
+	enumerate_valid_actions(game, checked_legality_callback, &ctx);
+	test_assert(ctx.count > 0);
+	for (unsigned int i = 0; i < ctx.count; i++) {
+		struct action_t action;
+		game_unpack_action(ctx.actions[i], &action);
+		test_assert(is_action_legal_checked(game, &action));
+	}
+
+	/* Moves in an order the rules do not permit, or off the board */
+	struct action_t action = {
+		.moves = {
+			{ .type = BUILD, .src_tile = 0, .dst_tile = 1 },
+			{ .type = BUILD, .src_tile = 2, .dst_tile = 3 },
+		},
+	};
+	test_assert(!is_action_legal_checked(game, &action));
+	action.moves[1] = (struct move_t) { .type = MOVE, .src_tile = NUMBER_TILES(3), .dst_tile = 0 };
+	test_assert(!is_action_legal_checked(game, &action));
+	action.moves[0] = (struct move_t) { .type = MOVE, .src_tile = 0, .dst_tile = 1 };
+	action.moves[1] = (struct move_t) { .type = BUILD, .src_tile = 2, .dst_tile = 3 };
+	test_assert(!is_action_legal_checked(game, &action));
+	game_free(game);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_attack_counts();
+	test_make_unmake();
+	test_count_actions();
+	test_relevant_actions();
+	test_piece_threatened();
+	test_pack_action();
+	test_pack_position();
+	test_build_legality();
+	test_checked_legality();
+	test_finished();
+	return 0;
+}
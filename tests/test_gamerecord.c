@@ -0,0 +1,194 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <gamerecord.h>
+
+struct collect_ctx_t {
+	unsigned int count;
+	struct action_t actions[8];
+};
+
+static bool collect_actions(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct collect_ctx_t *ctx = (struct collect_ctx_t*)vctx;
+	if (ctx->count < 8) {
+		ctx->actions[ctx->count++] = *action;
+	}
+	return true;
+}
+
+static void test_record_roundtrip(void) {
+	subtest_start();
+	char filename[] = "/tmp/test_gamerecord_XXXXXX";
+	int fd = mkstemp(filename);
+	test_assert(fd != -1);
+	close(fd);
+
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+	struct strategy_t other = strategy;
+	other.weights.values[FEATURE_ACTIONS] = 2.5;
+	other.distance_metric = DISTANCE_HEIGHT;
+	other.build_mode = BUILDS_RELEVANT;
+	other.build_radius = 2;
+	other.quiescence_depth = 3;
+	other.move_nodes = 1ULL << 40;
+
+	/* Play two plies, always taking the first enumerated action */
+	struct game_t *game = game_init(3);
+	struct history_t *history = history_init(0);
+	history_push(history, game->hash, NULL);
+	for (int i = 0; i < 2; i++) {
+		struct collect_ctx_t ctx = { 0 };
+		enumerate_valid_actions(game, collect_actions, &ctx);
+		game_perform_action(game, &ctx.actions[0]);
+		history_push(history, game->hash, &ctx.actions[0]);
+	}
+	const uint64_t final_hash = game->hash;
+
+	struct gamerecord_writer_t *writer = gamerecord_writer_open(filename);
+	test_assert(writer != NULL);
+	test_assert(gamerecord_append(writer, 3, CLIMB, &strategy, &other, history, RESULT_DRAW));
+	test_assert(gamerecord_append(writer, 3, CLIMB, &strategy, &strategy, history, RESULT_WIN));
+	gamerecord_writer_close(writer);
+
+	struct gamerecord_reader_t *reader = gamerecord_reader_open(filename);
+	test_assert(reader != NULL);
+	struct gamerecord_t record;
+	test_assert(gamerecord_next(reader, &record));
+	test_assert_int_eq(record.header->n, 3);
+	test_assert_int_eq(record.header->ply_count, 2);
+	test_assert_int_eq(record.header->result, RESULT_DRAW);
+	test_assert(!memcmp(record.header->strategies[0].weights, strategy.weights.values, sizeof(strategy.weights.values)));
+	test_assert(!memcmp(record.header->strategies[1].weights, other.weights.values, sizeof(other.weights.values)));
+	test_assert_int_eq(record.header->strategies[0].distance_metric, DISTANCE_PATH);
+	test_assert_int_eq(record.header->strategies[1].distance_metric, DISTANCE_HEIGHT);
+	test_assert_int_eq(record.header->strategies[1].build_mode, BUILDS_RELEVANT);
+	test_assert_int_eq(record.header->strategies[1].build_radius, 2);
+	test_assert_int_eq(record.header->strategies[1].quiescence_depth, 3);
+	test_assert(record.header->strategies[1].move_nodes == UINT32_MAX);
+	test_assert(!record.header->strategies[1].uses_book);
+	gamerecord_replay(&record, game, NULL, NULL);
+	test_assert(game->hash == final_hash);
+	test_assert(gamerecord_next(reader, &record));
+	test_assert_int_eq(record.header->result, RESULT_WIN);
+	test_assert(!gamerecord_next(reader, &record));
+	gamerecord_reader_close(reader);
+
+	history_free(history);
+	game_free(game);
+	unlink(filename);
+	subtest_finished();
+}
+
+static bool write_raw(const char *filename, const void *data, size_t length) {
+	FILE *f = fopen(filename, "w");
+	if (!f) {
+		return false;
+	}
+	bool success = (fwrite(data, length, 1, f) == 1);
+	return !fclose(f) && success;
+}
+
+static bool raw_record_readable(const char *filename, const uint8_t *data, size_t length) {
+	test_assert(write_raw(filename, data, length));
+	struct gamerecord_reader_t *reader = gamerecord_reader_open(filename);
+	test_assert(reader != NULL);
+	struct gamerecord_t record;
+	bool readable = gamerecord_next(reader, &record);
+	gamerecord_reader_close(reader);
+	return readable;
+}
+
+static void test_record_validation(void) {
+	subtest_start();
+	char filename[] = "/tmp/test_gamerecord_XXXXXX";
+	int fd = mkstemp(filename);
+	test_assert(fd != -1);
+	close(fd);
+
+	struct strategy_t strategy = { 0 };
+	struct game_t *game = game_init(3);
+	const enum side_t first_side = game->side_turn;
+	struct history_t *history = history_init(0);
+	history_push(history, game->hash, NULL);
+	for (int i = 0; i < 2; i++) {
+		struct collect_ctx_t ctx = { 0 };
+		enumerate_valid_actions(game, collect_actions, &ctx);
+		game_perform_action(game, &ctx.actions[0]);
+		history_push(history, game->hash, &ctx.actions[0]);
+	}
+	struct gamerecord_writer_t *writer = gamerecord_writer_open(filename);
+	test_assert(gamerecord_append(writer, 3, first_side, &strategy, &strategy, history, RESULT_DRAW));
+	gamerecord_writer_close(writer);
+
+	uint8_t original[sizeof(struct gamerecord_header_t) + 2 * sizeof(uint32_t)];
+	FILE *f = fopen(filename, "r");
+	test_assert(f != NULL);
+	test_assert(fread(original, sizeof(original), 1, f) == 1);
+	fclose(f);
+	test_assert(raw_record_readable(filename, original, sizeof(original)));
+
+	uint8_t data[sizeof(original)];
+	struct gamerecord_header_t *header = (struct gamerecord_header_t*)data;
+	uint32_t *actions = (uint32_t*)(data + sizeof(struct gamerecord_header_t));
+
+	/* Board too large to create */
+	memcpy(data, original, sizeof(data));
+	header->n = 9;
+	test_assert(!raw_record_readable(filename, data, sizeof(data)));
+
+	memcpy(data, original, sizeof(data));
+	header->first_side = 7;
+	test_assert(!raw_record_readable(filename, data, sizeof(data)));
+
+	/* Tile beyond the 19 tiles of n = 3 */
+	memcpy(data, original, sizeof(data));
+	const struct action_t off_board = {
+		.moves = {
+			{ .type = BUILD, .src_tile = 0, .dst_tile = 100 },
+			{ .type = MOVE, .src_tile = 1, .dst_tile = 2 },
+		},
+	};
+	actions[1] = game_pack_action(&off_board);
+	test_assert(!raw_record_readable(filename, data, sizeof(data)));
+
+	/* On the board, but not a legal action in that position */
+	memcpy(data, original, sizeof(data));
+	actions[1] = actions[0];
+	test_assert(!raw_record_readable(filename, data, sizeof(data)));
+
+	history_free(history);
+	game_free(game);
+	unlink(filename);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_record_roundtrip();
+	test_record_validation();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <history.h>
+#include <game.h>
+
+static void test_history_repetitions(void) {
+	subtest_start();
+	struct history_t *history = history_init(0);
+	test_assert(history != NULL);
+	const uint64_t a = 0x1111, b = 0x2222, c = 0x3333, d = 0x4444;
+	const uint64_t sequence[] = { a, b, c, d, a, b, c, d, a };
+	for (int i = 0; i < sizeof(sequence) / sizeof(uint64_t); i++) {
+		test_assert(history_push(history, sequence[i], NULL));
+	}
+	test_assert_int_eq(history->length, 9);
+	test_assert_int_eq(history_occurrences(history, a), 3);
+	test_assert_int_eq(history_occurrences(history, c), 2);
+
+	/* b and d are on the opposite parity of the last entry */
+	test_assert_int_eq(history_occurrences(history, b), 0);
+	history_pop(history);
+	test_assert_int_eq(history_occurrences(history, b), 2);
+	test_assert_int_eq(history_occurrences(history, a), 0);
+	history_free(history);
+	subtest_finished();
+}
+
+static void test_history_growth(void) {
+	subtest_start();
+	struct history_t *history = history_init(1);
+	for (int i = 0; i < 1000; i++) {
+		test_assert(history_push(history, i, NULL));
+	}
+	test_assert_int_eq(history->length, 1000);
+	test_assert(history->entries[999].hash == 999);
+	history_clear(history);
+	test_assert_int_eq(history->length, 0);
+	history_free(history);
+	subtest_finished();
+}
+
+struct first_action_ctx {
+	bool found;
+	struct action_t action;
+};
+
+static bool remember_first_action(struct game_t *game, const struct action_t *action, void *vctx) {
+	struct first_action_ctx *ctx = (struct first_action_ctx*)vctx;
+	if (!ctx->found) {
+		ctx->found = true;
+		ctx->action = *action;
+	}
+	test_assert(game->hash == game_compute_hash(game));
+	return true;
+}
+
+static void test_incremental_hash(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	test_assert(game->hash == game_compute_hash(game));
+	for (int ply = 0; ply < 6; ply++) {
+		struct first_action_ctx ctx = { 0 };
+		uint64_t hash_before = game->hash;
+		enumerate_valid_actions(game, remember_first_action, &ctx);
+		test_assert(ctx.found);
+		test_assert(game->hash == hash_before);
+		game_perform_action(game, &ctx.action);
+		test_assert(game->hash == game_compute_hash(game));
+		test_assert(game->hash != hash_before);
+	}
+	game_free(game);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_history_repetitions();
+	test_history_growth();
+	test_incremental_hash();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <latency.h>
+
+static void test_exact_small_values(void) {
+	subtest_start();
+	struct latency_histogram_t histogram;
+	latency_histogram_clear(&histogram);
+	for (unsigned int i = 1; i <= 100; i++) {
+		latency_histogram_record(&histogram, i);
+	}
+	test_assert(histogram.count == 100);
+	test_assert(histogram.min == 1);
+	test_assert(histogram.max == 100);
+	test_assert_int_eq(latency_histogram_percentile(&histogram, 0.5), 50);
+	test_assert_int_eq(latency_histogram_percentile(&histogram, 0.0), 1);
+	test_assert_int_eq(latency_histogram_percentile(&histogram, 1.0), 100);
+	subtest_finished();
+}
+
+static void test_relative_error(void) {
+	subtest_start();
+	struct latency_histogram_t histogram;
+	latency_histogram_clear(&histogram);
+	for (unsigned int i = 1; i <= 1000; i++) {
+		latency_histogram_record(&histogram, i * 12345ULL);
+	}
+	const double percentiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	for (unsigned int i = 0; i < sizeof(percentiles) / sizeof(double); i++) {
+		const uint64_t exact = (uint64_t)(percentiles[i] * 1000 + 0.5) * 12345ULL;
+		const uint64_t value = latency_histogram_percentile(&histogram, percentiles[i]);
+		test_assert(value >= exact);
+		test_assert(value <= exact + exact / 32);
+	}
+	subtest_finished();
+}
+
+static void test_merge(void) {
+	subtest_start();
+	struct latency_histogram_t whole, even, odd;
+	latency_histogram_clear(&whole);
+	latency_histogram_clear(&even);
+	latency_histogram_clear(&odd);
+	uint64_t value = 1;
+	for (unsigned int i = 0; i < 5000; i++) {
+		value = (value * 6364136223846793005ULL) + 1442695040888963407ULL;
+		const uint64_t sample = value >> 40;
+		latency_histogram_record(&whole, sample);
+		latency_histogram_record((i % 2) ? &odd : &even, sample);
+	}
+	latency_histogram_merge(&even, &odd);
+	test_assert(even.count == whole.count);
+	test_assert(even.min == whole.min);
+	test_assert(even.max == whole.max);
+	test_assert(memcmp(even.buckets, whole.buckets, sizeof(whole.buckets)) == 0);
+	subtest_finished();
+}
+
+static void test_classes(void) {
+	subtest_start();
+	struct latency_t *latency = latency_init();
+	test_assert(latency != NULL);
+	latency_record(latency, 0, 10, 1000);
+	latency_record(latency, 15, 5000, 2000);
+	latency_record(latency, 500, 300, 3000);
+	test_assert(latency->all.count == 3);
+	test_assert(latency->by_ply[0].count == 1);
+	test_assert(latency->by_ply[1].count == 1);
+	test_assert(latency->by_ply[LATENCY_PLY_CLASSES - 1].count == 1);
+	test_assert(latency->by_actions[0].count == 1);
+	test_assert(latency->by_actions[2].count == 1);
+	test_assert(latency->by_actions[LATENCY_ACTION_CLASSES - 1].count == 1);
+
+	struct latency_t *total = latency_init();
+	latency_merge(total, latency);
+	latency_merge(total, latency);
+	test_assert(total->all.count == 6);
+	test_assert(total->by_ply[1].max == 2000);
+	latency_free(total);
+	latency_free(latency);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_exact_small_values();
+	test_relative_error();
+	test_merge();
+	test_classes();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,153 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libisopath.h>
+#include <evaluation.h>
+
+static void test_generate_apply_undo(void) {
+	subtest_start();
+	test_assert_int_eq(isopath_api_version(), ISOPATH_API_VERSION);
+	test_assert(isopath_game_new(1) == NULL);
+	test_assert(isopath_game_new(8) == NULL);
+
+	struct isopath_game_t *game = isopath_game_new(4);
+	test_assert(game != NULL);
+	test_assert_int_eq(isopath_side_to_move(game), ISOPATH_CLIMB);
+	test_assert_int_eq(isopath_winner(game), ISOPATH_NO_WINNER);
+
+	/* A short buffer still reports the total */
+	uint32_t actions[256];
+	unsigned int count = isopath_generate_actions(game, actions, 1);
+	test_assert(count > 1);
+	test_assert(count <= 256);
+	test_assert_int_eq(isopath_generate_actions(game, actions, 256), count);
+
+	char initial[64];
+	test_assert(isopath_get_position(game, initial, sizeof(initial)));
+	uint64_t hash = isopath_hash(game);
+	for (unsigned int i = 0; i < count; i += 17) {
+		test_assert(isopath_apply(game, actions[i]));
+		test_assert(isopath_hash(game) != hash);
+		test_assert_int_eq(isopath_side_to_move(game), ISOPATH_TRENCH);
+		test_assert(isopath_undo(game));
+		test_assert(isopath_hash(game) == hash);
+	}
+	test_assert(!isopath_undo(game));
+
+	/* Applying an action twice is not legal, the second time the source
+	 * tile is empty */
+	test_assert(isopath_apply(game, actions[0]));
+	test_assert(!isopath_apply(game, actions[0]));
+	test_assert(!isopath_apply(game, 0xffffffff));
+	test_assert(isopath_undo(game));
+
+	char position[64];
+	test_assert(isopath_get_position(game, position, sizeof(position)));
+	test_assert_str_eq(position, initial);
+	test_assert(!isopath_get_position(game, position, 4));
+	test_assert(isopath_set_position(game, position, ISOPATH_TRENCH));
+	test_assert_int_eq(isopath_side_to_move(game), ISOPATH_TRENCH);
+	test_assert(!isopath_set_position(game, "111", ISOPATH_TRENCH));
+	test_assert(!isopath_set_position(game, position, 2));
+	isopath_game_free(game);
+	subtest_finished();
+}
+
+static void test_search_and_notation(void) {
+	subtest_start();
+	struct isopath_game_t *game = isopath_game_new(3);
+	test_assert(isopath_set_hash_size(game, 1 << 20));
+	test_assert(isopath_evaluate(game) == 0);
+
+	uint32_t best_action;
+	float score;
+	test_assert(!isopath_search(game, 0, 0, 0, &best_action, &score));
+	test_assert(isopath_search(game, 2, 0, 0, &best_action, &score));
+	test_assert(isopath_apply(game, best_action));
+
+	char action_str[32];
+	uint32_t parsed;
+	test_assert(isopath_action_to_string(best_action, action_str, sizeof(action_str)));
+	test_assert(isopath_action_from_string(action_str, &parsed));
+	test_assert(parsed == best_action);
+	test_assert(!isopath_action_to_string(best_action, action_str, 4));
+	test_assert(!isopath_action_from_string("B200-1,M1-2", &parsed));
+	isopath_game_free(game);
+	isopath_game_free(NULL);
+	subtest_finished();
+}
+
+static float search_score(struct isopath_game_t *game) {
+	uint32_t best_action;
+	float score = 0;
+	test_assert(isopath_search(game, 2, 0, 0, &best_action, &score));
+	return score;
+}
+
+static void test_load_weights_clears_hash(void) {
+	subtest_start();
+	char filename[] = "/tmp/test_libisopath_XXXXXX";
+	int fd = mkstemp(filename);
+	test_assert(fd != -1);
+	close(fd);
+	struct feature_vector_t weights;
+	evaluation_default_weights(&weights);
+	for (unsigned int i = 0; i < FEATURE_COUNT; i++) {
+		weights.values[i] *= 3;
+	}
+	test_assert(evaluation_save_weights(filename, &weights));
+
+	/* A search after loading weights must not reuse scores of the old
+	 * ones */
+	struct isopath_game_t *game = isopath_game_new(3);
+	struct isopath_game_t *fresh = isopath_game_new(3);
+	test_assert(isopath_set_hash_size(game, 1 << 20));
+	test_assert(isopath_set_hash_size(fresh, 1 << 20));
+	uint32_t first_action;
+	float score;
+	test_assert(isopath_search(game, 1, 0, 0, &first_action, &score));
+	test_assert(isopath_apply(game, first_action));
+	test_assert(isopath_apply(fresh, first_action));
+	const float old_score = search_score(game);
+	test_assert(isopath_load_weights(game, filename));
+	test_assert(isopath_load_weights(fresh, filename));
+	const float new_score = search_score(game);
+	test_assert(new_score != old_score);
+	test_assert(new_score == search_score(fresh));
+	isopath_game_free(game);
+	isopath_game_free(fresh);
+	unlink(filename);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_generate_apply_undo();
+	test_search_and_notation();
+	test_load_weights_clears_hash();
+	test_finished();
+	return 0;
+}
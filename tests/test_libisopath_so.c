@@ -0,0 +1,72 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <dlfcn.h>
+#include <libisopath.h>
+
+/* Resolves the symbols by name, just like an FFI binding would */
+static void test_dlopen(void) {
+	subtest_start();
+	void *lib = dlopen("../libisopath.so", RTLD_NOW | RTLD_LOCAL);
+	if (!lib) {
+		fprintf(stderr, "%s\n", dlerror());
+	}
+	test_assert(lib != NULL);
+	abort_subtest_if_assertion_failure("cannot load libisopath.so\n");
+
+	unsigned int (*api_version)(void) = (unsigned int (*)(void))dlsym(lib, "isopath_api_version");
+	struct isopath_game_t *(*game_new)(unsigned int) = (struct isopath_game_t *(*)(unsigned int))dlsym(lib, "isopath_game_new");
+	void (*game_free)(struct isopath_game_t*) = (void (*)(struct isopath_game_t*))dlsym(lib, "isopath_game_free");
+	unsigned int (*generate_actions)(struct isopath_game_t*, uint32_t*, unsigned int) = (unsigned int (*)(struct isopath_game_t*, uint32_t*, unsigned int))dlsym(lib, "isopath_generate_actions");
+	bool (*search)(struct isopath_game_t*, unsigned int, uint64_t, unsigned int, uint32_t*, float*) = (bool (*)(struct isopath_game_t*, unsigned int, uint64_t, unsigned int, uint32_t*, float*))dlsym(lib, "isopath_search");
+	test_assert(api_version && game_new && game_free && generate_actions && search);
+	abort_subtest_if_assertion_failure("libisopath.so lacks exported symbols\n");
+	test_assert_int_eq(api_version(), ISOPATH_API_VERSION);
+
+	/* Internals stay hidden */
+	test_assert(dlsym(lib, "game_init") == NULL);
+
+	struct isopath_game_t *game = game_new(3);
+	test_assert(game != NULL);
+	uint32_t actions[256];
+	unsigned int count = generate_actions(game, actions, 256);
+	test_assert(count > 0);
+	uint32_t best_action;
+	float score;
+	test_assert(search(game, 2, 0, 0, &best_action, &score));
+	bool found = false;
+	for (unsigned int i = 0; i < count; i++) {
+		found = found || (actions[i] == best_action);
+	}
+	test_assert(found);
+	game_free(game);
+	dlclose(lib);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_dlopen();
+	test_finished();
+	return 0;
+}
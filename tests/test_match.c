@@ -0,0 +1,113 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <math.h>
+#include <match.h>
+
+static const struct match_params_t sprt_params = {
+	.elo0 = 0,
+	.elo1 = 10,
+	.alpha = 0.05,
+	.beta = 0.05,
+};
+
+static void test_sprt_undecided(void) {
+	subtest_start();
+	struct match_results_t results = { 0 };
+	match_evaluate(&sprt_params, &results);
+	test_assert(results.decision == SPRT_UNDECIDED);
+	test_assert(results.llr == 0);
+	test_assert(fabs(results.llr_upper - log(19)) < 1e-9);
+	test_assert(fabs(results.llr_lower + log(19)) < 1e-9);
+
+	/* Perfectly even results */
+	results = (struct match_results_t) { .pairs = 100, .pentanomial = { 10, 20, 40, 20, 10 } };
+	match_evaluate(&sprt_params, &results);
+	test_assert(results.decision == SPRT_UNDECIDED);
+	test_assert(fabs(results.elo) < 1e-9);
+	test_assert(results.elo_lower < 0);
+	test_assert(results.elo_upper > 0);
+	test_assert(results.llr < 0);
+	subtest_finished();
+}
+
+static void test_sprt_decided(void) {
+	subtest_start();
+	struct match_results_t results = { .pairs = 1000, .pentanomial = { 50, 150, 300, 300, 200 } };
+	match_evaluate(&sprt_params, &results);
+	test_assert(results.decision == SPRT_ACCEPT_H1);
+	test_assert(results.elo > 50);
+	test_assert(results.elo_lower < results.elo);
+	test_assert(results.elo_upper > results.elo);
+
+	results = (struct match_results_t) { .pairs = 1000, .pentanomial = { 200, 300, 300, 150, 50 } };
+	match_evaluate(&sprt_params, &results);
+	test_assert(results.decision == SPRT_ACCEPT_H0);
+	test_assert(results.elo < -50);
+	subtest_finished();
+}
+
+static void test_match_run(void) {
+	subtest_start();
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+	struct strategy_t random_strategy = { 0 };
+	struct match_params_t params = sprt_params;
+	params.n = 3;
+	params.thread_count = 4;
+	params.max_pairs = 200;
+	params.playout_params = (struct playout_params_t) {
+		.max_plies = 100,
+		.repetition_count = 3,
+		.random_plies = 2,
+		.seed = 1234,
+	};
+	params.candidate = &strategy;
+	params.baseline = &random_strategy;
+
+	struct match_results_t results;
+	match_run(&params, &results);
+	test_assert(results.pairs >= 1);
+	test_assert(results.pairs <= 200);
+	test_assert_int_eq(results.wins + results.losses + results.draws, 2 * results.pairs);
+	test_assert_int_eq(results.pentanomial[0] + results.pentanomial[1] + results.pentanomial[2] + results.pentanomial[3] + results.pentanomial[4], results.pairs);
+
+	/* Evaluation in pair order makes the stopping point independent of
+	 * thread timing */
+	struct match_results_t again;
+	params.thread_count = 1;
+	match_run(&params, &again);
+	test_assert_int_eq(again.pairs, results.pairs);
+	test_assert_int_eq(again.wins, results.wins);
+	test_assert_int_eq(again.losses, results.losses);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_sprt_undecided();
+	test_sprt_decided();
+	test_match_run();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,193 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <posdb.h>
+#include <gamerecord.h>
+#include <strategy.h>
+
+#define TEST_GAME_COUNT			150
+
+/* Plays random games of up to 40 plies and writes them to two record files */
+static void write_random_games(uint8_t n, const char *filenames[static 2], unsigned int outcomes[static 3]) {
+	struct strategy_t strategy = { 0 };
+	struct game_t *game = game_init(n);
+	struct history_t *history = history_init(0);
+	struct gamerecord_writer_t *writers[2] = {
+		gamerecord_writer_open(filenames[0]),
+		gamerecord_writer_open(filenames[1]),
+	};
+	test_assert(writers[0] && writers[1]);
+	for (unsigned int i = 0; i < TEST_GAME_COUNT; i++) {
+		uint64_t rng_state = i;
+		game_reset(game);
+		const enum side_t first_side = game->side_turn;
+		history_clear(history);
+		history_push(history, game->hash, NULL);
+		enum game_result_t result = RESULT_DRAW;
+		for (int ply = 0; ply < 40; ply++) {
+			const enum side_t mover = game->side_turn;
+			struct action_t action;
+			if (!strategy_perform_random_move(game, &rng_state, &action)) {
+				break;
+			}
+			history_push(history, game->hash, &action);
+			if (game_won_by(game, mover)) {
+				result = (mover == first_side) ? RESULT_WIN : RESULT_LOSS;
+				break;
+			}
+		}
+		outcomes[result]++;
+		test_assert(gamerecord_append(writers[i % 2], n, first_side, &strategy, &strategy, history, result));
+	}
+	gamerecord_writer_close(writers[0]);
+	gamerecord_writer_close(writers[1]);
+	history_free(history);
+	game_free(game);
+}
+
+struct replay_check_ctx_t {
+	const struct posdb_t *db;
+	unsigned int missing;
+};
+
+static void check_position(struct game_t *game, unsigned int ply, const struct action_t *action, void *vctx) {
+	struct replay_check_ctx_t *ctx = (struct replay_check_ctx_t*)vctx;
+	const struct posdb_entry_t *entry = posdb_query(ctx->db, game);
+	if (!entry || (entry->visits == 0) || (entry->wins[0] + entry->wins[1] + entry->draws != entry->visits)) {
+		ctx->missing++;
+	}
+}
+
+static void test_build_and_query(void) {
+	subtest_start();
+	char record_filenames[2][32] = { "/tmp/test_posdb_XXXXXX", "/tmp/test_posdb_XXXXXX" };
+	char db_filename[] = "/tmp/test_posdb_XXXXXX";
+	for (int i = 0; i < 2; i++) {
+		int fd = mkstemp(record_filenames[i]);
+		test_assert(fd != -1);
+		close(fd);
+	}
+	int fd = mkstemp(db_filename);
+	test_assert(fd != -1);
+	close(fd);
+
+	unsigned int outcomes[3] = { 0 };
+	const char *filenames[2] = { record_filenames[0], record_filenames[1] };
+	write_random_games(3, filenames, outcomes);
+
+	/* The smallest run buffer forces several runs per thread, which then
+	 * have to be merged */
+	const struct posdb_build_params_t params = {
+		.record_filenames = filenames,
+		.record_file_count = 2,
+		.output_filename = db_filename,
+		.tmpdir = "/tmp",
+		.memory_bytes = 0,
+		.thread_count = 2,
+	};
+	test_assert(posdb_build(&params));
+
+	struct posdb_t *db = posdb_open(db_filename);
+	test_assert(db != NULL);
+	test_assert_int_eq(db->header->n, 3);
+	test_assert_int_eq(db->header->game_count, TEST_GAME_COUNT);
+
+	/* Every game starts from the same position */
+	struct game_t *game = game_init(3);
+	const enum side_t first_side = game->side_turn;
+	const enum side_t second_side = (first_side == TRENCH) ? CLIMB : TRENCH;
+	const struct posdb_entry_t *start = posdb_query(db, game);
+	test_assert(start != NULL);
+	test_assert_int_eq(start->visits, TEST_GAME_COUNT);
+	test_assert_int_eq(start->wins[first_side], outcomes[RESULT_WIN]);
+	test_assert_int_eq(start->wins[second_side], outcomes[RESULT_LOSS]);
+	test_assert_int_eq(start->draws, outcomes[RESULT_DRAW]);
+
+	/* Every position of every game is in there */
+	struct replay_check_ctx_t ctx = {
+		.db = db,
+	};
+	struct gamerecord_reader_t *reader = gamerecord_reader_open(filenames[1]);
+	struct gamerecord_t record;
+	while (gamerecord_next(reader, &record)) {
+		gamerecord_replay(&record, game, check_position, &ctx);
+	}
+	gamerecord_reader_close(reader);
+	test_assert_int_eq(ctx.missing, 0);
+
+	/* Another board size never matches */
+	struct game_t *other_game = game_init(4);
+	test_assert(posdb_query(db, other_game) == NULL);
+	game_free(other_game);
+	posdb_close(db);
+
+	/* Records of different board sizes cannot be mixed */
+	unsigned int other_outcomes[3] = { 0 };
+	write_random_games(4, filenames, other_outcomes);
+	test_assert(!posdb_build(&params));
+
+	game_free(game);
+	unlink(record_filenames[0]);
+	unlink(record_filenames[1]);
+	unlink(db_filename);
+	subtest_finished();
+}
+
+static void test_open_corrupt(void) {
+	subtest_start();
+	char db_filename[] = "/tmp/test_posdb_XXXXXX";
+	int fd = mkstemp(db_filename);
+	test_assert(fd != -1);
+	close(fd);
+
+	/* Table sizes posdb_build never writes are rejected before they are
+	 * used to size or index the table */
+	const uint32_t table_bits[] = { 0, 9, 49, 64, 200 };
+	for (unsigned int i = 0; i < sizeof(table_bits) / sizeof(table_bits[0]); i++) {
+		const struct posdb_header_t header = {
+			.magic = POSDB_MAGIC,
+			.version = POSDB_VERSION,
+			.table_bits = table_bits[i],
+			.n = 3,
+		};
+		FILE *f = fopen(db_filename, "wb");
+		test_assert(f);
+		abort_subtest_if_assertion_failure("database could not be written\n");
+		test_assert(fwrite(&header, sizeof(header), 1, f) == 1);
+		fclose(f);
+		test_assert(posdb_open(db_filename) == NULL);
+	}
+	unlink(db_filename);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_build_and_query();
+	test_open_corrupt();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,157 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <reach.h>
+
+/* Distinct positions first reached at each ply; Iso-Path(2) is exhausted
+ * after nine plies */
+static const uint64_t layers_n2[] = { 1, 8, 40, 216, 699, 1068, 918, 415, 52, 2, 0 };
+static const uint64_t layers_n3[] = { 1, 72, 4392, 291228 };
+
+static void test_reach_n2(void) {
+	subtest_start();
+	uint64_t layer_counts[16] = { 0 };
+	const struct reach_params_t params = {
+		.n = 2,
+		.max_depth = 16,
+		.thread_count = 2,
+		.tmpdir = "/tmp",
+		.layer_counts = layer_counts,
+		.layer_counts_size = 16,
+	};
+	test_assert(reach_enumerate(&params));
+	for (unsigned int i = 0; i < sizeof(layers_n2) / sizeof(layers_n2[0]); i++) {
+		test_assert(layer_counts[i] == layers_n2[i]);
+	}
+	subtest_finished();
+}
+
+static void test_reach_n3_depth_limited(void) {
+	subtest_start();
+	uint64_t layer_counts[8] = { 0 };
+
+	/* The smallest buffer spills many runs per thread on the last layer */
+	const struct reach_params_t params = {
+		.n = 3,
+		.max_depth = 3,
+		.memory_bytes = 0,
+		.thread_count = 2,
+		.tmpdir = "/tmp",
+		.layer_counts = layer_counts,
+		.layer_counts_size = 8,
+	};
+	test_assert(reach_enumerate(&params));
+	for (unsigned int i = 0; i < sizeof(layers_n3) / sizeof(layers_n3[0]); i++) {
+		test_assert(layer_counts[i] == layers_n3[i]);
+	}
+
+	/* Nothing beyond the depth limit */
+	test_assert(layer_counts[4] == 0);
+	subtest_finished();
+}
+
+static void test_reach_resume(void) {
+	subtest_start();
+	char checkpoint_filename[] = "/tmp/test_reach_XXXXXX";
+	int fd = mkstemp(checkpoint_filename);
+	test_assert(fd != -1);
+	close(fd);
+	unlink(checkpoint_filename);
+
+	/* Stopping at the depth limit keeps the checkpoint, the second run picks
+	 * up from there and then removes it */
+	uint64_t layer_counts[16] = { 0 };
+	struct reach_params_t params = {
+		.n = 2,
+		.max_depth = 4,
+		.thread_count = 1,
+		.tmpdir = "/tmp",
+		.checkpoint_filename = checkpoint_filename,
+		.layer_counts = layer_counts,
+		.layer_counts_size = 16,
+	};
+	test_assert(reach_enumerate(&params));
+	test_assert(access(checkpoint_filename, F_OK) == 0);
+	test_assert(layer_counts[4] == layers_n2[4]);
+	test_assert(layer_counts[5] == 0);
+
+	params.max_depth = 16;
+	test_assert(reach_enumerate(&params));
+	test_assert(access(checkpoint_filename, F_OK) != 0);
+	for (unsigned int i = 0; i < sizeof(layers_n2) / sizeof(layers_n2[0]); i++) {
+		test_assert(layer_counts[i] == layers_n2[i]);
+	}
+	subtest_finished();
+}
+
+static void test_reach_resume_after_failure(void) {
+	subtest_start();
+	char checkpoint_filename[] = "/tmp/test_reach_XXXXXX";
+	int fd = mkstemp(checkpoint_filename);
+	test_assert(fd != -1);
+	close(fd);
+	unlink(checkpoint_filename);
+
+	/* A directory in place of the fifth layer makes the run fail after the
+	 * fourth; the checkpoint and its layer survive and the next run resumes
+	 * from them */
+	char blocker_filename[256];
+	snprintf(blocker_filename, sizeof(blocker_filename), "%s.frontier.5", checkpoint_filename);
+	test_assert(mkdir(blocker_filename, 0700) == 0);
+	uint64_t layer_counts[16] = { 0 };
+	struct reach_params_t params = {
+		.n = 2,
+		.max_depth = 16,
+		.thread_count = 1,
+		.tmpdir = "/tmp",
+		.checkpoint_filename = checkpoint_filename,
+		.layer_counts = layer_counts,
+		.layer_counts_size = 16,
+	};
+	test_assert(!reach_enumerate(&params));
+	rmdir(blocker_filename);
+	test_assert(access(checkpoint_filename, F_OK) == 0);
+	test_assert(layer_counts[4] == layers_n2[4]);
+	test_assert(layer_counts[5] == 0);
+
+	test_assert(reach_enumerate(&params));
+	test_assert(access(checkpoint_filename, F_OK) != 0);
+	for (unsigned int i = 0; i < sizeof(layers_n2) / sizeof(layers_n2[0]); i++) {
+		test_assert(layer_counts[i] == layers_n2[i]);
+	}
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_reach_n2();
+	test_reach_n3_depth_limited();
+	test_reach_resume();
+	test_reach_resume_after_failure();
+	test_finished();
+	return 0;
+}
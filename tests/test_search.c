@@ -0,0 +1,90 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <strategy.h>
+#include <search.h>
+#include <notation.h>
+
+static void test_search_finds_win(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+
+	/* Climb steps from tile 13 onto the full tile 16 of the trench base */
+	uint8_t tiles[NUMBER_TILES(3)];
+	test_assert(position_from_string("C111111111111C112TT", 3, tiles));
+	game_set_position(game, tiles, CLIMB);
+
+	for (unsigned int depth = 1; depth <= 3; depth += 2) {
+		const struct search_params_t params = {
+			.strategy = &strategy,
+			.depth = depth,
+		};
+		struct search_result_t result;
+		test_assert(search_best_action(game, &params, &result));
+		test_assert(result.have_action);
+		test_assert(!result.aborted);
+		test_assert(result.depth == depth);
+		test_assert(result.score > SEARCH_SCORE_WIN / 2);
+		test_assert(is_action_legal(game, &result.best_action));
+
+		const uint64_t hash = game->hash;
+		game_make_action(game, &result.best_action);
+		test_assert(game_won_by(game, CLIMB));
+		game_unmake_action(game);
+		test_assert(game->hash == hash);
+	}
+	game_free(game);
+	subtest_finished();
+}
+
+static void test_search_node_budget(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+
+	/* Iterative deepening stops at the budget but keeps a complete iteration */
+	const struct search_params_t params = {
+		.strategy = &strategy,
+		.depth = 0,
+		.iterative = true,
+		.node_budget = 2000,
+	};
+	struct search_result_t result;
+	test_assert(search_best_action(game, &params, &result));
+	test_assert(result.have_action);
+	test_assert(result.depth >= 1);
+	test_assert(is_action_legal(game, &result.best_action));
+	game_free(game);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_search_finds_win();
+	test_search_node_budget();
+	test_finished();
+	return 0;
+}
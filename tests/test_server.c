@@ -0,0 +1,254 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <server.h>
+#include <search.h>
+
+#define CLIENT_COUNT		3
+#define REQUESTS_PER_CLIENT	12
+
+struct server_thread_t {
+	struct server_params_t params;
+	bool success;
+};
+
+static void *server_thread(void *vctx) {
+	struct server_thread_t *ctx = (struct server_thread_t*)vctx;
+	ctx->success = server_run(&ctx->params);
+	return NULL;
+}
+
+static int connect_server(const char *socket_path) {
+	struct sockaddr_un addr = {
+		.sun_family = AF_UNIX,
+	};
+	strcpy(addr.sun_path, socket_path);
+	for (int attempt = 0; attempt < 500; attempt++) {
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+			return fd;
+		}
+		close(fd);
+		usleep(10000);
+	}
+	return -1;
+}
+
+static bool read_full(int fd, void *vbuf, size_t length) {
+	uint8_t *buf = (uint8_t*)vbuf;
+	while (length) {
+		ssize_t bytes = read(fd, buf, length);
+		if (bytes <= 0) {
+			return false;
+		}
+		buf += bytes;
+		length -= bytes;
+	}
+	return true;
+}
+
+static void test_concurrent_clients(void) {
+	subtest_start();
+	char socket_path[64];
+	snprintf(socket_path, sizeof(socket_path), "/tmp/isopath_test_%d.sock", getpid());
+
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+	atomic_bool stop = false;
+	struct server_thread_t server = {
+		.params = {
+			.socket_path = socket_path,
+			.n = 3,
+			.thread_count = 2,
+			.strategy = &strategy,
+			.search_depth = 1,
+			.stop = &stop,
+		},
+	};
+	pthread_t thread;
+	pthread_create(&thread, NULL, server_thread, &server);
+
+	/* The expected result of a depth 1 search from the start */
+	struct game_t *game = game_init(3);
+	const struct search_params_t search_params = {
+		.strategy = &strategy,
+		.depth = 1,
+	};
+	struct search_result_t expected;
+	search_best_action(game, &search_params, &expected);
+
+	int fds[CLIENT_COUNT];
+	for (int c = 0; c < CLIENT_COUNT; c++) {
+		fds[c] = connect_server(socket_path);
+		test_assert(fds[c] != -1);
+	}
+	abort_subtest_if_assertion_failure("cannot connect to server\n");
+
+	/* Every client pipelines all its requests before reading */
+	for (int c = 0; c < CLIENT_COUNT; c++) {
+		struct server_request_t requests[REQUESTS_PER_CLIENT];
+		memset(requests, 0, sizeof(requests));
+		for (int i = 0; i < REQUESTS_PER_CLIENT; i++) {
+			requests[i].request_id = (c * 1000) + i;
+			requests[i].command = (i % 3 == 0) ? SERVER_EVALUATE : SERVER_SEARCH;
+			requests[i].side = game->side_turn;
+			memcpy(requests[i].tiles, game->board->tiles, NUMBER_TILES(3));
+			if (i % 3 == 2) {
+				requests[i].side = 7;
+			}
+		}
+		test_assert(write(fds[c], requests, sizeof(requests)) == sizeof(requests));
+	}
+
+	for (int c = 0; c < CLIENT_COUNT; c++) {
+		bool seen[REQUESTS_PER_CLIENT] = { 0 };
+		for (int i = 0; i < REQUESTS_PER_CLIENT; i++) {
+			struct server_response_t response;
+			test_assert(read_full(fds[c], &response, sizeof(response)));
+			unsigned int index = response.request_id - (c * 1000);
+			test_assert(index < REQUESTS_PER_CLIENT);
+			if (index >= REQUESTS_PER_CLIENT) {
+				break;
+			}
+			test_assert(!seen[index]);
+			seen[index] = true;
+			if (index % 3 == 0) {
+				test_assert_int_eq(response.status, SERVER_OK);
+				test_assert(response.score == 0);
+			} else if (index % 3 == 1) {
+				test_assert_int_eq(response.status, SERVER_OK);
+				test_assert(response.best_action == game_pack_action(&expected.best_action));
+				test_assert(response.score == expected.score);
+				test_assert_int_eq(response.depth, 1);
+			} else {
+				test_assert_int_eq(response.status, SERVER_INVALID_REQUEST);
+			}
+		}
+	}
+
+	/* Disconnecting with requests in flight is fine */
+	struct server_request_t request = {
+		.command = SERVER_SEARCH,
+		.side = game->side_turn,
+	};
+	memcpy(request.tiles, game->board->tiles, NUMBER_TILES(3));
+	test_assert(write(fds[0], &request, sizeof(request)) == sizeof(request));
+	for (int c = 0; c < CLIENT_COUNT; c++) {
+		close(fds[c]);
+	}
+
+	atomic_store(&stop, true);
+	pthread_join(thread, NULL);
+	test_assert(server.success);
+	test_assert(access(socket_path, F_OK) != 0);
+	game_free(game);
+	subtest_finished();
+}
+
+static void test_stalled_client(void) {
+	subtest_start();
+	char socket_path[64];
+	snprintf(socket_path, sizeof(socket_path), "/tmp/isopath_test_%d.sock", getpid());
+
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+	atomic_bool stop = false;
+	struct server_thread_t server = {
+		.params = {
+			.socket_path = socket_path,
+			.n = 3,
+			.thread_count = 1,
+			.strategy = &strategy,
+			.search_depth = 1,
+			.stop = &stop,
+		},
+	};
+	pthread_t thread;
+	pthread_create(&thread, NULL, server_thread, &server);
+
+	/* Far more responses than fit into the socket buffer, which the client
+	 * then does not read */
+	const unsigned int stalled_count = 20000;
+	struct game_t *game = game_init(3);
+	struct server_request_t *requests = calloc(stalled_count, sizeof(struct server_request_t));
+	for (unsigned int i = 0; i < stalled_count; i++) {
+		requests[i].request_id = i;
+		requests[i].command = SERVER_EVALUATE;
+		requests[i].side = game->side_turn;
+		memcpy(requests[i].tiles, game->board->tiles, NUMBER_TILES(3));
+	}
+	int stalled_fd = connect_server(socket_path);
+	int fd = connect_server(socket_path);
+	test_assert((stalled_fd != -1) && (fd != -1));
+	abort_subtest_if_assertion_failure("cannot connect to server\n");
+	const uint8_t *data = (const uint8_t*)requests;
+	size_t remaining = stalled_count * sizeof(struct server_request_t);
+	while (remaining) {
+		ssize_t bytes = write(stalled_fd, data, remaining);
+		test_assert(bytes > 0);
+		if (bytes <= 0) {
+			break;
+		}
+		data += bytes;
+		remaining -= bytes;
+	}
+
+	/* The only worker still gets to the next client */
+	struct server_request_t request = requests[0];
+	request.request_id = 12345;
+	test_assert(write(fd, &request, sizeof(request)) == sizeof(request));
+	struct server_response_t response;
+	test_assert(read_full(fd, &response, sizeof(response)));
+	test_assert_int_eq(response.request_id, 12345);
+	test_assert_int_eq(response.status, SERVER_OK);
+
+	/* The stalled client was dropped with part of its responses */
+	unsigned int received = 0;
+	while (read_full(stalled_fd, &response, sizeof(response))) {
+		received++;
+	}
+	test_assert(received < stalled_count);
+	close(stalled_fd);
+	close(fd);
+
+	atomic_store(&stop, true);
+	pthread_join(thread, NULL);
+	test_assert(server.success);
+	free(requests);
+	game_free(game);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_concurrent_clients();
+	test_stalled_client();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,249 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <glob.h>
+#include <solve.h>
+#include <shard.h>
+#include <strategy.h>
+
+static bool find_winning_callback(struct game_t *game, const struct action_t *action, void *vctx) {
+	bool *found = (bool*)vctx;
+	*found = game_won_by(game, game->side_turn);
+	return !*found;
+}
+
+/* Plays random positions until one has a winning action */
+static bool find_winnable_position(struct game_t *game) {
+	bool found = false;
+	for (uint64_t seed = 1; (seed < 1000) && !found; seed++) {
+		uint64_t rng_state = seed;
+		game_reset(game);
+		for (int ply = 0; ply < 40; ply++) {
+			if (game_won_by(game, TRENCH) || game_won_by(game, CLIMB)) {
+				break;
+			}
+			enumerate_valid_actions(game, find_winning_callback, &found);
+			if (found) {
+				break;
+			}
+			if (!strategy_perform_random_move(game, &rng_state, NULL)) {
+				break;
+			}
+		}
+	}
+	return found;
+}
+
+static bool can_win_immediately(struct game_t *game) {
+	bool found = false;
+	enumerate_valid_actions(game, find_winning_callback, &found);
+	return found;
+}
+
+/* Plays random positions until the side not to move threatens to win
+ * immediately, but the side to move cannot */
+static bool find_threatened_position(struct game_t *game) {
+	for (uint64_t seed = 1; seed < 1000; seed++) {
+		uint64_t rng_state = seed;
+		game_reset(game);
+		for (int ply = 0; ply < 40; ply++) {
+			if (game_won_by(game, TRENCH) || game_won_by(game, CLIMB) || can_win_immediately(game)) {
+				break;
+			}
+			game_pass_turn(game);
+			const bool threatened = can_win_immediately(game);
+			game_pass_turn(game);
+			if (threatened) {
+				return true;
+			}
+			if (!strategy_perform_random_move(game, &rng_state, NULL)) {
+				break;
+			}
+		}
+	}
+	return false;
+}
+
+static void test_solve_immediate_win(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	const struct solve_params_t params = {
+		.memory_bytes = 16 * 1024 * 1024,
+		.expansion_budget = 1000,
+	};
+	test_assert(find_winnable_position(game));
+
+	const uint64_t hash = game->hash;
+	const enum side_t mover = game->side_turn;
+	struct solve_result_t result;
+	test_assert(solve_position(game, game->side_turn, &params, &result));
+	test_assert_int_eq(result.outcome, SOLVE_PROVEN);
+	test_assert(result.have_action);
+	test_assert(game->hash == hash);
+	game_perform_action(game, &result.winning_action);
+	test_assert(game_won_by(game, mover));
+	game_free(game);
+	subtest_finished();
+}
+
+static void test_solve_resume(void) {
+	subtest_start();
+	char filename[] = "/tmp/test_solve_XXXXXX";
+	int fd = mkstemp(filename);
+	test_assert(fd != -1);
+	close(fd);
+	unlink(filename);
+
+	struct game_t *game = game_init(3);
+	test_assert(find_winnable_position(game));
+	const uint64_t hash = game->hash;
+	const struct solve_params_t params = {
+		.memory_bytes = 1024 * 1024,
+		.expansion_budget = 1000,
+		.checkpoint_filename = filename,
+	};
+	struct solve_result_t result;
+	test_assert(solve_position(game, game->side_turn, &params, &result));
+	test_assert_int_eq(result.outcome, SOLVE_PROVEN);
+	const uint64_t expansions = result.expansions;
+
+	/* Resuming the same position continues where the first run stopped */
+	test_assert(solve_position(game, game->side_turn, &params, &result));
+	test_assert_int_eq(result.outcome, SOLVE_PROVEN);
+	test_assert(result.expansions == expansions);
+	test_assert(game->hash == hash);
+
+	/* A different attacker or position starts over and leaves the game
+	 * alone */
+	test_assert(solve_position(game, !game->side_turn, &params, &result));
+	test_assert(result.outcome != SOLVE_PROVEN);
+	game_reset(game);
+	const uint64_t start_hash = game->hash;
+	test_assert(solve_position(game, game->side_turn, &params, &result));
+	test_assert(result.outcome != SOLVE_PROVEN);
+	test_assert(game->hash == start_hash);
+
+	game_free(game);
+	unlink(filename);
+	subtest_finished();
+}
+
+static void test_shard_solve(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	test_assert(find_winnable_position(game));
+	const uint64_t hash = game->hash;
+	const enum side_t mover = game->side_turn;
+	const struct shard_params_t params = {
+		.split_depth = 1,
+		.worker_count = 2,
+		.solve_params = {
+			.memory_bytes = 2 * 1024 * 1024,
+			.expansion_budget = 10,
+		},
+	};
+	struct shard_result_t result;
+	test_assert(shard_solve(game, &params, &result));
+	test_assert_int_eq(result.outcome, SOLVE_PROVEN);
+	test_assert(result.have_action);
+	test_assert(game->hash == hash);
+	game_perform_action(game, &result.winning_action);
+	test_assert(game_won_by(game, mover));
+	game_free(game);
+	subtest_finished();
+}
+
+static unsigned int count_unit_checkpoints(const char *filename) {
+	char pattern[256];
+	snprintf(pattern, sizeof(pattern), "%s.unit.*", filename);
+	glob_t found;
+	if (glob(pattern, 0, NULL, &found)) {
+		return 0;
+	}
+	const unsigned int count = found.gl_pathc;
+	globfree(&found);
+	return count;
+}
+
+static void remove_unit_checkpoints(const char *filename) {
+	char pattern[256];
+	snprintf(pattern, sizeof(pattern), "%s.unit.*", filename);
+	glob_t found;
+	if (glob(pattern, 0, NULL, &found)) {
+		return;
+	}
+	for (size_t i = 0; i < found.gl_pathc; i++) {
+		unlink(found.gl_pathv[i]);
+	}
+	globfree(&found);
+}
+
+static void test_shard_checkpoints(void) {
+	subtest_start();
+	char filename[] = "/tmp/test_shard_XXXXXX";
+	int fd = mkstemp(filename);
+	test_assert(fd != -1);
+	close(fd);
+
+	/* Units that leave the threat in place are disproven by their first
+	 * expansion and remove their checkpoints, units that run out of budget
+	 * keep theirs */
+	struct game_t *game = game_init(3);
+	test_assert(find_threatened_position(game));
+	const struct shard_params_t params = {
+		.split_depth = 1,
+		.worker_count = 2,
+		.solve_params = {
+			.memory_bytes = 2 * 1024 * 1024,
+			.expansion_budget = 1,
+			.checkpoint_filename = filename,
+		},
+	};
+	struct shard_result_t result;
+	test_assert(shard_solve(game, &params, &result));
+	test_assert(result.units_solved > 0);
+	const unsigned int remaining = count_unit_checkpoints(filename);
+	test_assert(remaining < result.units_solved);
+
+	/* Resuming picks up the checkpoints left behind */
+	test_assert(shard_solve(game, &params, &result));
+	test_assert(count_unit_checkpoints(filename) <= remaining);
+
+	remove_unit_checkpoints(filename);
+	unlink(filename);
+	game_free(game);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_solve_immediate_win();
+	test_solve_resume();
+	test_shard_solve();
+	test_shard_checkpoints();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,149 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+/* Like the stats objects this test links, see the Makefile */
+#define ENABLE_STATS
+
+#include "testbed.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <stats.h>
+#include <strategy.h>
+#include <search.h>
+
+static uint64_t counter_delta(const struct stats_snapshot_t *before, const struct stats_snapshot_t *after, enum stats_counter_t counter) {
+	return after->counters[counter] - before->counters[counter];
+}
+
+static void test_counters(void) {
+	subtest_start();
+	test_assert(stats_enabled());
+	struct game_t *game = game_init(3);
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+
+	struct stats_snapshot_t before, after;
+	stats_collect(&before);
+	const struct search_params_t params = {
+		.strategy = &strategy,
+		.depth = 2,
+	};
+	struct search_result_t result;
+	test_assert(search_best_action(game, &params, &result));
+	stats_collect(&after);
+	test_assert(counter_delta(&before, &after, STATS_SEARCH_NODES) == result.nodes);
+	test_assert(counter_delta(&before, &after, STATS_EVALUATIONS) > 0);
+	test_assert(counter_delta(&before, &after, STATS_WIN_CHECKS) > 0);
+	test_assert(counter_delta(&before, &after, STATS_ACTIONS_BUILD_MOVE) > 0);
+	test_assert(after.phase_ns[STATS_PHASE_SEARCH] > before.phase_ns[STATS_PHASE_SEARCH]);
+	test_assert(after.thread_count >= 1);
+
+	/* A greedy move evaluates every action, but only grows its action list
+	 * a few times */
+	stats_collect(&before);
+	test_assert(strategy_perform_move(game, &strategy, NULL));
+	stats_collect(&after);
+	const uint64_t evaluations = counter_delta(&before, &after, STATS_EVALUATIONS);
+	const uint64_t allocations = counter_delta(&before, &after, STATS_ALLOCATIONS);
+	test_assert_int_eq(counter_delta(&before, &after, STATS_TURNS), 1);
+	test_assert(evaluations > 8);
+	test_assert(allocations >= 1);
+	test_assert(allocations < evaluations / 4);
+	game_free(game);
+	subtest_finished();
+}
+
+static void *count_turns_thread(void *vctx) {
+	STATS_ADD(STATS_TURNS, 1000);
+	return NULL;
+}
+
+static void test_thread_handover(void) {
+	subtest_start();
+	struct stats_snapshot_t before, after;
+	stats_collect(&before);
+
+	/* What exited threads counted stays in the totals, and their blocks are
+	 * reused */
+	for (int i = 0; i < 3; i++) {
+		pthread_t thread;
+		pthread_create(&thread, NULL, count_turns_thread, NULL);
+		pthread_join(thread, NULL);
+	}
+	stats_collect(&after);
+	test_assert(counter_delta(&before, &after, STATS_TURNS) == 3000);
+	test_assert_int_eq(after.thread_count, before.thread_count);
+	subtest_finished();
+}
+
+static unsigned int count_reports(const char *filename) {
+	FILE *f = fopen(filename, "r");
+	if (!f) {
+		return 0;
+	}
+	unsigned int count = 0;
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		if (strstr(line, "\"evaluations\": ") && strstr(line, "\"phase_ns\": {")) {
+			count++;
+		}
+	}
+	fclose(f);
+	return count;
+}
+
+static void test_reporter(void) {
+	subtest_start();
+	char filename[] = "/tmp/test_stats_XXXXXX";
+	int fd = mkstemp(filename);
+	test_assert(fd != -1);
+	close(fd);
+
+	/* Without an interval, reports come on SIGUSR1 and when stopping */
+	test_assert(stats_start_reporter(filename, 0));
+	const struct timespec pause = {
+		.tv_nsec = 200 * 1000 * 1000,
+	};
+	nanosleep(&pause, NULL);
+	test_assert_int_eq(count_reports(filename), 0);
+	raise(SIGUSR1);
+	for (int i = 0; (i < 50) && !count_reports(filename); i++) {
+		nanosleep(&pause, NULL);
+	}
+	test_assert_int_eq(count_reports(filename), 1);
+	stats_stop_reporter();
+	test_assert_int_eq(count_reports(filename), 2);
+	unlink(filename);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_counters();
+	test_thread_handover();
+	test_reporter();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,170 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <strategy.h>
+#include <search.h>
+#include <ttable.h>
+#include <notation.h>
+#include <monotime.h>
+
+static void test_quiescence(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+	strategy.weights.values[FEATURE_PIECES] = 100;
+
+	/* A climb piece in the center that two trench pieces can capture, and
+	 * one more climb piece that cannot recapture */
+	uint8_t tiles[NUMBER_TILES(3)];
+	memset(tiles, EMPTY_NEUTRAL, sizeof(tiles));
+	const unsigned int center = NUMBER_TILES(3) / 2;
+	tiles[center] = PIECE_CLIMB;
+	tiles[game->canpos[center].adjacent_tiles[0]] = PIECE_TRENCH;
+	tiles[game->canpos[center].adjacent_tiles[1]] = PIECE_TRENCH;
+	tiles[0] = PIECE_CLIMB;
+
+	/* As if climb had just acted and it was still its turn */
+	game_set_position(game, tiles, CLIMB);
+	const float static_score = strategy_evaluate_after_action(game, &strategy);
+	test_assert(static_score == strategy_evaluate(game, &strategy));
+
+	strategy.quiescence_depth = 4;
+	const float quiet_score = strategy_evaluate_after_action(game, &strategy);
+	test_assert(quiet_score <= static_score - 50);
+	test_assert(game->side_turn == CLIMB);
+	test_assert(game->hash == game_compute_hash(game));
+
+	/* A single capture already sees it */
+	strategy.quiescence_depth = 1;
+	test_assert(strategy_evaluate_after_action(game, &strategy) == quiet_score);
+
+	/* Nothing to capture, nothing changes */
+	tiles[game->canpos[center].adjacent_tiles[1]] = EMPTY_NEUTRAL;
+	game_set_position(game, tiles, CLIMB);
+	test_assert(strategy_evaluate_after_action(game, &strategy) == strategy_evaluate(game, &strategy));
+	game_free(game);
+	subtest_finished();
+}
+
+static void test_time_budget(void) {
+	subtest_start();
+	struct game_t *game = game_init(4);
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+
+	struct search_params_t params = {
+		.strategy = &strategy,
+		.iterative = true,
+		.time_budget = 0.2,
+	};
+	struct search_result_t result;
+	double t0 = monotime_secs();
+	test_assert(search_best_action(game, &params, &result));
+	double t = monotime_secs() - t0;
+	test_assert(t >= 0.2);
+	test_assert(t < 2);
+	test_assert(result.depth >= 1);
+	test_assert(is_action_legal(game, &result.best_action));
+
+	/* A stopped search does not go deeper, but still comes up with an
+	 * action */
+	atomic_bool stop = true;
+	params.time_budget = 0;
+	params.stop = &stop;
+	test_assert(search_best_action(game, &params, &result));
+	test_assert_int_eq(result.depth, 1);
+	test_assert(result.nodes <= 1024);
+
+	/* Depth limited iterative search ends before the budget */
+	stop = false;
+	params.depth = 1;
+	params.time_budget = 60;
+	test_assert(search_best_action(game, &params, &result));
+	test_assert(!result.aborted);
+	test_assert_int_eq(result.depth, 1);
+	game_free(game);
+	subtest_finished();
+}
+
+static void test_timed_move_ttable(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+	strategy.move_nodes = 100000;
+	strategy.search_depth = 2;
+	strategy.ttable = ttable_init(1 << 20, 1);
+	test_assert(strategy.ttable);
+	abort_subtest_if_assertion_failure("cannot allocate transposition table\n");
+
+	/* The search behind a budgeted move fills the strategy's table */
+	const uint64_t hash = game->hash;
+	struct ttable_hit_t hit;
+	test_assert(!ttable_probe(strategy.ttable, hash, &hit));
+	test_assert(strategy_perform_move(game, &strategy, NULL));
+	test_assert(ttable_probe(strategy.ttable, hash, &hit));
+	test_assert_int_eq(hit.depth, 2);
+	ttable_free(strategy.ttable);
+	game_free(game);
+	subtest_finished();
+}
+
+static void test_stuck_side(void) {
+	subtest_start();
+	struct game_t *game = game_init(3);
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+
+	/* Climb has no legal action here, reached in self-play after random
+	 * openings */
+	uint8_t tiles[NUMBER_TILES(3)];
+	test_assert(position_from_string("0CC200012222T0T220T", 3, tiles));
+	game_set_position(game, tiles, CLIMB);
+	const uint64_t hash = game->hash;
+	uint64_t rng_state = 1;
+	test_assert(!strategy_perform_move(game, &strategy, NULL));
+	test_assert(!strategy_perform_random_move(game, &rng_state, NULL));
+	test_assert(game->hash == hash);
+
+	const struct playout_params_t params = {
+		.max_plies = 100,
+		.repetition_count = 3,
+	};
+	struct history_t *history = history_init(8);
+	test_assert(strategy_play_out(game, &strategy, &strategy, &params, history) == RESULT_DRAW);
+	test_assert_int_eq(history->length, 1);
+	history_free(history);
+	game_free(game);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_quiescence();
+	test_time_budget();
+	test_timed_move_ttable();
+	test_stuck_side();
+	test_finished();
+	return 0;
+}
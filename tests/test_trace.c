@@ -0,0 +1,166 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <trace.h>
+#include <strategy.h>
+
+#define TEST_GAME_COUNT			800
+
+/* Plays games of random moves only, so that they are quick */
+static void play_random_games(unsigned int game_count, enum game_result_t *results, uint64_t *final_hashes) {
+	struct strategy_t strategy = { 0 };
+	struct game_t *game = game_init(3);
+	for (unsigned int i = 0; i < game_count; i++) {
+		const struct playout_params_t params = {
+			.max_plies = 60,
+			.repetition_count = 3,
+			.random_plies = 60,
+			.seed = i + 1,
+		};
+		game_reset(game);
+		results[i] = strategy_play_out(game, &strategy, &strategy, &params, NULL);
+		final_hashes[i] = game->hash;
+	}
+	game_free(game);
+}
+
+static void test_binary_trace(void) {
+	subtest_start();
+	char filename[] = "/tmp/test_trace_XXXXXX";
+	int fd = mkstemp(filename);
+	test_assert(fd != -1);
+	close(fd);
+
+	/* Enough games to fill many buffers, which then pass through the
+	 * writer's queue and are reused */
+	enum game_result_t *results = calloc(TEST_GAME_COUNT, sizeof(enum game_result_t));
+	uint64_t *final_hashes = calloc(TEST_GAME_COUNT, sizeof(uint64_t));
+	test_assert(trace_init(TRACE_BINARY, filename));
+	play_random_games(TEST_GAME_COUNT, results, final_hashes);
+	trace_shutdown();
+
+	/* Every game is a start, its actions in ply order and an end, each
+	 * action carrying the hash after it */
+	struct game_t *start = game_init(3);
+	FILE *f = fopen(filename, "rb");
+	test_assert(f);
+	abort_subtest_if_assertion_failure("trace could not be opened\n");
+	unsigned int games = 0;
+	struct trace_record_t record;
+	while (fread(&record, sizeof(record), 1, f) == 1) {
+		test_assert_int_eq(record.type, TRACE_RECORD_GAME_START);
+		test_assert_int_eq(record.value, 3);
+		test_assert(record.hash == start->hash);
+		const uint64_t game_id = record.game_id;
+		uint64_t last_hash = record.hash;
+		unsigned int ply = 0;
+		while ((fread(&record, sizeof(record), 1, f) == 1) && (record.type == TRACE_RECORD_ACTION)) {
+			test_assert(record.game_id == game_id);
+			test_assert_int_eq(record.ply, ++ply);
+			last_hash = record.hash;
+		}
+		test_assert_int_eq(record.type, TRACE_RECORD_GAME_END);
+		test_assert(record.game_id == game_id);
+		if (games < TEST_GAME_COUNT) {
+			test_assert_int_eq(record.value, results[games]);
+			test_assert(last_hash == final_hashes[games]);
+		}
+		games++;
+	}
+	fclose(f);
+	test_assert_int_eq(games, TEST_GAME_COUNT);
+
+	game_free(start);
+	free(results);
+	free(final_hashes);
+	unlink(filename);
+	subtest_finished();
+}
+
+static void test_json_trace(void) {
+	subtest_start();
+	char filename[] = "/tmp/test_trace_XXXXXX";
+	int fd = mkstemp(filename);
+	test_assert(fd != -1);
+	close(fd);
+
+	enum game_result_t result;
+	uint64_t final_hash;
+	test_assert(trace_init(TRACE_JSON, filename));
+	play_random_games(1, &result, &final_hash);
+	trace_shutdown();
+
+	/* One line per record: the start, the actions in ply order, the end */
+	static const char *result_text[] = {
+		[RESULT_WIN] = "win",
+		[RESULT_LOSS] = "loss",
+		[RESULT_DRAW] = "draw",
+	};
+	FILE *f = fopen(filename, "r");
+	test_assert(f);
+	abort_subtest_if_assertion_failure("trace could not be opened\n");
+	char line[512], last_action[512] = "", expected[128];
+	unsigned int lines = 0;
+	unsigned int ply = 0;
+	bool ended = false;
+	while (fgets(line, sizeof(line), f)) {
+		test_assert(!ended);
+		if (lines == 0) {
+			test_assert(strstr(line, "{\"type\": \"start\", ") == line);
+			test_assert(strstr(line, "\"n\": 3, "));
+		} else if (strstr(line, "{\"type\": \"action\", ") == line) {
+			snprintf(expected, sizeof(expected), "\"ply\": %u, ", ++ply);
+			test_assert(strstr(line, expected));
+			strcpy(last_action, line);
+		} else {
+			snprintf(expected, sizeof(expected), "\"type\": \"end\", ");
+			test_assert(strstr(line, expected));
+			snprintf(expected, sizeof(expected), "\"plies\": %u, \"result\": \"%s\"}\n", ply, result_text[result]);
+			test_assert(strstr(line, expected));
+			ended = true;
+		}
+		lines++;
+	}
+	fclose(f);
+	test_assert(ended);
+	test_assert(ply > 0);
+	test_assert_int_eq(lines, ply + 2);
+
+	snprintf(expected, sizeof(expected), "\"hash\": \"%016" PRIx64 "\"}\n", final_hash);
+	test_assert(strstr(last_action, expected));
+	unlink(filename);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_binary_trace();
+	test_json_trace();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,79 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <ttable.h>
+
+static void test_parse_size(void) {
+	subtest_start();
+	test_assert(hugemem_parse_size("256") == 256ULL << 20);
+	test_assert(hugemem_parse_size("64K") == 64ULL << 10);
+	test_assert(hugemem_parse_size("512MB") == 512ULL << 20);
+	test_assert(hugemem_parse_size("4GiB") == 4ULL << 30);
+	test_assert(hugemem_parse_size("1t") == 1ULL << 40);
+	test_assert(hugemem_parse_size("") == 0);
+	test_assert(hugemem_parse_size("12X") == 0);
+	test_assert(hugemem_round_pow2(3000) == 2048);
+	test_assert(hugemem_round_pow2(4096) == 4096);
+	subtest_finished();
+}
+
+static void test_store_probe(void) {
+	subtest_start();
+	struct ttable_t *table = ttable_init(1000 * sizeof(struct ttable_entry_t), 2);
+	test_assert(table != NULL);
+	test_assert(table->mask == 511);
+
+	struct ttable_hit_t hit;
+	test_assert(!ttable_probe(table, 0, &hit));
+	test_assert(!ttable_probe(table, 0x1234, &hit));
+	ttable_store(table, 0x1234, 3, TTABLE_LOWER, -12.5);
+	test_assert(ttable_probe(table, 0x1234, &hit));
+	test_assert(hit.score == -12.5);
+	test_assert_int_eq(hit.depth, 3);
+	test_assert_int_eq(hit.bound, TTABLE_LOWER);
+
+	/* Same slot, different position */
+	test_assert(!ttable_probe(table, 0x1234 + 512, &hit));
+
+	/* Shallower results do not replace deeper ones of the same position */
+	ttable_store(table, 0x1234, 2, TTABLE_EXACT, 1);
+	test_assert(ttable_probe(table, 0x1234, &hit));
+	test_assert_int_eq(hit.depth, 3);
+	ttable_store(table, 0x1234 + 512, 1, TTABLE_EXACT, 7);
+	test_assert(!ttable_probe(table, 0x1234, &hit));
+	test_assert(ttable_probe(table, 0x1234 + 512, &hit));
+	test_assert(hit.score == 7);
+
+	ttable_clear(table);
+	test_assert(!ttable_probe(table, 0x1234 + 512, &hit));
+	ttable_free(table);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_parse_size();
+	test_store_probe();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,97 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include "testbed.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include <tune.h>
+
+static void test_tune_run(void) {
+	subtest_start();
+	char best_filename[] = "/tmp/test_tune_XXXXXX";
+	int fd = mkstemp(best_filename);
+	test_assert(fd != -1);
+	close(fd);
+	char final_filename[64];
+	snprintf(final_filename, sizeof(final_filename), "%s.final", best_filename);
+
+	struct strategy_t strategy = { 0 };
+	evaluation_default_weights(&strategy.weights);
+	struct tune_params_t params = {
+		.n = 3,
+		.thread_count = 2,
+		.iterations = 4,
+		.pairs_per_iteration = 3,
+		.evaluation_interval = 2,
+		.evaluation_pairs = 2,
+		.playout_params = {
+			.max_plies = 60,
+			.repetition_count = 3,
+			.random_plies = 2,
+			.seed = 7,
+		},
+		.strategy = &strategy,
+		.a = 0.5,
+		.c = 0.2,
+		.checkpoint_filename = best_filename,
+		.final_filename = final_filename,
+	};
+	params.tuned[FEATURE_MIN_DISTANCE] = true;
+	params.tuned[FEATURE_SUM_DISTANCE] = true;
+
+	struct tune_results_t results;
+	test_assert(tune_run(&params, &results));
+	test_assert_int_eq(results.pairs_per_iteration, 4);
+	test_assert(results.best_elo >= 0);
+	for (int i = 0; i < FEATURE_COUNT; i++) {
+		test_assert(isfinite(results.final_weights.values[i]));
+		if (!params.tuned[i]) {
+			test_assert(results.final_weights.values[i] == strategy.weights.values[i]);
+			test_assert(results.best_weights.values[i] == strategy.weights.values[i]);
+		}
+	}
+
+	/* Both weight sets are on disk */
+	struct feature_vector_t loaded;
+	test_assert(evaluation_load_weights(best_filename, &loaded));
+	test_assert(!memcmp(&loaded, &results.best_weights, sizeof(loaded)));
+	test_assert(evaluation_load_weights(final_filename, &loaded));
+	for (int i = 0; i < FEATURE_COUNT; i++) {
+		test_assert(fabsf(loaded.values[i] - results.final_weights.values[i]) <= 1e-6f * fabsf(results.final_weights.values[i]));
+	}
+
+	/* Without evaluations, there is nothing to keep */
+	params.evaluation_interval = 0;
+	test_assert(!tune_run(&params, &results));
+
+	unlink(best_filename);
+	unlink(final_filename);
+	subtest_finished();
+}
+
+int main(int argc, char **argv) {
+	test_start(argc, argv);
+	test_tune_run();
+	test_finished();
+	return 0;
+}
@@ -0,0 +1,302 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "trace.h"
+#include "notation.h"
+
+#define TRACE_BUFFER_SIZE		(64 * 1024)
+#define TRACE_MAX_RECORD_SIZE	256
+#define TRACE_MAX_QUEUED		16
+
+struct trace_buffer_t {
+	struct trace_buffer_t *next;
+	unsigned int used;
+	uint8_t data[TRACE_BUFFER_SIZE];
+};
+
+struct trace_state_t {
+	enum trace_format_t format;
+	FILE *f;
+	pthread_t writer_thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct trace_buffer_t *full_head, *full_tail;
+	unsigned int full_count;
+	struct trace_buffer_t *free_list;
+	bool shutdown;
+	atomic_uint_fast64_t next_game_id;
+};
+
+/* Every thread fills its own buffer without any locking. Full buffers are
+ * handed to the writer thread which does the (slow) I/O in the background.
+ * When the writer falls behind by TRACE_MAX_QUEUED buffers, producers wait
+ * for it instead of allocating ever more buffers; writer and producers
+ * share one condition variable and therefore always broadcast. */
+struct trace_thread_state_t {
+	struct trace_buffer_t *buffer;
+	uint64_t game_id;
+	unsigned int ply;
+};
+
+static struct trace_state_t trace = {
+	.format = TRACE_NONE,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+static _Thread_local struct trace_thread_state_t thread_trace;
+
+static void *trace_writer_thread(void *arg) {
+	pthread_mutex_lock(&trace.lock);
+	while (true) {
+		while (!trace.full_head && !trace.shutdown) {
+			pthread_cond_wait(&trace.cond, &trace.lock);
+		}
+		struct trace_buffer_t *buffer = trace.full_head;
+		if (!buffer) {
+			/* Shut down and nothing left to write */
+			break;
+		}
+		trace.full_head = buffer->next;
+		if (!trace.full_head) {
+			trace.full_tail = NULL;
+		}
+		trace.full_count--;
+		pthread_cond_broadcast(&trace.cond);
+		pthread_mutex_unlock(&trace.lock);
+
+		if (fwrite(buffer->data, buffer->used, 1, trace.f) != 1) {
+			perror("trace: fwrite");
+		}
+
+		pthread_mutex_lock(&trace.lock);
+		buffer->used = 0;
+		buffer->next = trace.free_list;
+		trace.free_list = buffer;
+	}
+	pthread_mutex_unlock(&trace.lock);
+	fflush(trace.f);
+	return NULL;
+}
+
+static struct trace_buffer_t *trace_get_buffer(void) {
+	pthread_mutex_lock(&trace.lock);
+	struct trace_buffer_t *buffer = trace.free_list;
+	if (buffer) {
+		trace.free_list = buffer->next;
+	}
+	pthread_mutex_unlock(&trace.lock);
+	if (!buffer) {
+		buffer = malloc(sizeof(struct trace_buffer_t));
+		if (!buffer) {
+			fprintf(stderr, "fatal: cannot allocate trace buffer.\n");
+			abort();
+		}
+	}
+	buffer->next = NULL;
+	buffer->used = 0;
+	return buffer;
+}
+
+static void trace_submit_buffer(struct trace_buffer_t *buffer) {
+	pthread_mutex_lock(&trace.lock);
+	while (trace.full_count >= TRACE_MAX_QUEUED) {
+		pthread_cond_wait(&trace.cond, &trace.lock);
+	}
+	if (trace.full_tail) {
+		trace.full_tail->next = buffer;
+	} else {
+		trace.full_head = buffer;
+	}
+	trace.full_tail = buffer;
+	trace.full_count++;
+	pthread_cond_broadcast(&trace.cond);
+	pthread_mutex_unlock(&trace.lock);
+}
+
+/* Returns a pointer to at least TRACE_MAX_RECORD_SIZE bytes in the thread's
+ * buffer. */
+static uint8_t *trace_reserve(void) {
+	if (thread_trace.buffer && (thread_trace.buffer->used + TRACE_MAX_RECORD_SIZE > TRACE_BUFFER_SIZE)) {
+		trace_submit_buffer(thread_trace.buffer);
+		thread_trace.buffer = NULL;
+	}
+	if (!thread_trace.buffer) {
+		thread_trace.buffer = trace_get_buffer();
+	}
+	return thread_trace.buffer->data + thread_trace.buffer->used;
+}
+
+static void trace_commit(unsigned int length) {
+	thread_trace.buffer->used += length;
+}
+
+static void trace_emit_binary(enum trace_record_type_t type, uint8_t side, uint32_t value, uint64_t hash) {
+	struct trace_record_t record = {
+		.type = type,
+		.side = side,
+		.ply = thread_trace.ply,
+		.value = value,
+		.game_id = thread_trace.game_id,
+		.hash = hash,
+	};
+	memcpy(trace_reserve(), &record, sizeof(record));
+	trace_commit(sizeof(record));
+}
+
+static void trace_emit_json(const char *fmt, ...) __attribute__ ((format (printf, 1, 2)));
+
+static void trace_emit_json(const char *fmt, ...) {
+	char *line = (char*)trace_reserve();
+	va_list ap;
+	va_start(ap, fmt);
+	int len = vsnprintf(line, TRACE_MAX_RECORD_SIZE, fmt, ap);
+	va_end(ap);
+	if ((len < 0) || (len >= TRACE_MAX_RECORD_SIZE)) {
+		fprintf(stderr, "fatal: trace record of %d bytes exceeds the maximum of %d bytes.\n", len, TRACE_MAX_RECORD_SIZE - 1);
+		abort();
+	}
+	trace_commit(len);
+}
+
+bool trace_parse_format(const char *name, enum trace_format_t *format) {
+	if (!strcmp(name, "none")) {
+		*format = TRACE_NONE;
+	} else if (!strcmp(name, "binary")) {
+		*format = TRACE_BINARY;
+	} else if (!strcmp(name, "json")) {
+		*format = TRACE_JSON;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+bool trace_init(enum trace_format_t format, const char *filename) {
+	if (format == TRACE_NONE) {
+		trace.format = TRACE_NONE;
+		return true;
+	}
+	if (!filename || !strcmp(filename, "-")) {
+		trace.f = stdout;
+	} else {
+		trace.f = fopen(filename, (format == TRACE_BINARY) ? "wb" : "w");
+		if (!trace.f) {
+			perror(filename);
+			return false;
+		}
+	}
+	trace.shutdown = false;
+	if (pthread_create(&trace.writer_thread, NULL, trace_writer_thread, NULL)) {
+		fprintf(stderr, "trace: cannot start writer thread.\n");
+		if (trace.f != stdout) {
+			fclose(trace.f);
+		}
+		return false;
+	}
+	trace.format = format;
+	return true;
+}
+
+void trace_game_start(const struct game_t *game) {
+	if (trace.format == TRACE_NONE) {
+		return;
+	}
+	thread_trace.game_id = atomic_fetch_add(&trace.next_game_id, 1);
+	thread_trace.ply = 0;
+	if (trace.format == TRACE_BINARY) {
+		trace_emit_binary(TRACE_RECORD_GAME_START, game->side_turn, game->n, game->hash);
+	} else {
+		trace_emit_json("{\"type\": \"start\", \"game\": %" PRIu64 ", \"n\": %u, \"side\": \"%s\", \"hash\": \"%016" PRIx64 "\"}\n", thread_trace.game_id, game->n, side_to_string(game->side_turn), game->hash);
+	}
+}
+
+void trace_action(const struct game_t *game, enum side_t side, const struct action_t *action) {
+	if (trace.format == TRACE_NONE) {
+		return;
+	}
+	thread_trace.ply++;
+	if (trace.format == TRACE_BINARY) {
+		trace_emit_binary(TRACE_RECORD_ACTION, side, game_pack_action(action), game->hash);
+	} else {
+		char action_str[ACTION_STRING_MAXLEN];
+		action_to_string(action_str, sizeof(action_str), action);
+		trace_emit_json("{\"type\": \"action\", \"game\": %" PRIu64 ", \"ply\": %u, \"side\": \"%s\", \"action\": \"%s\", \"hash\": \"%016" PRIx64 "\"}\n", thread_trace.game_id, thread_trace.ply, side_to_string(side), action_str, game->hash);
+	}
+}
+
+void trace_game_end(enum game_result_t result) {
+	static const char *result_text[] = {
+		[RESULT_WIN] = "win",
+		[RESULT_LOSS] = "loss",
+		[RESULT_DRAW] = "draw",
+	};
+	if (trace.format == TRACE_NONE) {
+		return;
+	}
+	if (trace.format == TRACE_BINARY) {
+		trace_emit_binary(TRACE_RECORD_GAME_END, 0, result, 0);
+	} else {
+		trace_emit_json("{\"type\": \"end\", \"game\": %" PRIu64 ", \"plies\": %u, \"result\": \"%s\"}\n", thread_trace.game_id, thread_trace.ply, result_text[result]);
+	}
+}
+
+/* Must be called by every thread that traced something before it terminates,
+ * otherwise its partially filled buffer is lost. */
+void trace_thread_flush(void) {
+	if (thread_trace.buffer) {
+		if (thread_trace.buffer->used) {
+			trace_submit_buffer(thread_trace.buffer);
+		} else {
+			free(thread_trace.buffer);
+		}
+		thread_trace.buffer = NULL;
+	}
+}
+
+void trace_shutdown(void) {
+	if (trace.format == TRACE_NONE) {
+		return;
+	}
+	trace_thread_flush();
+	pthread_mutex_lock(&trace.lock);
+	trace.shutdown = true;
+	pthread_cond_broadcast(&trace.cond);
+	pthread_mutex_unlock(&trace.lock);
+	pthread_join(trace.writer_thread, NULL);
+
+	while (trace.free_list) {
+		struct trace_buffer_t *next = trace.free_list->next;
+		free(trace.free_list);
+		trace.free_list = next;
+	}
+	if (trace.f != stdout) {
+		fclose(trace.f);
+	}
+	trace.format = TRACE_NONE;
+}
@@ -0,0 +1,65 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game.h"
+#include "strategy.h"
+
+enum trace_format_t {
+	TRACE_NONE,
+	TRACE_BINARY,
+	TRACE_JSON,
+};
+
+enum trace_record_type_t {
+	TRACE_RECORD_GAME_START = 1,
+	TRACE_RECORD_ACTION = 2,
+	TRACE_RECORD_GAME_END = 3,
+};
+
+/* Fixed-size record of the binary trace format. For game start records,
+ * "value" holds n; for game end records it holds the game_result_t from the
+ * view of the side that moved first. */
+struct trace_record_t {
+	uint8_t type;
+	uint8_t side;
+	uint16_t ply;
+	uint32_t value;
+	uint64_t game_id;
+	uint64_t hash;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+bool trace_parse_format(const char *name, enum trace_format_t *format);
+bool trace_init(enum trace_format_t format, const char *filename);
+void trace_game_start(const struct game_t *game);
+void trace_action(const struct game_t *game, enum side_t side, const struct action_t *action);
+void trace_game_end(enum game_result_t result);
+void trace_thread_flush(void);
+void trace_shutdown(void);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
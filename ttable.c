@@ -0,0 +1,106 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ttable.h"
+#include "stats.h"
+
+/* Transposition table shared by all search threads without locking. Each
+ * entry stores its payload next to the Zobrist hash XORed with that payload;
+ * an entry torn by a concurrent writer then simply fails verification.
+ * The payload holds the score's bit pattern in the low 32 bits, the depth
+ * in the next 16, the bound type after that and a valid bit at the top so
+ * that untouched (zero) entries never match. Replacement prefers deeper
+ * results for the same position and always overwrites other positions. */
+
+#define TTABLE_VALID		(1ULL << 63)
+
+static inline uint64_t ttable_load(const uint64_t *value) {
+	return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+
+static inline void ttable_set(uint64_t *value, uint64_t new_value) {
+	__atomic_store_n(value, new_value, __ATOMIC_RELAXED);
+}
+
+struct ttable_t *ttable_init(size_t length, unsigned int prefault_threads) {
+	size_t entry_count = hugemem_round_pow2(length / sizeof(struct ttable_entry_t));
+	if (entry_count == 0) {
+		fprintf(stderr, "Transposition table of %zu bytes holds no entries.\n", length);
+		return NULL;
+	}
+	struct ttable_t *table = calloc(1, sizeof(struct ttable_t));
+	if (!table) {
+		return NULL;
+	}
+	if (!hugemem_alloc(&table->mem, entry_count * sizeof(struct ttable_entry_t), prefault_threads)) {
+		free(table);
+		return NULL;
+	}
+	table->entries = (struct ttable_entry_t*)table->mem.data;
+	table->mask = entry_count - 1;
+	return table;
+}
+
+bool ttable_probe(const struct ttable_t *table, uint64_t hash, struct ttable_hit_t *hit) {
+	const struct ttable_entry_t *entry = &table->entries[hash & table->mask];
+	const uint64_t data = ttable_load(&entry->data);
+	STATS_INC(STATS_TTABLE_PROBES);
+	if (!(data & TTABLE_VALID) || ((ttable_load(&entry->check) ^ data) != hash)) {
+		return false;
+	}
+	STATS_INC(STATS_TTABLE_HITS);
+	const uint32_t score_bits = data & 0xffffffff;
+	memcpy(&hit->score, &score_bits, sizeof(float));
+	hit->depth = (data >> 32) & 0xffff;
+	hit->bound = (data >> 48) & 0x3;
+	return true;
+}
+
+void ttable_store(struct ttable_t *table, uint64_t hash, unsigned int depth, enum ttable_bound_t bound, float score) {
+	struct ttable_entry_t *entry = &table->entries[hash & table->mask];
+	const uint64_t old_data = ttable_load(&entry->data);
+	if ((old_data & TTABLE_VALID) && ((ttable_load(&entry->check) ^ old_data) == hash) && (((old_data >> 32) & 0xffff) > depth)) {
+		return;
+	}
+	uint32_t score_bits;
+	memcpy(&score_bits, &score, sizeof(float));
+	const uint64_t data = TTABLE_VALID | ((uint64_t)bound << 48) | ((uint64_t)(depth & 0xffff) << 32) | score_bits;
+	ttable_set(&entry->check, hash ^ data);
+	ttable_set(&entry->data, data);
+}
+
+/* Forgets all entries, e.g., when the evaluation they were computed with
+ * changes */
+void ttable_clear(struct ttable_t *table) {
+	memset(table->entries, 0, (table->mask + 1) * sizeof(struct ttable_entry_t));
+}
+
+void ttable_free(struct ttable_t *table) {
+	if (!table) {
+		return;
+	}
+	hugemem_free(&table->mem);
+	free(table);
+}
@@ -0,0 +1,62 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __TTABLE_H__
+#define __TTABLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hugemem.h"
+
+enum ttable_bound_t {
+	TTABLE_EXACT,
+	TTABLE_LOWER,
+	TTABLE_UPPER,
+};
+
+struct ttable_entry_t {
+	uint64_t check;
+	uint64_t data;
+};
+
+struct ttable_t {
+	struct hugemem_t mem;
+	struct ttable_entry_t *entries;
+	uint64_t mask;
+};
+
+struct ttable_hit_t {
+	float score;
+	unsigned int depth;
+	enum ttable_bound_t bound;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+struct ttable_t *ttable_init(size_t length, unsigned int prefault_threads);
+bool ttable_probe(const struct ttable_t *table, uint64_t hash, struct ttable_hit_t *hit);
+void ttable_store(struct ttable_t *table, uint64_t hash, unsigned int depth, enum ttable_bound_t bound, float score);
+void ttable_clear(struct ttable_t *table);
+void ttable_free(struct ttable_t *table);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
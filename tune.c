@@ -0,0 +1,137 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "tune.h"
+#include "match.h"
+#include "rng.h"
+
+/* Decay exponents recommended by Spall */
+#define SPSA_ALPHA			0.602
+#define SPSA_GAMMA			0.101
+
+static double tune_cpu_hours(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (ts.tv_sec + (ts.tv_nsec * 1e-9)) / 3600;
+}
+
+/* Plays a fixed number of pairs and returns the first strategy's score */
+static double tune_match(const struct tune_params_t *params, const struct strategy_t *first, const struct strategy_t *second, unsigned int pairs, uint64_t seed, struct match_results_t *results) {
+	struct match_params_t match_params = {
+		.n = params->n,
+		.thread_count = params->thread_count,
+		.max_pairs = pairs,
+		.playout_params = params->playout_params,
+		.candidate = first,
+		.baseline = second,
+	};
+	match_params.playout_params.seed = seed;
+	match_run(&match_params, results);
+	return (results->wins + (results->draws / 2.)) / (2. * results->pairs);
+}
+
+static unsigned int tune_round_pairs(unsigned int pairs, unsigned int thread_count) {
+	return ((pairs + thread_count - 1) / thread_count) * thread_count;
+}
+
+bool tune_run(const struct tune_params_t *params, struct tune_results_t *results) {
+	if (!params->evaluation_interval || !params->pairs_per_iteration || !params->evaluation_pairs) {
+		fprintf(stderr, "tune: evaluation interval and pair counts must not be zero.\n");
+		return false;
+	}
+	const unsigned int thread_count = params->thread_count ? params->thread_count : 1;
+	const unsigned int pairs_per_iteration = tune_round_pairs(params->pairs_per_iteration, thread_count);
+	const unsigned int evaluation_pairs = tune_round_pairs(params->evaluation_pairs, thread_count);
+	const struct feature_vector_t *initial = &params->strategy->weights;
+	double scale[FEATURE_COUNT];
+	for (unsigned int i = 0; i < FEATURE_COUNT; i++) {
+		scale[i] = fabs(initial->values[i]) < 1 ? 1 : fabs(initial->values[i]);
+	}
+
+	/* The weights keep changing, so no transposition table can be shared */
+	struct strategy_t current = *params->strategy;
+	current.ttable = NULL;
+	struct strategy_t plus = current;
+	struct strategy_t minus = current;
+	*results = (struct tune_results_t) {
+		.best_weights = *initial,
+		.final_weights = *initial,
+		.pairs_per_iteration = pairs_per_iteration,
+	};
+	if (params->checkpoint_filename && !evaluation_save_weights(params->checkpoint_filename, initial)) {
+		return false;
+	}
+
+	const double stability = params->iterations / 10.;
+	const double cpu_start = tune_cpu_hours();
+	uint64_t rng_state = params->playout_params.seed;
+
+	for (unsigned int k = 0; k < params->iterations; k++) {
+		const double c_k = params->c / pow(k + 1, SPSA_GAMMA);
+		const double a_k = params->a / pow(k + 1 + stability, SPSA_ALPHA);
+
+		int delta[FEATURE_COUNT] = { 0 };
+		for (unsigned int i = 0; i < FEATURE_COUNT; i++) {
+			if (params->tuned[i]) {
+				delta[i] = rng_below(&rng_state, 2) ? 1 : -1;
+				plus.weights.values[i] = current.weights.values[i] + (c_k * delta[i] * scale[i]);
+				minus.weights.values[i] = current.weights.values[i] - (c_k * delta[i] * scale[i]);
+			}
+		}
+
+		struct match_results_t match_results;
+		const double score = tune_match(params, &plus, &minus, pairs_per_iteration, rng_splitmix64(&rng_state), &match_results);
+
+		/* Gradient estimate of the score in units of scale[i] */
+		const double gradient = ((2 * score) - 1) / (2 * c_k);
+		for (unsigned int i = 0; i < FEATURE_COUNT; i++) {
+			if (params->tuned[i]) {
+				current.weights.values[i] += a_k * gradient * delta[i] * scale[i];
+			}
+		}
+
+		if ((((k + 1) % params->evaluation_interval) == 0) || (k + 1 == params->iterations)) {
+			tune_match(params, &current, params->strategy, evaluation_pairs, rng_splitmix64(&rng_state), &match_results);
+			results->cpu_hours = tune_cpu_hours() - cpu_start;
+			fprintf(stderr, "Iteration %u: Elo %+.1f [%+.1f, %+.1f] against the initial weights after %.3f CPU-hours, %+.1f Elo per CPU-hour", k + 1, match_results.elo, match_results.elo_lower, match_results.elo_upper, results->cpu_hours, match_results.elo / results->cpu_hours);
+			if (match_results.elo > results->best_elo) {
+				results->best_elo = match_results.elo;
+				results->best_weights = current.weights;
+				if (params->checkpoint_filename) {
+					if (!evaluation_save_weights(params->checkpoint_filename, &current.weights)) {
+						fprintf(stderr, "\n");
+						return false;
+					}
+					fprintf(stderr, ", saved");
+				}
+			}
+			fprintf(stderr, "\n");
+		}
+	}
+	results->final_weights = current.weights;
+	results->cpu_hours = tune_cpu_hours() - cpu_start;
+	return !params->final_filename || evaluation_save_weights(params->final_filename, &current.weights);
+}
@@ -0,0 +1,77 @@
+/**
+ *	isopath - Iso-path game analytics
+ *	Copyright (C) 2018-2018 Johannes Bauer
+ *
+ *	This file is part of isopath.
+ *
+ *	isopath is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; this program is ONLY licensed under
+ *	version 3 of the License, later versions are explicitly excluded.
+ *
+ *	isopath is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *	Johannes Bauer <JohannesBauer@gmx.de>
+**/
+
+#ifndef __TUNE_H__
+#define __TUNE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "strategy.h"
+
+/* Tunes the evaluation weights of a strategy by simultaneous perturbation
+ * stochastic approximation (SPSA): every iteration perturbs all tuned
+ * weights at once in a random direction and plays pairs of games between
+ * the positive and the negative perturbation on thread_count threads; the
+ * number of pairs is rounded up to a multiple of thread_count so that no
+ * thread idles. The match score then moves the weights along that
+ * direction. Weights are
+ * perturbed relative to their initial magnitude (at least 1), perturbation
+ * c and step size a are given in those units and decay per iteration as
+ * usual for SPSA.
+ *
+ * Every evaluation_interval iterations, the current weights play
+ * evaluation_pairs pairs against the initial weights. Whenever that Elo
+ * estimate is the best so far, the weights are written to
+ * checkpoint_filename (if not NULL), which initially holds the starting
+ * weights. The weights of the last iteration are returned as well and
+ * written to final_filename (if not NULL), since a noisy evaluation can
+ * miss that they improved. */
+struct tune_params_t {
+	uint8_t n;
+	unsigned int thread_count;
+	unsigned int iterations;
+	unsigned int pairs_per_iteration;
+	unsigned int evaluation_interval;
+	unsigned int evaluation_pairs;
+	struct playout_params_t playout_params;
+	/* Everything but the weights is used as is, the weights are the
+	 * starting point */
+	const struct strategy_t *strategy;
+	bool tuned[FEATURE_COUNT];
+	double a, c;
+	const char *checkpoint_filename;
+	const char *final_filename;
+};
+
+struct tune_results_t {
+	struct feature_vector_t best_weights;
+	double best_elo;
+	struct feature_vector_t final_weights;
+	unsigned int pairs_per_iteration;
+	double cpu_hours;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+bool tune_run(const struct tune_params_t *params, struct tune_results_t *results);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif